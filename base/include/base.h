@@ -0,0 +1,158 @@
+/** @file base.h
+ *  @brief Base station receiver of cluster head uplinks.
+ *
+ *  Receiver thread reads datagrams from UDP_BROADCAST_PORT
+ *  in batches with recvmmsg() straight into slots of SPSC
+ *  queue. Parser thread takes them from queue, decodes
+ *  raw (UPLINK_FRAMES_RAW) and delta encoded (UPLINK_DELTA)
+ *  uplinks, drops readings already received or older than
+ *  last one of their node (see dedup.h) and appends rest to
+ *  columnar file.
+ *
+ *  Summary and histogram uplinks carry no reading of single
+ *  node, they are validated and counted only.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef BASE_H_
+#define BASE_H_
+
+#include <stdint.h>
+#include <vector>
+#include "frame.h"
+#include "delta.h"
+#include "dedup.h"
+#include "aggregate.h"
+#include "spsc.h"
+#include "column.h"
+
+/** Default number of queue slots.*/
+#define BASE_QUEUE_SLOTS        8192
+
+/** Default number of datagrams read by one recvmmsg().*/
+#define BASE_BATCH              64
+
+/** Default socket receive buffer in bytes.*/
+#define BASE_RCVBUF             (8 * 1024 * 1024)
+
+/** Time after which blocked receive checks if it should stop, in ms.*/
+#define BASE_POLL_MS            100
+
+/** Time after which parser writes block which is not full, in ms.*/
+#define BASE_FLUSH_MS           1000
+
+/** Default number of nodes whose last reading is tracked.*/
+#define BASE_STATIONS           65536
+
+/**
+ * Configuration of base station.
+*/
+typedef struct
+{
+    uint16_t    port;                   /**< UDP port to listen on.*/
+    uint32_t    queue_slots;            /**< Slots of queue between threads.*/
+    uint32_t    batch;                  /**< Most datagrams per recvmmsg().*/
+    uint32_t    rcvbuf;                 /**< Socket receive buffer in bytes.*/
+    double      duration_s;             /**< Stop after this long, 0 to run until signal.*/
+    uint32_t    stations;               /**< Nodes whose last reading is tracked.*/
+    const char* output;                 /**< Path of columnar file.*/
+} base_config_s;
+
+/**
+ * Counters of one thread. Every thread has its own, so no
+ * counter is shared, and they are read after threads stop.
+*/
+typedef struct
+{
+    uint64_t    first_us;               /**< Receive time of first datagram.*/
+    uint64_t    last_us;                /**< Receive time of last datagram.*/
+    uint64_t    datagrams;              /**< Datagrams received.*/
+    uint64_t    bytes;                  /**< Bytes of datagrams received.*/
+    uint64_t    batches;                /**< recvmmsg() calls which returned data.*/
+    uint64_t    truncated;              /**< Datagrams larger than UPLINK_DATAGRAM_SIZE.*/
+    uint64_t    queue_full;             /**< Times receiver found queue full.*/
+    uint64_t    invalid;                /**< Datagrams which could not be decoded.*/
+    uint64_t    summaries;              /**< Valid summary or histogram uplinks.*/
+    uint64_t    records;                /**< Readings decoded.*/
+    uint64_t    duplicates;             /**< Readings dropped as already received.*/
+    uint64_t    late;                   /**< Readings dropped as older than last one of node.*/
+} base_stats_s;
+
+/**
+ * State of parser thread.
+*/
+typedef struct
+{
+    std::vector<dedup_entry_s> slots;   /**< Storage of dedup, allocated once.*/
+    dedup_s     dedup;                  /**< Last reading of every node.*/
+    column_writer_s* writer;            /**< Output file.*/
+    base_stats_s stats;                 /**< Counters of parser.*/
+} base_ingest_s;
+
+/**
+ * @brief Fills configuration with defaults.
+ * @param config Pointer to base_config_s structure.
+ * @return none.
+ */
+void base_default_config(base_config_s* config);
+
+/**
+ * @brief Prepares parser state. Allocates table of tracked nodes.
+ * @param ingest Pointer to base_ingest_s structure.
+ * @param writer Output file.
+ * @param stations Most nodes whose last reading is tracked.
+ * @return none.
+ */
+void base_ingest_init(base_ingest_s* ingest, column_writer_s* writer, uint32_t stations);
+
+/**
+ * @brief Opens UDP socket bound to port of configuration on all addresses.
+ * @param config Pointer to base_config_s structure.
+ * @return Socket, or -1 on error.
+ */
+int base_open_socket(const base_config_s* config);
+
+/**
+ * @brief Asks receiver and parser to stop. Safe to call from signal handler.
+ * @param none.
+ * @return none.
+ */
+void base_stop(void);
+
+/**
+ * @brief Returns false once base_stop() was called.
+ * @param none.
+ * @return true while base station runs.
+ */
+bool base_running(void);
+
+/**
+ * @brief Receives datagrams into queue until base_stop(). Runs on receiver thread.
+ * @param fd Socket.
+ * @param queue Queue to parser.
+ * @param config Pointer to base_config_s structure.
+ * @param stats Counters of receiver.
+ * @return none.
+ */
+void base_receive(int fd, spsc_s* queue, const base_config_s* config, base_stats_s* stats);
+
+/**
+ * @brief Ingests datagrams from queue until receiver is done and queue
+ * is empty. Runs on parser thread.
+ * @param queue Queue from receiver.
+ * @param ingest Pointer to base_ingest_s structure.
+ * @param receiver_done Set by main thread after receiver thread returned.
+ * @return none.
+ */
+void base_parse(spsc_s* queue, base_ingest_s* ingest, const std::atomic<bool>* receiver_done);
+
+/**
+ * @brief Decodes one datagram and appends new readings to output.
+ * @param ingest Pointer to base_ingest_s structure.
+ * @param datagram Received datagram.
+ * @return none.
+ */
+void base_ingest(base_ingest_s* ingest, const base_datagram_s* datagram);
+
+#endif // BASE_H_
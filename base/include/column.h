@@ -0,0 +1,131 @@
+/** @file column.h
+ *  @brief Append-only columnar file of readings.
+ *
+ *  File starts with COLUMN_FILE_MAGIC, and is followed by
+ *  blocks of at most COLUMN_BLOCK_RECORDS readings. Within
+ *  block every field is stored as one column, so tools
+ *  which need only values of one node read little of it
+ *  and columns compress well. Fields are in host (little
+ *  endian) byte order:
+ *
+ *  | size      | field                            |
+ *  |-----------|----------------------------------|
+ *  | 4         | COLUMN_BLOCK_MAGIC               |
+ *  | 4         | number of readings n             |
+ *  | 8*n       | receive time, us since epoch     |
+ *  | 4*n       | IPv4 address of cluster head     |
+ *  | 2*n       | ADC value                        |
+ *  | 6*n       | MAC address of node              |
+ *  | n         | round                            |
+ *  | n         | sequence number                  |
+ *
+ *  Block is written with one write(), file is opened with
+ *  O_APPEND and never rewritten. Block cut short by crash
+ *  is last one in file, and reader stops before it.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef COLUMN_H_
+#define COLUMN_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include "frame.h"
+
+/** First bytes of columnar file.*/
+#define COLUMN_FILE_MAGIC       "LEACHCOL"
+
+/** Size of COLUMN_FILE_MAGIC without terminator.*/
+#define COLUMN_FILE_MAGIC_SIZE  8
+
+/** First word of every block ("LCB1").*/
+#define COLUMN_BLOCK_MAGIC      0x3142434Cu
+
+/** Most readings in one block.*/
+#define COLUMN_BLOCK_RECORDS    4096
+
+/**
+ * One reading as received by base.
+*/
+typedef struct
+{
+    uint64_t    time_us;                /**< Receive time, us since epoch.*/
+    uint32_t    source;                 /**< IPv4 address of cluster head, host order.*/
+    uint16_t    value;                  /**< ADC value.*/
+    uint8_t     mac[FRAME_MAC_SIZE];    /**< MAC address of node.*/
+    uint8_t     round;                  /**< Round.*/
+    uint8_t     seq;                    /**< Sequence number.*/
+} column_record_s;
+
+/**
+ * Columns of one block.
+*/
+typedef struct
+{
+    uint32_t    count;                  /**< Number of readings in block.*/
+    uint64_t    time_us[COLUMN_BLOCK_RECORDS]; /**< Receive times.*/
+    uint32_t    source[COLUMN_BLOCK_RECORDS];  /**< Cluster head addresses.*/
+    uint16_t    value[COLUMN_BLOCK_RECORDS];   /**< ADC values.*/
+    uint8_t     mac[COLUMN_BLOCK_RECORDS][FRAME_MAC_SIZE]; /**< MAC addresses.*/
+    uint8_t     round[COLUMN_BLOCK_RECORDS];   /**< Rounds.*/
+    uint8_t     seq[COLUMN_BLOCK_RECORDS];     /**< Sequence numbers.*/
+} column_block_s;
+
+/**
+ * Writer of columnar file.
+*/
+typedef struct
+{
+    int         fd;                     /**< File descriptor, -1 if not open.*/
+    uint64_t    blocks;                 /**< Blocks written.*/
+    uint64_t    records;                /**< Readings written.*/
+    column_block_s block;               /**< Block being filled.*/
+} column_writer_s;
+
+/**
+ * @brief Opens file for appending, writes file magic if it is empty.
+ * @param writer Pointer to column_writer_s structure.
+ * @param path Path of file.
+ * @return true if file is open and is columnar file.
+ */
+bool column_open(column_writer_s* writer, const char* path);
+
+/**
+ * @brief Adds reading to block, writes block when it is full.
+ * @param writer Pointer to column_writer_s structure.
+ * @param record Reading.
+ * @return false if block could not be written.
+ */
+bool column_append(column_writer_s* writer, const column_record_s* record);
+
+/**
+ * @brief Writes block, even if it is not full.
+ * @param writer Pointer to column_writer_s structure.
+ * @return false if block could not be written.
+ */
+bool column_flush(column_writer_s* writer);
+
+/**
+ * @brief Writes block and closes file.
+ * @param writer Pointer to column_writer_s structure.
+ * @return none.
+ */
+void column_close(column_writer_s* writer);
+
+/**
+ * @brief Checks file magic of columnar file opened for reading.
+ * @param fp File at its start.
+ * @return true if file is columnar file.
+ */
+bool column_read_header(FILE* fp);
+
+/**
+ * @brief Reads next block of columnar file.
+ * @param fp File after header or previous block.
+ * @param block Filled with columns of block.
+ * @return false at end of file or at incomplete block.
+ */
+bool column_read_block(FILE* fp, column_block_s* block);
+
+#endif // COLUMN_H_
@@ -0,0 +1,102 @@
+/** @file spsc.h
+ *  @brief Lock-free single producer, single consumer queue
+ *  of received datagrams.
+ *
+ *  Receiver thread reserves free slots, lets recvmmsg()
+ *  write datagrams straight into them and publishes them,
+ *  parser thread peeks at published slots and releases
+ *  them when done. Datagrams are never copied on the way.
+ *
+ *  Producer owns head and consumer owns tail, each of them
+ *  reads index of the other side with acquire and keeps
+ *  last value it saw, so cache line of the other side is
+ *  touched only when last value leaves fewer free (published)
+ *  slots than asked for.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef SPSC_H_
+#define SPSC_H_
+
+#include <stdint.h>
+#include <atomic>
+#include "frame.h"
+
+/** Size of cache line, producer and consumer indexes are kept apart.*/
+#define SPSC_CACHE_LINE         64
+
+/**
+ * One received datagram.
+*/
+typedef struct
+{
+    uint64_t    time_us;                /**< Receive time, us since epoch.*/
+    uint32_t    source;                 /**< IPv4 address of sender, host order.*/
+    uint16_t    len;                    /**< Length of datagram, 0 if it was truncated.*/
+    uint8_t     data[UPLINK_DATAGRAM_SIZE]; /**< Datagram.*/
+} base_datagram_s;
+
+/**
+ * Queue of datagrams. Capacity is power of two.
+*/
+typedef struct
+{
+    base_datagram_s* slots;             /**< Ring of capacity slots.*/
+    uint32_t    mask;                   /**< capacity - 1.*/
+    alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> head; /**< Next slot producer fills.*/
+    uint32_t    cached_tail;            /**< Tail as last seen by producer.*/
+    alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> tail; /**< Next slot consumer reads.*/
+    uint32_t    cached_head;            /**< Head as last seen by consumer.*/
+} spsc_s;
+
+/**
+ * @brief Allocates queue.
+ * @param queue Pointer to spsc_s structure.
+ * @param capacity Number of slots, rounded up to power of two.
+ * @return true if memory was allocated.
+ */
+bool spsc_init(spsc_s* queue, uint32_t capacity);
+
+/**
+ * @brief Frees queue.
+ * @param queue Pointer to spsc_s structure.
+ * @return none.
+ */
+void spsc_free(spsc_s* queue);
+
+/**
+ * @brief Finds free slots producer can fill, without wrapping around.
+ * @param queue Pointer to spsc_s structure.
+ * @param first Set to first free slot.
+ * @param max Most slots wanted.
+ * @return Number of free slots from first, 0 if queue is full.
+ */
+uint32_t spsc_reserve(spsc_s* queue, base_datagram_s** first, uint32_t max);
+
+/**
+ * @brief Hands filled slots to consumer.
+ * @param queue Pointer to spsc_s structure.
+ * @param count Number of slots filled, at most as many as reserved.
+ * @return none.
+ */
+void spsc_publish(spsc_s* queue, uint32_t count);
+
+/**
+ * @brief Finds published slots consumer can read, without wrapping around.
+ * @param queue Pointer to spsc_s structure.
+ * @param first Set to first published slot.
+ * @param max Most slots wanted.
+ * @return Number of published slots from first, 0 if queue is empty.
+ */
+uint32_t spsc_peek(spsc_s* queue, base_datagram_s** first, uint32_t max);
+
+/**
+ * @brief Gives read slots back to producer.
+ * @param queue Pointer to spsc_s structure.
+ * @param count Number of slots read, at most as many as peeked.
+ * @return none.
+ */
+void spsc_release(spsc_s* queue, uint32_t count);
+
+#endif // SPSC_H_
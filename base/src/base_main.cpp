@@ -0,0 +1,162 @@
+/** @file base_main.cpp
+ *  @brief
+ *
+ *  Command line entry of base station receiver.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include "base.h"
+
+static spsc_s Queue;
+static column_writer_s Writer;
+static base_ingest_s Ingest;
+
+static void usage(const char* name)
+{
+    printf("Usage: %s [options]\n"
+           "  --port N           UDP port (default %u)\n"
+           "  --output FILE      columnar file readings are appended to (default readings.col)\n"
+           "  --queue N          slots of queue between receiver and parser (default %u)\n"
+           "  --batch N          most datagrams per recvmmsg() (default %u)\n"
+           "  --rcvbuf N         socket receive buffer in bytes (default %u)\n"
+           "  --stations N       nodes whose last reading is tracked (default %u)\n"
+           "  --duration S       stop after S seconds (default: run until SIGINT/SIGTERM)\n",
+           name, UDP_BROADCAST_PORT, BASE_QUEUE_SLOTS, BASE_BATCH, BASE_RCVBUF, BASE_STATIONS);
+}
+
+static void on_signal(int sig)
+{
+    base_stop();
+}
+
+static void report(const base_stats_s* rx, const base_stats_s* parse, double wall_s)
+{
+    double active_s = (rx->last_us - rx->first_us) / 1e6;
+
+    printf("datagrams             %llu\n", (unsigned long long)rx->datagrams);
+    printf("bytes                 %llu\n", (unsigned long long)rx->bytes);
+    printf("datagrams/batch       %.1f\n", rx->batches ? (double)rx->datagrams / rx->batches : 0.0);
+    printf("truncated             %llu\n", (unsigned long long)rx->truncated);
+    printf("queue full            %llu\n", (unsigned long long)rx->queue_full);
+    printf("invalid               %llu\n", (unsigned long long)parse->invalid);
+    printf("summaries             %llu\n", (unsigned long long)parse->summaries);
+    printf("readings              %llu\n", (unsigned long long)parse->records);
+    printf("duplicates            %llu\n", (unsigned long long)parse->duplicates);
+    printf("late                  %llu\n", (unsigned long long)parse->late);
+    printf("untracked             %llu\n", (unsigned long long)Ingest.dedup.overflow);
+    printf("written               %llu\n", (unsigned long long)Writer.records);
+    printf("wall time             %.2f s\n", wall_s);
+    printf("receive time          %.2f s\n", active_s);
+    printf("readings/s            %.0f\n", active_s > 0 ? parse->records / active_s : 0.0);
+}
+
+int main(int argc, char** argv)
+{
+    base_config_s config;
+    base_stats_s rx_stats;
+    std::atomic<bool> receiver_done(false);
+    int fd;
+
+    base_default_config(&config);
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0 || value == NULL) {
+            usage(argv[0]);
+            return strcmp(arg, "--help") == 0 ? 0 : 1;
+        }
+        i++;
+
+        if (strcmp(arg, "--port") == 0) {
+            config.port = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--output") == 0) {
+            config.output = value;
+        }
+        else if (strcmp(arg, "--queue") == 0) {
+            config.queue_slots = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--batch") == 0) {
+            config.batch = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--rcvbuf") == 0) {
+            config.rcvbuf = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--stations") == 0) {
+            config.stations = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--duration") == 0) {
+            config.duration_s = strtod(value, NULL);
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (config.batch == 0 || config.queue_slots < config.batch) {
+        fprintf(stderr, "Batch must be at least 1 and queue at least batch long!\n");
+        return 1;
+    }
+
+    if (spsc_init(&Queue, config.queue_slots) == false) {
+        fprintf(stderr, "Could not allocate queue!\n");
+        return 1;
+    }
+
+    if (column_open(&Writer, config.output) == false) {
+        fprintf(stderr, "Could not open %s to append!\n", config.output);
+        return 1;
+    }
+
+    fd = base_open_socket(&config);
+    if (fd < 0) {
+        fprintf(stderr, "Could not bind UDP port %u!\n", config.port);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    memset(&rx_stats, 0, sizeof(rx_stats));
+    base_ingest_init(&Ingest, &Writer, config.stations);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::thread receiver(base_receive, fd, &Queue, &config, &rx_stats);
+    std::thread parser(base_parse, &Queue, &Ingest, &receiver_done);
+
+    while (base_running()) {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (config.duration_s > 0 && elapsed.count() >= config.duration_s) {
+            base_stop();
+        }
+        usleep(BASE_POLL_MS * 1000);
+    }
+
+    receiver.join();
+    receiver_done.store(true, std::memory_order_release);
+    parser.join();
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+    close(fd);
+    column_close(&Writer);
+    spsc_free(&Queue);
+
+    report(&rx_stats, &Ingest.stats, wall.count());
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/** @file column.cpp
+ *  @brief
+ *
+ *  This file contains writer and reader of append-only
+ *  columnar file of readings.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "column.h"
+
+/** Number of iovec entries of one block (header and six columns).*/
+#define COLUMN_IOVECS           7
+
+static size_t block_iovecs(column_block_s* block, uint32_t* header, struct iovec* iov)
+{
+    uint32_t n = block->count;
+
+    header[0] = COLUMN_BLOCK_MAGIC;
+    header[1] = n;
+
+    iov[0] = {header, 2 * sizeof(uint32_t)};
+    iov[1] = {block->time_us, n * sizeof(uint64_t)};
+    iov[2] = {block->source, n * sizeof(uint32_t)};
+    iov[3] = {block->value, n * sizeof(uint16_t)};
+    iov[4] = {block->mac, n * (size_t)FRAME_MAC_SIZE};
+    iov[5] = {block->round, n};
+    iov[6] = {block->seq, n};
+
+    return 2 * sizeof(uint32_t) + n * (sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint16_t) + FRAME_MAC_SIZE + 2);
+}
+
+bool column_open(column_writer_s* writer, const char* path)
+{
+    struct stat st;
+
+    writer->blocks = 0;
+    writer->records = 0;
+    writer->block.count = 0;
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+
+    if (writer->fd < 0) {
+        return false;
+    }
+
+    if (fstat(writer->fd, &st) == 0 && st.st_size == 0) {
+        if (write(writer->fd, COLUMN_FILE_MAGIC, COLUMN_FILE_MAGIC_SIZE) == COLUMN_FILE_MAGIC_SIZE) {
+            return true;
+        }
+    }
+    else {
+        // appending to existing file, it has to be ours.
+        FILE* fp = fopen(path, "rb");
+        bool valid = fp != NULL && column_read_header(fp);
+
+        if (fp != NULL) {
+            fclose(fp);
+        }
+        if (valid) {
+            return true;
+        }
+    }
+
+    close(writer->fd);
+    writer->fd = -1;
+
+    return false;
+}
+
+bool column_append(column_writer_s* writer, const column_record_s* record)
+{
+    column_block_s* block = &writer->block;
+    uint32_t i = block->count++;
+
+    block->time_us[i] = record->time_us;
+    block->source[i] = record->source;
+    block->value[i] = record->value;
+    memcpy(block->mac[i], record->mac, FRAME_MAC_SIZE);
+    block->round[i] = record->round;
+    block->seq[i] = record->seq;
+
+    if (block->count == COLUMN_BLOCK_RECORDS) {
+        return column_flush(writer);
+    }
+
+    return true;
+}
+
+bool column_flush(column_writer_s* writer)
+{
+    uint32_t header[2];
+    struct iovec iov[COLUMN_IOVECS];
+    size_t size;
+    ssize_t written;
+
+    if (writer->block.count == 0) {
+        return true;
+    }
+
+    size = block_iovecs(&writer->block, header, iov);
+
+    do {
+        written = writev(writer->fd, iov, COLUMN_IOVECS);
+    } while (written < 0 && errno == EINTR);
+
+    writer->records += writer->block.count;
+    writer->blocks++;
+    writer->block.count = 0;
+
+    return written == (ssize_t)size;
+}
+
+void column_close(column_writer_s* writer)
+{
+    if (writer->fd < 0) {
+        return;
+    }
+
+    column_flush(writer);
+    close(writer->fd);
+    writer->fd = -1;
+}
+
+bool column_read_header(FILE* fp)
+{
+    char magic[COLUMN_FILE_MAGIC_SIZE];
+
+    return fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+           memcmp(magic, COLUMN_FILE_MAGIC, COLUMN_FILE_MAGIC_SIZE) == 0;
+}
+
+bool column_read_block(FILE* fp, column_block_s* block)
+{
+    uint32_t header[2];
+    uint32_t n;
+
+    if (fread(header, sizeof(uint32_t), 2, fp) != 2 || header[0] != COLUMN_BLOCK_MAGIC ||
+        header[1] == 0 || header[1] > COLUMN_BLOCK_RECORDS) {
+        return false;
+    }
+
+    n = header[1];
+    block->count = n;
+
+    return fread(block->time_us, sizeof(uint64_t), n, fp) == n &&
+           fread(block->source, sizeof(uint32_t), n, fp) == n &&
+           fread(block->value, sizeof(uint16_t), n, fp) == n &&
+           fread(block->mac, FRAME_MAC_SIZE, n, fp) == n &&
+           fread(block->round, 1, n, fp) == n &&
+           fread(block->seq, 1, n, fp) == n;
+}
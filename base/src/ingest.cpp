@@ -0,0 +1,132 @@
+/** @file ingest.cpp
+ *  @brief
+ *
+ *  This file contains parser thread of base station,
+ *  which decodes uplinks, drops duplicated readings and
+ *  appends new ones to columnar file.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include "base.h"
+
+/** Most datagrams parser takes from queue at once.*/
+#define PARSE_BATCH             64
+
+/** Parser sleep when queue is empty, in us.*/
+#define PARSE_IDLE_US           50
+
+static void ingest_frame(base_ingest_s* ingest, const base_datagram_s* datagram, const uint8_t* frame)
+{
+    column_record_s record;
+
+    ingest->stats.records++;
+
+    // cluster heads of overlapping clusters and retries deliver same reading again.
+    switch (dedup_check(&ingest->dedup, frame)) {
+    case DEDUP_DUPLICATE:
+        ingest->stats.duplicates++;
+        return;
+    case DEDUP_LATE:
+        ingest->stats.late++;
+        return;
+    default:
+        break;
+    }
+
+    record.time_us = datagram->time_us;
+    record.source = datagram->source;
+    record.value = frame_adc_value(frame);
+    memcpy(record.mac, frame_mac(frame), FRAME_MAC_SIZE);
+    record.round = frame_round(frame);
+    record.seq = frame_seq(frame);
+
+    column_append(ingest->writer, &record);
+}
+
+void base_ingest_init(base_ingest_s* ingest, column_writer_s* writer, uint32_t stations)
+{
+    uint32_t capacity = dedup_capacity(stations);
+
+    ingest->slots.resize(capacity);
+    dedup_init(&ingest->dedup, ingest->slots.data(), capacity);
+    ingest->writer = writer;
+    memset(&ingest->stats, 0, sizeof(ingest->stats));
+}
+
+void base_ingest(base_ingest_s* ingest, const base_datagram_s* datagram)
+{
+    uint8_t frames[DELTA_RECORDS_MAX * FRAME_SIZE];
+    const uint8_t* first = NULL;
+    size_t count = 0;
+
+    if (datagram->len < UPLINK_HEADER_SIZE) {
+        ingest->stats.invalid++;
+        return;
+    }
+
+    switch (uplink_type(datagram->data)) {
+    case UPLINK_FRAMES_RAW:
+        first = uplink_frames(datagram->data, datagram->len, &count);
+        break;
+    case UPLINK_DELTA:
+        count = delta_decode(datagram->data, datagram->len, frames, DELTA_RECORDS_MAX);
+        first = frames;
+        break;
+    case UPLINK_SUMMARY:
+    case UPLINK_HISTOGRAM:
+        if (summary_is_valid(datagram->data + UPLINK_HEADER_SIZE, datagram->len - UPLINK_HEADER_SIZE,
+                             uplink_type(datagram->data))) {
+            ingest->stats.summaries++;
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (first == NULL || count == 0) {
+        ingest->stats.invalid++;
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ingest_frame(ingest, datagram, first + i*FRAME_SIZE);
+    }
+}
+
+void base_parse(spsc_s* queue, base_ingest_s* ingest, const std::atomic<bool>* receiver_done)
+{
+    std::chrono::steady_clock::time_point flushed = std::chrono::steady_clock::now();
+
+    for (;;) {
+        base_datagram_s* first;
+        // read flag before queue, so nothing published before receiver stopped is missed.
+        bool done = receiver_done->load(std::memory_order_acquire);
+        uint32_t n = spsc_peek(queue, &first, PARSE_BATCH);
+
+        for (uint32_t i = 0; i < n; i++) {
+            base_ingest(ingest, &first[i]);
+        }
+        spsc_release(queue, n);
+
+        if (n == 0) {
+            if (done) {
+                break;
+            }
+            usleep(PARSE_IDLE_US);
+        }
+
+        // readings do not wait in memory for long when traffic is low.
+        if (std::chrono::steady_clock::now() - flushed > std::chrono::milliseconds(BASE_FLUSH_MS)) {
+            column_flush(ingest->writer);
+            flushed = std::chrono::steady_clock::now();
+        }
+    }
+
+    column_flush(ingest->writer);
+}
@@ -0,0 +1,140 @@
+/** @file receiver.cpp
+ *  @brief
+ *
+ *  This file contains UDP socket of base station and
+ *  receiver thread which reads datagrams in batches
+ *  into queue to parser.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <vector>
+#include "base.h"
+
+static std::atomic<bool> Running(true);
+
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void base_default_config(base_config_s* config)
+{
+    config->port = UDP_BROADCAST_PORT;
+    config->queue_slots = BASE_QUEUE_SLOTS;
+    config->batch = BASE_BATCH;
+    config->rcvbuf = BASE_RCVBUF;
+    config->duration_s = 0;
+    config->stations = BASE_STATIONS;
+    config->output = "readings.col";
+}
+
+int base_open_socket(const base_config_s* config)
+{
+    struct sockaddr_in addr;
+    struct timeval timeout = {0, BASE_POLL_MS * 1000};
+    int rcvbuf = config->rcvbuf;
+    int one = 1;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    // buffer rides out bursts while parser catches up, kernel may give less.
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config->port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void base_stop(void)
+{
+    Running.store(false, std::memory_order_relaxed);
+}
+
+bool base_running(void)
+{
+    return Running.load(std::memory_order_relaxed);
+}
+
+void base_receive(int fd, spsc_s* queue, const base_config_s* config, base_stats_s* stats)
+{
+    std::vector<struct mmsghdr> msgs(config->batch);
+    std::vector<struct iovec> iovs(config->batch);
+    std::vector<struct sockaddr_in> addrs(config->batch);
+
+    while (base_running()) {
+        base_datagram_s* first;
+        uint32_t n = spsc_reserve(queue, &first, config->batch);
+        uint64_t time_us;
+        int r;
+
+        if (n == 0) {
+            // parser is behind, socket buffer holds datagrams meanwhile.
+            stats->queue_full++;
+            sched_yield();
+            continue;
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            iovs[i].iov_base = first[i].data;
+            iovs[i].iov_len = UPLINK_DATAGRAM_SIZE;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        }
+
+        // blocks for first datagram only, then takes what is already queued.
+        r = recvmmsg(fd, msgs.data(), n, MSG_WAITFORONE, NULL);
+        if (r <= 0) {
+            continue;
+        }
+
+        time_us = now_us();
+        if (stats->batches++ == 0) {
+            stats->first_us = time_us;
+        }
+        stats->last_us = time_us;
+
+        for (int i = 0; i < r; i++) {
+            first[i].time_us = time_us;
+            first[i].source = ntohl(addrs[i].sin_addr.s_addr);
+            first[i].len = msgs[i].msg_len;
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                first[i].len = 0;
+                stats->truncated++;
+            }
+            stats->bytes += msgs[i].msg_len;
+        }
+        stats->datagrams += r;
+
+        spsc_publish(queue, r);
+    }
+}
@@ -0,0 +1,98 @@
+/** @file spsc.cpp
+ *  @brief
+ *
+ *  This file contains lock-free single producer, single
+ *  consumer queue which carries datagrams from receiver
+ *  thread to parser thread.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <stdlib.h>
+#include "spsc.h"
+
+bool spsc_init(spsc_s* queue, uint32_t capacity)
+{
+    uint32_t size = 1;
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    queue->slots = (base_datagram_s*)calloc(size, sizeof(base_datagram_s));
+    queue->mask = size - 1;
+    queue->head.store(0, std::memory_order_relaxed);
+    queue->tail.store(0, std::memory_order_relaxed);
+    queue->cached_tail = 0;
+    queue->cached_head = 0;
+
+    return queue->slots != NULL;
+}
+
+void spsc_free(spsc_s* queue)
+{
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+uint32_t spsc_reserve(spsc_s* queue, base_datagram_s** first, uint32_t max)
+{
+    uint32_t head = queue->head.load(std::memory_order_relaxed);
+    uint32_t capacity = queue->mask + 1;
+    uint32_t n;
+
+    // consumer may have released more slots since tail was last seen.
+    n = capacity - (head - queue->cached_tail);
+    if (n < max) {
+        queue->cached_tail = queue->tail.load(std::memory_order_acquire);
+        n = capacity - (head - queue->cached_tail);
+    }
+
+    // slots up to end of ring only, recvmmsg() needs them in one piece.
+    if (n > capacity - (head & queue->mask)) {
+        n = capacity - (head & queue->mask);
+    }
+    if (n > max) {
+        n = max;
+    }
+
+    *first = &queue->slots[head & queue->mask];
+
+    return n;
+}
+
+void spsc_publish(spsc_s* queue, uint32_t count)
+{
+    queue->head.store(queue->head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+uint32_t spsc_peek(spsc_s* queue, base_datagram_s** first, uint32_t max)
+{
+    uint32_t tail = queue->tail.load(std::memory_order_relaxed);
+    uint32_t capacity = queue->mask + 1;
+    uint32_t n;
+
+    // producer may have published more slots since head was last seen.
+    n = queue->cached_head - tail;
+    if (n < max) {
+        queue->cached_head = queue->head.load(std::memory_order_acquire);
+        n = queue->cached_head - tail;
+    }
+
+    if (n > capacity - (tail & queue->mask)) {
+        n = capacity - (tail & queue->mask);
+    }
+    if (n > max) {
+        n = max;
+    }
+
+    *first = &queue->slots[tail & queue->mask];
+
+    return n;
+}
+
+void spsc_release(spsc_s* queue, uint32_t count)
+{
+    queue->tail.store(queue->tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
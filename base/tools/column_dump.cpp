@@ -0,0 +1,56 @@
+/** @file column_dump.cpp
+ *  @brief
+ *
+ *  Host tool which prints readings of columnar file
+ *  written by base station as CSV.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "column.h"
+
+static column_block_s Block;
+
+int main(int argc, char** argv)
+{
+    FILE* fp;
+
+    if (argc != 2 || strcmp(argv[1], "--help") == 0) {
+        printf("Usage: %s FILE\n"
+               "Prints readings of columnar file as CSV.\n", argv[0]);
+        return argc == 2 ? 0 : 1;
+    }
+
+    fp = fopen(argv[1], "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open %s to read!\n", argv[1]);
+        return 1;
+    }
+    if (column_read_header(fp) == false) {
+        fprintf(stderr, "%s is not columnar file!\n", argv[1]);
+        fclose(fp);
+        return 1;
+    }
+
+    printf("time_us,source,mac,round,seq,value\n");
+
+    while (column_read_block(fp, &Block)) {
+        for (uint32_t i = 0; i < Block.count; i++) {
+            const uint8_t* mac = Block.mac[i];
+            uint32_t source = Block.source[i];
+
+            printf("%llu,%u.%u.%u.%u,%02X%02X%02X%02X%02X%02X,%u,%u,%u\n",
+                   (unsigned long long)Block.time_us[i],
+                   source >> 24, (source >> 16) & 0xFF, (source >> 8) & 0xFF, source & 0xFF,
+                   mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+                   Block.round[i], Block.seq[i], Block.value[i]);
+        }
+    }
+
+    fclose(fp);
+
+    return 0;
+}
@@ -0,0 +1,242 @@
+/** @file uplink_send.cpp
+ *  @brief
+ *
+ *  Host tool which plays synthetic fleet of cluster heads
+ *  and sends their uplinks over UDP, as fast as possible
+ *  or at given rate, so base station can be loaded over
+ *  loopback without any node.
+ *
+ *  Every round nodes are split into clusters of --cluster
+ *  nodes, and each cluster sends one uplink with readings
+ *  of all its nodes, raw or delta encoded like firmware
+ *  does. --duplicate sends that share of uplinks twice, as
+ *  cluster heads which retry do.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <thread>
+#include "frame.h"
+#include "delta.h"
+#include "election.h"
+
+/** Most datagrams per sendmmsg().*/
+#define SEND_BATCH              64
+
+/** Largest cluster, uplink of one cluster has to fit in one datagram even
+ *  with largest delta records.*/
+#define MAX_CLUSTER             ((UPLINK_DATAGRAM_SIZE - UPLINK_HEADER_SIZE - DELTA_OVERHEAD) / DELTA_RECORD_MAX)
+
+/**
+ * Options of tool.
+*/
+typedef struct
+{
+    const char* host;                   /**< Address of base station.*/
+    uint16_t    port;                   /**< UDP port of base station.*/
+    uint32_t    nodes;                  /**< Number of nodes in fleet.*/
+    uint32_t    rounds;                 /**< Number of rounds sent.*/
+    uint32_t    cluster;                /**< Nodes per cluster.*/
+    uint32_t    duplicate;              /**< Percent of uplinks sent twice.*/
+    uint32_t    rate;                   /**< Datagrams per second, 0 for as fast as possible.*/
+    bool        raw;                    /**< Send UPLINK_FRAMES_RAW instead of UPLINK_DELTA.*/
+} send_options_s;
+
+static void usage(const char* name)
+{
+    printf("Usage: %s [options]\n"
+           "  --host A           address of base station (default 127.0.0.1)\n"
+           "  --port N           UDP port (default %u)\n"
+           "  --nodes N          nodes in fleet (default 100000)\n"
+           "  --rounds N         rounds to send (default 10)\n"
+           "  --cluster N        nodes per cluster, at most %u (default 20)\n"
+           "  --duplicate P      percent of uplinks sent twice (default 0)\n"
+           "  --rate N           datagrams per second, 0 for no limit (default 0)\n"
+           "  --raw 1            send raw frames instead of delta encoded ones\n",
+           name, UDP_BROADCAST_PORT, (unsigned)MAX_CLUSTER);
+}
+
+static void node_mac(uint32_t id, uint8_t* mac)
+{
+    mac[0] = 0x5C;
+    mac[1] = 0xCF;
+    mac[2] = 0x7F;
+    mac[3] = (id >> 16) & 0xFF;
+    mac[4] = (id >> 8) & 0xFF;
+    mac[5] = id & 0xFF;
+}
+
+static uint16_t node_value(uint32_t id, uint32_t round)
+{
+    // slowly changing level of every node, like simulator sensor.
+    return (300 + (id * 37) % 400 + (round + id) % 7) & 0x3FF;
+}
+
+static size_t build_uplink(uint8_t* buf, const send_options_s* options, uint32_t first, uint32_t count, uint32_t round)
+{
+    uint8_t frames[MAX_CLUSTER * FRAME_SIZE];
+    uint8_t mac[FRAME_MAC_SIZE];
+    uint16_t used;
+
+    for (uint32_t i = 0; i < count; i++) {
+        node_mac(first + i, mac);
+        // rounds wrap as node rounds do, sequence number counts readings.
+        frame_encode(frames + i*FRAME_SIZE, mac, node_value(first + i, round), round % NUMBER_OF_ROUNDS, round & 0xFF);
+    }
+
+    if (options->raw) {
+        uplink_encode_header(buf, 0, 1, count, UPLINK_FRAMES_RAW);
+        memcpy(buf + UPLINK_HEADER_SIZE, frames, count * FRAME_SIZE);
+        return UPLINK_HEADER_SIZE + count * FRAME_SIZE;
+    }
+
+    delta_sort(frames, count);
+    size_t len = delta_encode(buf + UPLINK_HEADER_SIZE, frames, count, round % NUMBER_OF_ROUNDS, &used);
+    uplink_encode_header(buf, 0, 1, used, UPLINK_DELTA);
+
+    return UPLINK_HEADER_SIZE + len;
+}
+
+int main(int argc, char** argv)
+{
+    send_options_s options = {"127.0.0.1", UDP_BROADCAST_PORT, 100000, 10, 20, 0, 0, false};
+    struct sockaddr_in addr;
+    static uint8_t buffers[SEND_BATCH][UPLINK_DATAGRAM_SIZE];
+    struct mmsghdr msgs[SEND_BATCH];
+    struct iovec iovs[SEND_BATCH];
+    uint64_t datagrams = 0;
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint32_t pending = 0;
+    int fd;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0 || value == NULL) {
+            usage(argv[0]);
+            return strcmp(arg, "--help") == 0 ? 0 : 1;
+        }
+        i++;
+
+        if (strcmp(arg, "--host") == 0) {
+            options.host = value;
+        }
+        else if (strcmp(arg, "--port") == 0) {
+            options.port = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--nodes") == 0) {
+            options.nodes = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--rounds") == 0) {
+            options.rounds = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--cluster") == 0) {
+            options.cluster = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--duplicate") == 0) {
+            options.duplicate = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--rate") == 0) {
+            options.rate = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--raw") == 0) {
+            options.raw = strtoul(value, NULL, 10) != 0;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.cluster == 0 || options.cluster > MAX_CLUSTER || options.nodes == 0 || options.nodes > 0xFFFFFF) {
+        fprintf(stderr, "Cluster must be 1 - %u nodes, fleet 1 - 16777215 nodes!\n", (unsigned)MAX_CLUSTER);
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Invalid address %s!\n", options.host);
+        return 1;
+    }
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open socket!\n");
+        return 1;
+    }
+
+    for (int i = 0; i < SEND_BATCH; i++) {
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        iovs[i].iov_base = buffers[i];
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(addr);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32_t round = 0; round < options.rounds; round++) {
+        for (uint32_t first = 0; first < options.nodes; first += options.cluster) {
+            uint32_t count = options.nodes - first < options.cluster ? options.nodes - first : options.cluster;
+            uint32_t copies = (first / options.cluster * 7919 + round) % 100 < options.duplicate ? 2 : 1;
+
+            for (uint32_t c = 0; c < copies; c++) {
+                iovs[pending].iov_len = build_uplink(buffers[pending], &options, first, count, round);
+                bytes += iovs[pending].iov_len;
+                records += count;
+                pending++;
+
+                bool last = round + 1 == options.rounds && first + options.cluster >= options.nodes && c + 1 == copies;
+
+                if (pending == SEND_BATCH || last) {
+                    uint32_t sent = 0;
+
+                    while (sent < pending) {
+                        int r = sendmmsg(fd, msgs + sent, pending - sent, 0);
+
+                        if (r > 0) {
+                            sent += r;
+                        }
+                        else if (errno != EINTR && errno != ENOBUFS) {
+                            fprintf(stderr, "Could not send to %s:%u!\n", options.host, options.port);
+                            return 1;
+                        }
+                    }
+                    datagrams += pending;
+                    pending = 0;
+
+                    if (options.rate != 0) {
+                        std::this_thread::sleep_until(start + std::chrono::microseconds(datagrams * 1000000 / options.rate));
+                    }
+                }
+            }
+        }
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+    close(fd);
+
+    printf("datagrams             %llu\n", (unsigned long long)datagrams);
+    printf("readings              %llu\n", (unsigned long long)records);
+    printf("bytes                 %llu\n", (unsigned long long)bytes);
+    printf("wall time             %.2f s\n", wall.count());
+    printf("readings/s            %.0f\n", wall.count() > 0 ? records / wall.count() : 0.0);
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+/** @file bench.h
+ *  @brief Throughput benchmarks of packet validation and parsing.
+ *
+ *  Packet streams, synthetic or replayed from pcap capture,
+ *  are run through the same code node and base station run:
+ *  SSID check of scan results, frame check and accumulation
+ *  at cluster head, and uplink decoding and ingest at base.
+ *
+ *  Synthetic streams contain malformed (bad CRC), truncated,
+ *  oversized and duplicated packets in given shares, next to
+ *  valid ones.
+ *
+ *  Every benchmark is run like Google Benchmark does: number
+ *  of passes over stream is grown until run takes at least
+ *  minimum time, and time per packet of last run is reported.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/** Base station SSID and length of node SSID, as in includes.h.*/
+#define BENCH_BASE_SSID         "BASE_STATION"
+#define BENCH_NODE_SSID_LENGTH  12
+
+/** Number of distinct nodes in synthetic streams.*/
+#define BENCH_NODES             (1 << 20)
+
+/** Largest packet kept from capture (Ethernet MTU payload).*/
+#define BENCH_MAX_PACKET        1472
+
+/**
+ * Packets back to back in one buffer.
+*/
+typedef struct
+{
+    std::vector<uint8_t>  bytes;        /**< Content of all packets.*/
+    std::vector<uint32_t> offset;       /**< Start of every packet in bytes.*/
+    std::vector<uint16_t> len;          /**< Length of every packet.*/
+} bench_stream_s;
+
+/**
+ * Shares of packets in synthetic streams, in percent.
+*/
+typedef struct
+{
+    uint32_t    packets;                /**< Packets per stream.*/
+    uint64_t    seed;                   /**< Seed of generator.*/
+    uint32_t    malformed;              /**< Packets with corrupted byte.*/
+    uint32_t    truncated;              /**< Packets cut short.*/
+    uint32_t    oversized;              /**< Packets with bytes past valid content.*/
+    uint32_t    duplicated;             /**< Copies of earlier packet.*/
+} bench_mix_s;
+
+/**
+ * Streams benchmarks run over.
+*/
+typedef struct
+{
+    bench_stream_s ssids;               /**< SSIDs from scans, with terminator.*/
+    bench_stream_s hex;                 /**< Node SSID candidates, node SSID length each.*/
+    bench_stream_s frames;              /**< Datagrams stations send to cluster head.*/
+    bench_stream_s uplinks;             /**< Datagrams cluster heads send to base.*/
+} bench_streams_s;
+
+/** Benchmark, runs given number of passes over streams and returns number of packets processed.*/
+typedef uint64_t (*bench_f)(const bench_streams_s* streams, uint64_t passes);
+
+/**
+ * @brief Adds packet to end of stream.
+ * @param stream Pointer to bench_stream_s structure.
+ * @param data Content of packet.
+ * @param len Length of packet.
+ * @return none.
+ */
+void bench_stream_add(bench_stream_s* stream, const uint8_t* data, size_t len);
+
+/**
+ * @brief Fills streams with synthetic packets.
+ * @param streams Pointer to bench_streams_s structure.
+ * @param mix Number of packets and shares of bad ones.
+ * @return none.
+ */
+void bench_generate(bench_streams_s* streams, const bench_mix_s* mix);
+
+/**
+ * @brief Replaces frame and uplink streams with UDP payloads of capture.
+ * Every payload goes to both streams, code under test sorts them out.
+ * @param streams Pointer to bench_streams_s structure.
+ * @param path Path of pcap file (Ethernet, Linux cooked or raw IP).
+ * @param port Only datagrams to this UDP port are taken.
+ * @return Number of datagrams read, -1 if file is not pcap.
+ */
+long bench_read_pcap(bench_streams_s* streams, const char* path, uint16_t port);
+
+/**
+ * @brief Writes frame and uplink streams to pcap file (raw IP), so they
+ * can be inspected or replayed.
+ * @param streams Pointer to bench_streams_s structure.
+ * @param path Path of pcap file.
+ * @param port Destination UDP port of datagrams.
+ * @return false if file could not be written.
+ */
+bool bench_write_pcap(const bench_streams_s* streams, const char* path, uint16_t port);
+
+/**
+ * @brief Runs benchmark until it takes at least min_time_s and prints its line.
+ * @param name Name of benchmark.
+ * @param fn Benchmark.
+ * @param streams Streams to run over.
+ * @param min_time_s Minimum run time.
+ * @return none.
+ */
+void bench_run(const char* name, bench_f fn, const bench_streams_s* streams, double min_time_s);
+
+#endif // BENCH_H_
@@ -0,0 +1,422 @@
+/** @file bench_main.cpp
+ *  @brief
+ *
+ *  Benchmarks of SSID check, frame check and accumulation
+ *  at cluster head, and uplink decoding and ingest at base,
+ *  and command line entry which runs them.
+ *
+ *  Benchmarks named *_ref run code which was replaced by
+ *  faster kernel, so both can be compared on same stream.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "frame.h"
+#include "delta.h"
+#include "aggregate.h"
+#include "hex.h"
+#include "base.h"
+
+/** Frames cluster head can accumulate, as ACCUMULATE_CAPACITY in includes.h.*/
+#define BENCH_ARENA_FRAMES      64
+
+static volatile uint64_t Sink;
+static column_writer_s Writer;
+static base_ingest_s Ingest;
+
+static void usage(const char* name)
+{
+    printf("Usage: %s [options]\n"
+           "  --packets N        packets per synthetic stream (default 100000)\n"
+           "  --seed N           seed of synthetic streams (default 1)\n"
+           "  --malformed P      percent of packets with corrupted byte (default 5)\n"
+           "  --truncated P      percent of packets cut short (default 3)\n"
+           "  --oversized P      percent of packets with extra bytes (default 3)\n"
+           "  --duplicated P     percent of copies of earlier packets (default 4)\n"
+           "  --pcap FILE        replay UDP payloads of capture instead of synthetic frames and uplinks\n"
+           "  --write-pcap FILE  write synthetic frames and uplinks as capture\n"
+           "  --port N           UDP port of capture (default %u)\n"
+           "  --filter TEXT      run only benchmarks whose name contains TEXT\n"
+           "  --min-time S       minimum time of every benchmark (default 0.5)\n",
+           name, UDP_BROADCAST_PORT);
+}
+
+static const uint8_t* packet(const bench_stream_s* stream, size_t i)
+{
+    return stream->bytes.data() + stream->offset[i];
+}
+
+/** SSID check as it was, strcmp(), strlen() and isxdigit() per character.*/
+static bool ssid_is_valid_ref(const char* txt)
+{
+    bool ret = false;
+
+    if (strcmp(txt, BENCH_BASE_SSID) == 0) {
+        ret = true;
+    }
+    else if (strlen(txt) == BENCH_NODE_SSID_LENGTH) {
+        ret = true;
+
+        for (int i = 0; i < BENCH_NODE_SSID_LENGTH; i++) {
+            if (!isxdigit(txt[i])) {
+                ret = false;
+            }
+        }
+    }
+
+    return ret;
+}
+
+static uint64_t ssid_ref(const bench_streams_s* streams, uint64_t passes)
+{
+    const bench_stream_s* s = &streams->ssids;
+    uint64_t valid = 0;
+
+    for (uint64_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < s->len.size(); i++) {
+            valid += ssid_is_valid_ref((const char*)packet(s, i));
+        }
+    }
+    Sink = valid;
+
+    return passes * s->len.size();
+}
+
+static uint64_t ssid_check(const bench_streams_s* streams, uint64_t passes, bool (*check)(const char*, size_t))
+{
+    const bench_stream_s* s = &streams->ssids;
+    uint64_t valid = 0;
+
+    for (uint64_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < s->len.size(); i++) {
+            const char* txt = (const char*)packet(s, i);
+
+            // same order as ssid_is_valid() of firmware.
+            if (strnlen(txt, BENCH_NODE_SSID_LENGTH + 1) == BENCH_NODE_SSID_LENGTH &&
+                check(txt, BENCH_NODE_SSID_LENGTH)) {
+                valid++;
+            }
+            else if (strcmp(txt, BENCH_BASE_SSID) == 0) {
+                valid++;
+            }
+        }
+    }
+    Sink = valid;
+
+    return passes * s->len.size();
+}
+
+static uint64_t ssid_table(const bench_streams_s* streams, uint64_t passes)
+{
+    return ssid_check(streams, passes, hex_is_valid_table);
+}
+
+static uint64_t ssid_swar(const bench_streams_s* streams, uint64_t passes)
+{
+    return ssid_check(streams, passes, hex_is_valid);
+}
+
+static bool hex_is_valid_ref(const char* txt, size_t len)
+{
+    bool ret = true;
+
+    for (size_t i = 0; i < len; i++) {
+        if (!isxdigit(txt[i])) {
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+static uint64_t hex_check(const bench_streams_s* streams, uint64_t passes, bool (*check)(const char*, size_t))
+{
+    const bench_stream_s* s = &streams->hex;
+    uint64_t valid = 0;
+
+    // kernel alone, as base station runs it over many records.
+    for (uint64_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < s->len.size(); i++) {
+            valid += check((const char*)packet(s, i), BENCH_NODE_SSID_LENGTH);
+        }
+    }
+    Sink = valid;
+
+    return passes * s->len.size();
+}
+
+static uint64_t hex_ref(const bench_streams_s* streams, uint64_t passes)
+{
+    return hex_check(streams, passes, hex_is_valid_ref);
+}
+
+static uint64_t hex_table(const bench_streams_s* streams, uint64_t passes)
+{
+    return hex_check(streams, passes, hex_is_valid_table);
+}
+
+static uint64_t hex_swar(const bench_streams_s* streams, uint64_t passes)
+{
+    return hex_check(streams, passes, hex_is_valid);
+}
+
+/** CRC-8 as it was, 8 shifts per byte.*/
+static uint8_t crc8_ref(const uint8_t* data, size_t len)
+{
+    uint8_t crc = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+
+        for (int bit = 0; bit < 8; bit++) {
+            if (crc & 0x80) {
+                crc = (crc << 1) ^ 0x07;
+            }
+            else {
+                crc <<= 1;
+            }
+        }
+    }
+
+    return crc;
+}
+
+static uint64_t frame_check_ref(const bench_streams_s* streams, uint64_t passes)
+{
+    const bench_stream_s* s = &streams->frames;
+    uint64_t valid = 0;
+
+    for (uint64_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < s->len.size(); i++) {
+            const uint8_t* frame = packet(s, i);
+
+            valid += s->len[i] == FRAME_SIZE && crc8_ref(frame, FRAME_CRC_OFFSET) == frame[FRAME_CRC_OFFSET];
+        }
+    }
+    Sink = valid;
+
+    return passes * s->len.size();
+}
+
+static uint64_t frame_check(const bench_streams_s* streams, uint64_t passes)
+{
+    const bench_stream_s* s = &streams->frames;
+    uint64_t valid = 0;
+
+    for (uint64_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < s->len.size(); i++) {
+            // check_if_message_is_valid() of firmware.
+            valid += s->len[i] == FRAME_SIZE && frame_is_valid(packet(s, i), s->len[i]);
+        }
+    }
+    Sink = valid;
+
+    return passes * s->len.size();
+}
+
+static uint64_t frame_accumulate(const bench_streams_s* streams, uint64_t passes)
+{
+    const bench_stream_s* s = &streams->frames;
+    static uint8_t arena[BENCH_ARENA_FRAMES][FRAME_SIZE];
+    aggregate_s aggregate;
+    uint32_t count = 0;
+
+    aggregate_init(&aggregate);
+
+    for (uint64_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < s->len.size(); i++) {
+            const uint8_t* frame = packet(s, i);
+
+            if (s->len[i] != FRAME_SIZE || !frame_is_valid(frame, s->len[i])) {
+                continue;
+            }
+            // arena of one round fills up, cluster head would send it and start again.
+            memcpy(arena[count++ % BENCH_ARENA_FRAMES], frame, FRAME_SIZE);
+            aggregate_add(&aggregate, frame);
+        }
+    }
+    Sink = aggregate.sum + arena[0][0];
+
+    return passes * s->len.size();
+}
+
+static uint64_t uplink_decode(const bench_streams_s* streams, uint64_t passes)
+{
+    const bench_stream_s* s = &streams->uplinks;
+    static uint8_t frames[DELTA_RECORDS_MAX * FRAME_SIZE];
+    uint64_t records = 0;
+
+    for (uint64_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < s->len.size(); i++) {
+            const uint8_t* buf = packet(s, i);
+            size_t len = s->len[i];
+            size_t count = 0;
+
+            if (len > UPLINK_DATAGRAM_SIZE || len < UPLINK_HEADER_SIZE) {
+                continue;
+            }
+            if (uplink_type(buf) == UPLINK_DELTA) {
+                count = delta_decode(buf, len, frames, DELTA_RECORDS_MAX);
+            }
+            else {
+                uplink_frames(buf, len, &count);
+            }
+            records += count;
+        }
+    }
+    Sink = records;
+
+    return passes * s->len.size();
+}
+
+static uint64_t uplink_ingest(const bench_streams_s* streams, uint64_t passes)
+{
+    const bench_stream_s* s = &streams->uplinks;
+    static base_datagram_s datagram;
+
+    for (uint64_t p = 0; p < passes; p++) {
+        // every pass is new capture, readings of earlier pass are not duplicates.
+        dedup_clear(&Ingest.dedup);
+
+        for (size_t i = 0; i < s->len.size(); i++) {
+            // receiver marks datagrams which did not fit in slot with length 0.
+            datagram.len = s->len[i] > UPLINK_DATAGRAM_SIZE ? 0 : s->len[i];
+            memcpy(datagram.data, packet(s, i), datagram.len);
+            base_ingest(&Ingest, &datagram);
+        }
+    }
+    Sink = Ingest.stats.records;
+
+    return passes * s->len.size();
+}
+
+/**
+ * Benchmark and its name.
+*/
+typedef struct
+{
+    const char* name;                   /**< Name, filter matches it.*/
+    bench_f     fn;                     /**< Benchmark.*/
+} bench_case_s;
+
+static const bench_case_s Cases[] = {
+    {"hex/isxdigit_ref", hex_ref},
+    {"hex/table", hex_table},
+    {"hex/swar", hex_swar},
+    {"ssid/isxdigit_ref", ssid_ref},
+    {"ssid/table", ssid_table},
+    {"ssid/swar", ssid_swar},
+    {"frame/check_crc_ref", frame_check_ref},
+    {"frame/check", frame_check},
+    {"frame/check_accumulate", frame_accumulate},
+    {"uplink/decode", uplink_decode},
+    {"uplink/ingest", uplink_ingest},
+};
+
+int main(int argc, char** argv)
+{
+    bench_mix_s mix = {100000, 1, 5, 3, 3, 4};
+    bench_streams_s streams;
+    const char* pcap = NULL;
+    const char* write_pcap = NULL;
+    const char* filter = "";
+    uint16_t port = UDP_BROADCAST_PORT;
+    double min_time_s = 0.5;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0 || value == NULL) {
+            usage(argv[0]);
+            return strcmp(arg, "--help") == 0 ? 0 : 1;
+        }
+        i++;
+
+        if (strcmp(arg, "--packets") == 0) {
+            mix.packets = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--seed") == 0) {
+            mix.seed = strtoull(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--malformed") == 0) {
+            mix.malformed = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--truncated") == 0) {
+            mix.truncated = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--oversized") == 0) {
+            mix.oversized = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--duplicated") == 0) {
+            mix.duplicated = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--pcap") == 0) {
+            pcap = value;
+        }
+        else if (strcmp(arg, "--write-pcap") == 0) {
+            write_pcap = value;
+        }
+        else if (strcmp(arg, "--port") == 0) {
+            port = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--filter") == 0) {
+            filter = value;
+        }
+        else if (strcmp(arg, "--min-time") == 0) {
+            min_time_s = strtod(value, NULL);
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (mix.packets == 0 || mix.malformed + mix.truncated + mix.oversized + mix.duplicated > 100) {
+        fprintf(stderr, "Stream needs packets, and shares of bad packets add up to at most 100!\n");
+        return 1;
+    }
+
+    bench_generate(&streams, &mix);
+
+    if (pcap != NULL) {
+        long count = bench_read_pcap(&streams, pcap, port);
+
+        if (count <= 0) {
+            fprintf(stderr, "No UDP datagrams to port %u in %s!\n", port, pcap);
+            return 1;
+        }
+        printf("replaying %ld datagrams of %s\n", count, pcap);
+    }
+
+    if (write_pcap != NULL && bench_write_pcap(&streams, write_pcap, port) == false) {
+        fprintf(stderr, "Could not write %s!\n", write_pcap);
+        return 1;
+    }
+
+    if (column_open(&Writer, "/dev/null") == false) {
+        fprintf(stderr, "Could not open /dev/null!\n");
+        return 1;
+    }
+    base_ingest_init(&Ingest, &Writer, BENCH_NODES);
+
+    printf("ssids %zu, hex %zu, frames %zu, uplinks %zu\n\n", streams.ssids.len.size(), streams.hex.len.size(),
+           streams.frames.len.size(), streams.uplinks.len.size());
+    printf("%-32s %13s %12s %14s\n", "Benchmark", "Time/packet", "Passes", "Packets/s");
+
+    for (size_t i = 0; i < sizeof(Cases) / sizeof(Cases[0]); i++) {
+        if (strstr(Cases[i].name, filter) != NULL) {
+            bench_run(Cases[i].name, Cases[i].fn, &streams, min_time_s);
+        }
+    }
+
+    column_close(&Writer);
+
+    return 0;
+}
@@ -0,0 +1,49 @@
+/** @file harness.cpp
+ *  @brief
+ *
+ *  This file contains timing loop which runs benchmark
+ *  until it takes long enough to be measured, and prints
+ *  its result.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include "bench.h"
+
+/** Most passes, stops doubling if benchmark is too fast to reach minimum time.*/
+#define MAX_PASSES              (1ULL << 30)
+
+void bench_run(const char* name, bench_f fn, const bench_streams_s* streams, double min_time_s)
+{
+    uint64_t passes = 1;
+    uint64_t items;
+    double elapsed;
+
+    for (;;) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        items = fn(streams, passes);
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (elapsed >= min_time_s || passes >= MAX_PASSES) {
+            break;
+        }
+
+        // aim a bit past minimum time, so next run is usually the last one.
+        if (elapsed > 0) {
+            double factor = 1.4 * min_time_s / elapsed;
+
+            passes = factor > 10 ? passes * 10 : (uint64_t)(passes * factor) + 1;
+        }
+        else {
+            passes *= 10;
+        }
+    }
+
+    printf("%-32s %10.2f ns %12llu %14.0f\n", name, items ? elapsed * 1e9 / items : 0.0,
+           (unsigned long long)passes, elapsed > 0 ? items / elapsed : 0.0);
+    fflush(stdout);
+}
@@ -0,0 +1,422 @@
+/** @file stream.cpp
+ *  @brief
+ *
+ *  This file contains generator of synthetic packet
+ *  streams, and reader and writer of pcap captures.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+#include "frame.h"
+#include "delta.h"
+
+/** pcap magic numbers (us and ns timestamps).*/
+#define PCAP_MAGIC_US           0xA1B2C3D4u
+#define PCAP_MAGIC_NS           0xA1B23C4Du
+
+/** pcap link types.*/
+#define LINKTYPE_ETHERNET       1
+#define LINKTYPE_RAW            101
+#define LINKTYPE_LINUX_SLL      113
+
+/** Largest cluster of synthetic uplink.*/
+#define GEN_MAX_CLUSTER         20
+
+/** Categories of generated packet.*/
+typedef enum
+{
+    GEN_VALID,
+    GEN_MALFORMED,
+    GEN_TRUNCATED,
+    GEN_OVERSIZED,
+    GEN_DUPLICATED
+} gen_kind_e;
+
+static uint64_t next_random(uint64_t* state)
+{
+    // xorshift64*, fast and good enough for test data.
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static uint32_t uniform(uint64_t* state, uint32_t n)
+{
+    return (next_random(state) >> 32) % n;
+}
+
+static gen_kind_e pick_kind(uint64_t* rng, const bench_mix_s* mix, size_t count)
+{
+    uint32_t r = uniform(rng, 100);
+
+    if (r < mix->malformed) {
+        return GEN_MALFORMED;
+    }
+    r -= mix->malformed;
+    if (r < mix->truncated) {
+        return GEN_TRUNCATED;
+    }
+    r -= mix->truncated;
+    if (r < mix->oversized) {
+        return GEN_OVERSIZED;
+    }
+    r -= mix->oversized;
+    if (r < mix->duplicated && count > 0) {
+        return GEN_DUPLICATED;
+    }
+
+    return GEN_VALID;
+}
+
+static void node_mac(uint64_t* rng, uint8_t* mac)
+{
+    uint32_t id = uniform(rng, BENCH_NODES);
+
+    mac[0] = 0x5C;
+    mac[1] = 0xCF;
+    mac[2] = 0x7F;
+    mac[3] = id >> 16;
+    mac[4] = id >> 8;
+    mac[5] = id;
+}
+
+static void add_copy(bench_stream_s* stream, uint64_t* rng)
+{
+    uint32_t i = uniform(rng, stream->len.size());
+    std::vector<uint8_t> copy(stream->bytes.begin() + stream->offset[i],
+                              stream->bytes.begin() + stream->offset[i] + stream->len[i]);
+
+    bench_stream_add(stream, copy.data(), copy.size());
+}
+
+static void generate_ssids(bench_stream_s* stream, uint64_t* rng, const bench_mix_s* mix)
+{
+    static const char* const Foreign[] = {"Linksys-2G", "eduroam", "FRITZ!Box 7590", "HP-Print-3F",
+                                          "", "ESP_1A2B3C", "guest", "DIRECT-xy-Android"};
+    static const char Hex[] = "0123456789ABCDEF";
+
+    for (uint32_t n = 0; n < mix->packets; n++) {
+        gen_kind_e kind = pick_kind(rng, mix, stream->len.size());
+        char ssid[33];
+        size_t len = BENCH_NODE_SSID_LENGTH;
+        uint32_t r = uniform(rng, 10);
+
+        if (kind == GEN_DUPLICATED) {
+            add_copy(stream, rng);
+            continue;
+        }
+
+        if (kind == GEN_VALID && r == 0) {
+            bench_stream_add(stream, (const uint8_t*)BENCH_BASE_SSID, sizeof(BENCH_BASE_SSID));
+            continue;
+        }
+        if (kind == GEN_VALID && r < 4) {
+            const char* name = Foreign[uniform(rng, sizeof(Foreign) / sizeof(Foreign[0]))];
+
+            bench_stream_add(stream, (const uint8_t*)name, strlen(name) + 1);
+            continue;
+        }
+
+        if (kind == GEN_TRUNCATED) {
+            len = uniform(rng, BENCH_NODE_SSID_LENGTH);
+        }
+        else if (kind == GEN_OVERSIZED) {
+            len = BENCH_NODE_SSID_LENGTH + 1 + uniform(rng, 32 - BENCH_NODE_SSID_LENGTH);
+        }
+        for (size_t i = 0; i < len; i++) {
+            ssid[i] = Hex[uniform(rng, 16)];
+        }
+        if (kind == GEN_MALFORMED) {
+            ssid[uniform(rng, len)] = "GZ:-_ g"[uniform(rng, 7)];
+        }
+        ssid[len] = '\0';
+
+        bench_stream_add(stream, (const uint8_t*)ssid, len + 1);
+    }
+}
+
+static void generate_hex(bench_stream_s* stream, uint64_t* rng, const bench_mix_s* mix)
+{
+    static const char Hex[] = "0123456789ABCDEFabcdef";
+
+    for (uint32_t n = 0; n < mix->packets; n++) {
+        char txt[BENCH_NODE_SSID_LENGTH];
+
+        for (size_t i = 0; i < sizeof(txt); i++) {
+            txt[i] = Hex[uniform(rng, 22)];
+        }
+        if (uniform(rng, 100) < mix->malformed) {
+            txt[uniform(rng, sizeof(txt))] = "GZ:-_ g\x80"[uniform(rng, 8)];
+        }
+
+        bench_stream_add(stream, (const uint8_t*)txt, sizeof(txt));
+    }
+}
+
+static void damage(uint8_t* buf, size_t* len, gen_kind_e kind, uint64_t* rng)
+{
+    if (kind == GEN_MALFORMED) {
+        buf[uniform(rng, *len)] ^= 1 + uniform(rng, 255);
+    }
+    else if (kind == GEN_TRUNCATED) {
+        *len = uniform(rng, *len);
+    }
+    else if (kind == GEN_OVERSIZED) {
+        size_t extra = 1 + uniform(rng, BENCH_MAX_PACKET - *len);
+
+        for (size_t i = 0; i < extra; i++) {
+            buf[*len + i] = next_random(rng);
+        }
+        *len += extra;
+    }
+}
+
+static void generate_frames(bench_stream_s* stream, uint64_t* rng, const bench_mix_s* mix)
+{
+    uint8_t buf[BENCH_MAX_PACKET];
+
+    for (uint32_t n = 0; n < mix->packets; n++) {
+        gen_kind_e kind = pick_kind(rng, mix, stream->len.size());
+        uint8_t mac[FRAME_MAC_SIZE];
+        size_t len;
+
+        if (kind == GEN_DUPLICATED) {
+            add_copy(stream, rng);
+            continue;
+        }
+
+        node_mac(rng, mac);
+        len = frame_encode(buf, mac, uniform(rng, 1024), n / 1000, uniform(rng, 8) == 0);
+        damage(buf, &len, kind, rng);
+        bench_stream_add(stream, buf, len);
+    }
+}
+
+static void generate_uplinks(bench_stream_s* stream, uint64_t* rng, const bench_mix_s* mix)
+{
+    uint8_t frames[GEN_MAX_CLUSTER * FRAME_SIZE];
+    uint8_t buf[BENCH_MAX_PACKET];
+
+    for (uint32_t n = 0; n < mix->packets; n++) {
+        gen_kind_e kind = pick_kind(rng, mix, stream->len.size());
+        uint32_t count = 1 + uniform(rng, GEN_MAX_CLUSTER);
+        uint8_t round = n / 1000;
+        size_t len;
+
+        if (kind == GEN_DUPLICATED) {
+            add_copy(stream, rng);
+            continue;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint8_t mac[FRAME_MAC_SIZE];
+
+            node_mac(rng, mac);
+            frame_encode(frames + i*FRAME_SIZE, mac, 300 + uniform(rng, 400), round, 0);
+        }
+
+        if (uniform(rng, 2) == 0) {
+            uplink_encode_header(buf, 0, 1, count, UPLINK_FRAMES_RAW);
+            memcpy(buf + UPLINK_HEADER_SIZE, frames, count * FRAME_SIZE);
+            len = UPLINK_HEADER_SIZE + count * FRAME_SIZE;
+        }
+        else {
+            uint16_t used;
+
+            delta_sort(frames, count);
+            len = UPLINK_HEADER_SIZE + delta_encode(buf + UPLINK_HEADER_SIZE, frames, count, round, &used);
+            uplink_encode_header(buf, 0, 1, used, UPLINK_DELTA);
+        }
+
+        damage(buf, &len, kind, rng);
+        bench_stream_add(stream, buf, len);
+    }
+}
+
+void bench_stream_add(bench_stream_s* stream, const uint8_t* data, size_t len)
+{
+    stream->offset.push_back(stream->bytes.size());
+    stream->len.push_back(len);
+    stream->bytes.insert(stream->bytes.end(), data, data + len);
+}
+
+void bench_generate(bench_streams_s* streams, const bench_mix_s* mix)
+{
+    uint64_t rng = mix->seed * 0x9E3779B97F4A7C15ULL + 1;
+
+    generate_ssids(&streams->ssids, &rng, mix);
+    generate_hex(&streams->hex, &rng, mix);
+    generate_frames(&streams->frames, &rng, mix);
+    generate_uplinks(&streams->uplinks, &rng, mix);
+}
+
+static uint32_t read_u32(const uint8_t* buf, bool swap)
+{
+    uint32_t value;
+
+    memcpy(&value, buf, sizeof(value));
+
+    return swap ? __builtin_bswap32(value) : value;
+}
+
+static const uint8_t* udp_payload(const uint8_t* pkt, size_t caplen, uint32_t linktype, uint16_t port, size_t* len)
+{
+    size_t ip = 0;
+    size_t ihl;
+    size_t udp_len;
+
+    if (linktype == LINKTYPE_ETHERNET) {
+        uint16_t type;
+
+        if (caplen < 14) {
+            return NULL;
+        }
+        type = pkt[12] << 8 | pkt[13];
+        ip = 14;
+        if (type == 0x8100 && caplen >= 18) {
+            type = pkt[16] << 8 | pkt[17];
+            ip = 18;
+        }
+        if (type != 0x0800) {
+            return NULL;
+        }
+    }
+    else if (linktype == LINKTYPE_LINUX_SLL) {
+        if (caplen < 16 || (pkt[14] << 8 | pkt[15]) != 0x0800) {
+            return NULL;
+        }
+        ip = 16;
+    }
+    else if (linktype != LINKTYPE_RAW) {
+        return NULL;
+    }
+
+    if (caplen < ip + 20 || (pkt[ip] >> 4) != 4 || pkt[ip + 9] != 17) {
+        return NULL;
+    }
+    ihl = (pkt[ip] & 0x0F) * 4;
+    if (caplen < ip + ihl + 8 || (pkt[ip + ihl + 2] << 8 | pkt[ip + ihl + 3]) != port) {
+        return NULL;
+    }
+
+    udp_len = pkt[ip + ihl + 4] << 8 | pkt[ip + ihl + 5];
+    if (udp_len < 8) {
+        return NULL;
+    }
+    *len = udp_len - 8;
+    // snap length may have cut payload, take what was captured.
+    if (*len > caplen - ip - ihl - 8) {
+        *len = caplen - ip - ihl - 8;
+    }
+
+    return pkt + ip + ihl + 8;
+}
+
+long bench_read_pcap(bench_streams_s* streams, const char* path, uint16_t port)
+{
+    FILE* fp = fopen(path, "rb");
+    uint8_t header[24];
+    uint8_t record[16];
+    std::vector<uint8_t> pkt;
+    uint32_t linktype;
+    bool swap;
+    long count = 0;
+
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header)) {
+        fclose(fp);
+        return -1;
+    }
+
+    swap = read_u32(header, false) != PCAP_MAGIC_US && read_u32(header, false) != PCAP_MAGIC_NS;
+    if (swap && read_u32(header, true) != PCAP_MAGIC_US && read_u32(header, true) != PCAP_MAGIC_NS) {
+        fclose(fp);
+        return -1;
+    }
+    linktype = read_u32(header + 20, swap) & 0xFFFF;
+
+    streams->frames = bench_stream_s();
+    streams->uplinks = bench_stream_s();
+
+    while (fread(record, 1, sizeof(record), fp) == sizeof(record)) {
+        uint32_t caplen = read_u32(record + 8, swap);
+        const uint8_t* payload;
+        size_t len;
+
+        pkt.resize(caplen);
+        if (fread(pkt.data(), 1, caplen, fp) != caplen) {
+            break;
+        }
+
+        payload = udp_payload(pkt.data(), caplen, linktype, port, &len);
+        if (payload == NULL) {
+            continue;
+        }
+        if (len > BENCH_MAX_PACKET) {
+            len = BENCH_MAX_PACKET;
+        }
+
+        bench_stream_add(&streams->frames, payload, len);
+        bench_stream_add(&streams->uplinks, payload, len);
+        count++;
+    }
+
+    fclose(fp);
+
+    return count;
+}
+
+static bool write_stream(FILE* fp, const bench_stream_s* stream, uint32_t dst, uint16_t port)
+{
+    for (size_t i = 0; i < stream->len.size(); i++) {
+        uint32_t len = stream->len[i];
+        uint32_t record[4] = {(uint32_t)(i / 1000), (uint32_t)(i % 1000) * 1000, len + 28, len + 28};
+        uint8_t ip[28] = {0x45, 0, 0, 0, 0, 0, 0x40, 0, 64, 17, 0, 0,
+                          192, 168, 4, 2, 0, 0, 0, 0,
+                          0xC3, 0x50, 0, 0, 0, 0, 0, 0};
+
+        ip[2] = (len + 28) >> 8;
+        ip[3] = len + 28;
+        ip[16] = dst >> 24;
+        ip[17] = dst >> 16;
+        ip[18] = dst >> 8;
+        ip[19] = dst;
+        ip[22] = port >> 8;
+        ip[23] = port;
+        ip[24] = (len + 8) >> 8;
+        ip[25] = len + 8;
+
+        if (fwrite(record, sizeof(record), 1, fp) != 1 || fwrite(ip, sizeof(ip), 1, fp) != 1 ||
+            fwrite(stream->bytes.data() + stream->offset[i], 1, len, fp) != len) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool bench_write_pcap(const bench_streams_s* streams, const char* path, uint16_t port)
+{
+    uint32_t header[6] = {PCAP_MAGIC_US, 0x00040002, 0, 0, 65535, LINKTYPE_RAW};
+    FILE* fp = fopen(path, "wb");
+    bool ok;
+
+    if (fp == NULL) {
+        return false;
+    }
+
+    // stations send to cluster head, cluster heads to broadcast of base network.
+    ok = fwrite(header, sizeof(header), 1, fp) == 1 &&
+         write_stream(fp, &streams->frames, 0xC0A80401, port) &&
+         write_stream(fp, &streams->uplinks, 0xC0A801FF, port);
+
+    return fclose(fp) == 0 && ok;
+}
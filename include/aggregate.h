@@ -0,0 +1,167 @@
+/** @file aggregate.h
+ *  @brief Aggregation of station readings at cluster head.
+ *
+ *  Which aggregation cluster head does is selected at
+ *  compile time with AGGREGATION:
+ *
+ *  - AGGREGATE_NONE: frames of all stations are sent to
+ *    base as they are (record arena).
+ *  - AGGREGATE_SUMMARY: every frame is folded into count,
+ *    minimum, maximum and sum of ADC values, and one
+ *    summary record is sent to base.
+ *  - AGGREGATE_HISTOGRAM: like summary, plus number of
+ *    readings in each of AGGREGATE_BINS equal ADC ranges.
+ *
+ *  Summary record (multi-byte fields little endian):
+ *
+ *  | offset | size | field                          |
+ *  |--------|------|--------------------------------|
+ *  | 0      | 6    | MAC address of cluster head    |
+ *  | 6      | 1    | round                          |
+ *  | 7      | 2    | number of readings             |
+ *  | 9      | 2    | minimum ADC value              |
+ *  | 11     | 2    | maximum ADC value              |
+ *  | 13     | 4    | sum of ADC values              |
+ *  | 17     | 2*B  | histogram bins (histogram only)|
+ *  | last   | 1    | CRC-8 of all previous bytes    |
+ *
+ *  Size of uplink is then the same for any cluster size.
+ *
+ *  This file does not depend on Arduino, so base station
+ *  and host tools can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef AGGREGATE_H_
+#define AGGREGATE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame.h"
+#include "sample.h"
+
+/** Aggregation kinds.*/
+#define AGGREGATE_NONE          0
+#define AGGREGATE_SUMMARY       1
+#define AGGREGATE_HISTOGRAM     2
+
+/** Aggregation done by cluster head.*/
+#ifndef AGGREGATION
+#define AGGREGATION             AGGREGATE_NONE
+#endif
+
+/** Number of histogram bins.*/
+#define AGGREGATE_BINS          8
+
+/** Number of possible readings (SAMPLE_BITS bits).*/
+#define ADC_RANGE               (1u << SAMPLE_BITS)
+
+/** Offsets of summary record fields.*/
+#define SUMMARY_ROUND_OFFSET    6
+#define SUMMARY_COUNT_OFFSET    7
+#define SUMMARY_MIN_OFFSET      9
+#define SUMMARY_MAX_OFFSET      11
+#define SUMMARY_SUM_OFFSET      13
+#define SUMMARY_BINS_OFFSET     17
+
+/** Size of summary record.*/
+#define SUMMARY_SIZE            (SUMMARY_BINS_OFFSET + 1)
+
+/** Size of histogram record.*/
+#define HISTOGRAM_SIZE          (SUMMARY_BINS_OFFSET + 2*AGGREGATE_BINS + 1)
+
+/**
+ * Running aggregate of ADC values.
+*/
+typedef struct
+{
+    uint16_t    count;                  /**< Number of readings.*/
+    uint16_t    min;                    /**< Minimum ADC value.*/
+    uint16_t    max;                    /**< Maximum ADC value.*/
+    uint32_t    sum;                    /**< Sum of ADC values.*/
+#if AGGREGATION == AGGREGATE_HISTOGRAM
+    uint16_t    bins[AGGREGATE_BINS];   /**< Number of readings per ADC range.*/
+#endif
+} aggregate_s;
+
+/**
+ * @brief Empties aggregate.
+ * @param aggregate Pointer to aggregate_s structure.
+ * @return none.
+ */
+void aggregate_init(aggregate_s* aggregate);
+
+/**
+ * @brief Folds ADC value of frame into aggregate.
+ * @param aggregate Pointer to aggregate_s structure.
+ * @param frame Valid frame.
+ * @return none.
+ */
+void aggregate_add(aggregate_s* aggregate, const uint8_t* frame);
+
+/**
+ * @brief Folds summary or histogram record of other cluster head into
+ * aggregate (MULTI_HOP), as if its readings were added one by one.
+ * @param aggregate Pointer to aggregate_s structure.
+ * @param record Valid record of type selected with AGGREGATION.
+ * @return none.
+ */
+void aggregate_merge(aggregate_s* aggregate, const uint8_t* record);
+
+/**
+ * @brief Writes record of aggregate selected with AGGREGATION.
+ * @param buf Buffer with at least HISTOGRAM_SIZE free bytes.
+ * @param aggregate Pointer to aggregate_s structure.
+ * @param mac MAC address of cluster head.
+ * @param round Current round.
+ * @return Number of bytes written.
+ */
+size_t aggregate_encode(uint8_t* buf, const aggregate_s* aggregate, const uint8_t* mac, uint8_t round);
+
+/**
+ * @brief Checks size and CRC of summary or histogram record.
+ * @param buf Start of record.
+ * @param len Bytes available from buf.
+ * @param type UPLINK_SUMMARY or UPLINK_HISTOGRAM.
+ * @return true if record is valid.
+ */
+bool summary_is_valid(const uint8_t* buf, size_t len, uint8_t type);
+
+/**
+ * @brief Returns number of readings in summary record.
+ * @param record Start of valid record.
+ * @return Number of readings.
+ */
+uint16_t summary_count(const uint8_t* record);
+
+/**
+ * @brief Returns minimum ADC value of summary record.
+ * @param record Start of valid record.
+ * @return Minimum ADC value.
+ */
+uint16_t summary_min(const uint8_t* record);
+
+/**
+ * @brief Returns maximum ADC value of summary record.
+ * @param record Start of valid record.
+ * @return Maximum ADC value.
+ */
+uint16_t summary_max(const uint8_t* record);
+
+/**
+ * @brief Returns sum of ADC values of summary record.
+ * @param record Start of valid record.
+ * @return Sum of ADC values.
+ */
+uint32_t summary_sum(const uint8_t* record);
+
+/**
+ * @brief Returns number of readings in histogram bin.
+ * @param record Start of valid histogram record.
+ * @param bin Bin index, 0 - AGGREGATE_BINS-1.
+ * @return Number of readings.
+ */
+uint16_t summary_bin(const uint8_t* record, uint8_t bin);
+
+#endif // AGGREGATE_H_
@@ -0,0 +1,144 @@
+/** @file batch.h
+ *  @brief Readings held by station over several rounds.
+ *
+ *  Scan and association cost station more than all the
+ *  rest of its round. With STATION_BATCH station takes its
+ *  reading on every wake up, but keeps it in ring buffer in
+ *  RTC memory and goes back to sleep with radio off. Radio
+ *  is brought up when:
+ *
+ *  - BATCH_ROUNDS readings are held, or
+ *  - reading moved more than BATCH_THRESHOLD from the last
+ *    one network got, so changes are not held back, or
+ *  - nothing was sent since cold boot.
+ *
+ *  All held readings then go to cluster head in one
+ *  datagram, frames (see frame.h) of the same MAC back to
+ *  back, oldest first. Every frame carries round and
+ *  sequence number of its own reading, so frames of one
+ *  datagram never repeat MAC, round and sequence number
+ *  even when they span wrap of round, and cluster head and
+ *  base station take them in order of readings. Buffer
+ *  holds fewer readings than DEDUP_LATE_WINDOW, so resent
+ *  ones are always found late (see dedup.h).
+ *
+ *  Readings which could not be sent stay in buffer for the
+ *  next round. When buffer is full the oldest reading is
+ *  overwritten.
+ *
+ *  Node which becomes cluster head puts held readings into
+ *  its own uplink, and keeps them until uplink was sent.
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame.h"
+#include "dedup.h"
+
+/** This flag will make station hold readings and send them
+ *  every BATCH_ROUNDS rounds.
+*/
+#ifndef STATION_BATCH
+#define STATION_BATCH           0
+#endif
+
+/** Number of readings station sends together.*/
+#ifndef BATCH_ROUNDS
+#define BATCH_ROUNDS            4
+#endif
+
+/** Change of ADC value from the last sent one which is sent at once.*/
+#ifndef BATCH_THRESHOLD
+#define BATCH_THRESHOLD         32
+#endif
+
+/** Most readings held, older ones are overwritten.*/
+#define BATCH_CAPACITY          16
+
+#if BATCH_ROUNDS < 1 || BATCH_ROUNDS > BATCH_CAPACITY
+#error "BATCH_ROUNDS must be between 1 and 16."
+#endif
+
+#if BATCH_CAPACITY > DEDUP_LATE_WINDOW
+#error "BATCH_CAPACITY must not exceed DEDUP_LATE_WINDOW."
+#endif
+
+/** Largest station datagram.*/
+#define BATCH_DATAGRAM_SIZE     (BATCH_CAPACITY * FRAME_SIZE)
+
+/**
+ * Held readings as kept in RTC memory.
+*/
+typedef struct
+{
+    uint32_t    crc;                    /**< CRC-8 of rest of structure.*/
+    uint16_t    adc[BATCH_CAPACITY];    /**< ADC values, ring buffer.*/
+    uint8_t     round[BATCH_CAPACITY];  /**< Rounds of ADC values.*/
+    uint8_t     seq[BATCH_CAPACITY];    /**< Sequence numbers of ADC values.*/
+    uint8_t     head;                   /**< Index of oldest reading.*/
+    uint8_t     count;                  /**< Number of held readings.*/
+    uint16_t    sent_adc;               /**< ADC value of last sent reading.*/
+    uint8_t     sent;                   /**< Non zero once reading was sent.*/
+    uint8_t     overwritten;            /**< Readings lost to full buffer, saturates.*/
+} batch_s;
+
+/**
+ * @brief Empties buffer, as after cold boot.
+ * @param batch Pointer to batch_s structure.
+ * @return none.
+ */
+void batch_init(batch_s* batch);
+
+/**
+ * @brief Adds reading, overwrites oldest one if buffer is full.
+ * @param batch Pointer to batch_s structure.
+ * @param adc ADC value.
+ * @param round Round of reading.
+ * @param seq Sequence number of reading.
+ * @return none.
+ */
+void batch_add(batch_s* batch, uint16_t adc, uint8_t round, uint8_t seq);
+
+/**
+ * @brief Decides if held readings have to be sent in this round.
+ * @param batch Pointer to batch_s structure.
+ * @param adc Newest ADC value.
+ * @return true if radio has to be brought up.
+ */
+bool batch_due(const batch_s* batch, uint16_t adc);
+
+/**
+ * @brief Writes held readings as frames, oldest first.
+ * @param buf Buffer with at least BATCH_DATAGRAM_SIZE free bytes.
+ * @param batch Pointer to batch_s structure.
+ * @param mac MAC address of node.
+ * @return Number of bytes written.
+ */
+size_t batch_encode(uint8_t* buf, const batch_s* batch, const uint8_t* mac);
+
+/**
+ * @brief Empties buffer after readings were sent.
+ * @param batch Pointer to batch_s structure.
+ * @param adc ADC value network got last.
+ * @return none.
+ */
+void batch_sent(batch_s* batch, uint16_t adc);
+
+/**
+ * @brief Counts frames of station datagram: whole number of
+ * valid frames, all of the same MAC address.
+ * @param buf Received datagram.
+ * @param len Length of datagram.
+ * @return Number of frames, 0 if datagram is not valid.
+ */
+size_t batch_frames(const uint8_t* buf, size_t len);
+
+#endif // BATCH_H_
@@ -0,0 +1,79 @@
+/** @file channel.h
+ *  @brief WiFi channel of cluster head soft AP.
+ *
+ *  With one channel all clusters share one collision
+ *  domain, and station uploads of one cluster compete
+ *  with those and beacons of every cluster around it.
+ *  CLUSTER_CHANNELS selects set of channels (bit n is
+ *  channel n), and cluster head picks one of them from
+ *  hash of its MAC and round, so neighbouring clusters
+ *  mostly end up on different channels and pairs which
+ *  collide change from round to round.
+ *
+ *  Nothing is announced: station learns channel of
+ *  cluster head from scan, as it learns its BSSID. Scan
+ *  goes over SCAN_CHANNELS one channel at a time, so every
+ *  channel of set costs radio time of one channel scan,
+ *  instead of scan of all 13. Base station stays on
+ *  WIFI_CHANNEL, which is always scanned.
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef CHANNEL_H_
+#define CHANNEL_H_
+
+#include <stdint.h>
+
+/** Channels cluster heads pick from, bit n is channel n. For
+ *  example 0x0842 is non-overlapping set 1, 6 and 11.
+*/
+#ifndef CLUSTER_CHANNELS
+#define CLUSTER_CHANNELS        0x0002
+#endif
+
+#if CLUSTER_CHANNELS == 0 || (CLUSTER_CHANNELS & ~0x3FFE) != 0
+#error "CLUSTER_CHANNELS must select channels between 1 and 13."
+#endif
+
+/** WiFi channel of base station, and of cluster heads unless
+ *  CLUSTER_CHANNELS gives others.
+*/
+#define WIFI_CHANNEL            1
+
+/** Channels stations and cluster heads scan, bit n is channel n.*/
+#define SCAN_CHANNELS           (CLUSTER_CHANNELS | 1 << WIFI_CHANNEL)
+
+/**
+ * @brief Counts channels in set.
+ * @param channels Set of channels, bit n is channel n.
+ * @return Number of channels.
+ */
+constexpr uint8_t channel_count(uint16_t channels)
+{
+    return channels == 0 ? 0 : (channels & 1) + channel_count(channels >> 1);
+}
+
+/**
+ * @brief Hashes MAC and round (FNV-1a). Nodes do not know each
+ *        other, so picks which should differ between them and
+ *        change from round to round come from it (channel of
+ *        cluster head, TDMA slot of station).
+ * @param mac MAC address of node, 6 bytes.
+ * @param round Round of node.
+ * @return Hash, high and low 16 bits can be used as two picks.
+ */
+uint32_t channel_hash(const uint8_t* mac, uint8_t round);
+
+/**
+ * @brief Picks channel of cluster head soft AP.
+ * @param mac MAC address of cluster head, 6 bytes.
+ * @param round Round of cluster head.
+ * @return Channel from CLUSTER_CHANNELS.
+ */
+uint8_t channel_select(const uint8_t* mac, uint8_t round);
+
+#endif // CHANNEL_H_
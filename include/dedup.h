@@ -0,0 +1,134 @@
+/** @file dedup.h
+ *  @brief Duplicate suppression of frames by MAC address.
+ *
+ *  Frame of station can arrive more than once: station
+ *  retransmits it, broadcast is heard twice, or overlapping
+ *  cluster heads forward the same reading to base station.
+ *
+ *  Table keeps (round, sequence number) of last frame of
+ *  every MAC address in fixed array of slots, with open
+ *  addressing and linear probing. Slots are given by caller
+ *  (static storage on node, one allocation at start of base
+ *  station), table itself never allocates.
+ *
+ *  Rounds wrap at NUMBER_OF_ROUNDS, so only sequence
+ *  number, number of reading which node keeps over deep
+ *  sleep (see state.h), orders frames. It is 8-bit and
+ *  wraps too, so it is compared as signed difference
+ *  (serial number order). Frame is:
+ *  - new, if MAC was not seen, or its seq is past last one,
+ *    or more than DEDUP_LATE_WINDOW before it (node
+ *    restarted, or was not heard for long),
+ *  - duplicate, if (round, seq) equals last one,
+ *  - late, if seq is at most DEDUP_LATE_WINDOW before last one.
+ *
+ *  Every slot counts received, duplicated and late frames of
+ *  its station. Table takes stations until 3/4 of slots are
+ *  used, so probes stay short, frames of new MAC addresses
+ *  past that are let through as new and counted as overflow.
+ *
+ *  This file does not depend on Arduino, so base station
+ *  and host tools can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef DEDUP_H_
+#define DEDUP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame.h"
+
+/** Readings node can hold back (see batch.h) and resend, older
+ *  sequence numbers are taken as new.
+*/
+#ifndef DEDUP_LATE_WINDOW
+#define DEDUP_LATE_WINDOW       64
+#endif
+
+#if DEDUP_LATE_WINDOW < 1 || DEDUP_LATE_WINDOW > 127
+#error "DEDUP_LATE_WINDOW must be between 1 and 127."
+#endif
+
+/**
+ * Last frame and counters of one station.
+*/
+typedef struct
+{
+    uint8_t     mac[FRAME_MAC_SIZE];    /**< MAC address of station.*/
+    uint8_t     round;                  /**< Round of last new frame.*/
+    uint8_t     seq;                    /**< Sequence number of last new frame.*/
+    uint8_t     used;                   /**< Non zero if slot holds station.*/
+    uint16_t    received;               /**< Frames received, duplicated and late included.*/
+    uint16_t    duplicated;             /**< Frames equal to last new one.*/
+    uint16_t    late;                   /**< Frames older than last new one.*/
+} dedup_entry_s;
+
+/**
+ * Table of stations.
+*/
+typedef struct
+{
+    dedup_entry_s* slots;               /**< Slots, given by caller.*/
+    uint32_t    mask;                   /**< Number of slots - 1.*/
+    uint8_t     shift;                  /**< 32 - log2 of number of slots.*/
+    uint32_t    count;                  /**< Stations in table.*/
+    uint32_t    received;               /**< Frames checked.*/
+    uint32_t    duplicated;             /**< Frames found to be duplicates.*/
+    uint32_t    late;                   /**< Frames found to be late.*/
+    uint32_t    overflow;               /**< Frames of new stations which did not fit.*/
+} dedup_s;
+
+/**
+ * Result of frame check.
+*/
+typedef enum
+{
+    DEDUP_NEW,
+    DEDUP_DUPLICATE,
+    DEDUP_LATE
+} dedup_result_e;
+
+/**
+ * @brief Returns number of slots for given number of stations,
+ * power of two which keeps table at most half full.
+ * @param stations Most stations table should hold.
+ * @return Number of slots.
+ */
+uint32_t dedup_capacity(uint32_t stations);
+
+/**
+ * @brief Sets up empty table over given slots.
+ * @param table Pointer to dedup_s structure.
+ * @param slots Storage of slots.
+ * @param capacity Number of slots, power of two, at least 2.
+ * @return none.
+ */
+void dedup_init(dedup_s* table, dedup_entry_s* slots, uint32_t capacity);
+
+/**
+ * @brief Removes all stations and counters from table.
+ * @param table Pointer to dedup_s structure.
+ * @return none.
+ */
+void dedup_clear(dedup_s* table);
+
+/**
+ * @brief Checks frame against last frame of its station, and
+ * remembers it if it is new.
+ * @param table Pointer to dedup_s structure.
+ * @param frame Start of valid frame.
+ * @return DEDUP_NEW, DEDUP_DUPLICATE or DEDUP_LATE.
+ */
+dedup_result_e dedup_check(dedup_s* table, const uint8_t* frame);
+
+/**
+ * @brief Finds station in table.
+ * @param table Pointer to dedup_s structure.
+ * @param mac MAC address of station.
+ * @return Pointer to slot of station, NULL if it is not in table.
+ */
+const dedup_entry_s* dedup_find(const dedup_s* table, const uint8_t* mac);
+
+#endif // DEDUP_H_
@@ -0,0 +1,116 @@
+/** @file delta.h
+ *  @brief Compressed uplink of accumulated frames.
+ *
+ *  With UPLINK_COMPRESSION cluster head does not send
+ *  frames it collected as they are, but sorted by MAC
+ *  and delta encoded, record by record:
+ *
+ *  | field     | encoding                                  |
+ *  |-----------|-------------------------------------------|
+ *  | MAC       | varint of MAC - MAC of previous record    |
+ *  | ADC value | ZigZag varint of value - previous value   |
+ *  | round/seq | varint of ZigZag(round - base) << 8 | seq |
+ *
+ *  MAC is taken as 48-bit big endian number, so sorted
+ *  MACs give small positive deltas, and nodes of same
+ *  vendor share upper bytes. Varint is 7 bits per byte,
+ *  least significant first, top bit set when more bytes
+ *  follow.
+ *
+ *  Every DELTA_KEYFRAME-th record of datagram (first one
+ *  included) is keyframe, its MAC and value are deltas
+ *  from zero. Every datagram then decodes on its own, and
+ *  corrupted record cannot spoil more than DELTA_KEYFRAME
+ *  records after it.
+ *
+ *  Datagram (type UPLINK_DELTA) after uplink header:
+ *
+ *  | offset | size | field                          |
+ *  |--------|------|--------------------------------|
+ *  | 0      | 1    | base round                     |
+ *  | 1      | n    | records                        |
+ *  | 1 + n  | 1    | CRC-8 of all previous bytes    |
+ *
+ *  Cluster head changes every round, so it has no
+ *  earlier values of its stations to delta against,
+ *  deltas are between neighbouring records instead.
+ *
+ *  Decoder rebuilds frames with their CRC, so base
+ *  station handles them as raw frames. This file does
+ *  not depend on Arduino, so base station and host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef DELTA_H_
+#define DELTA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame.h"
+
+/** Cluster head sends frames delta encoded instead of raw.*/
+#ifndef UPLINK_COMPRESSION
+#define UPLINK_COMPRESSION      1
+#endif
+
+/** Every this many records of datagram one is keyframe.*/
+#ifndef DELTA_KEYFRAME
+#define DELTA_KEYFRAME          16
+#endif
+
+#if DELTA_KEYFRAME < 1
+#error "DELTA_KEYFRAME must be at least 1."
+#endif
+
+/** Largest encoded record: MAC (7), value (3) and round/seq (3) varints.*/
+#define DELTA_RECORD_MAX        13
+
+/** Bytes of datagram body which are not records (base round and CRC).*/
+#define DELTA_OVERHEAD          2
+
+/** Most records datagram can hold (header count is one byte).*/
+#define DELTA_RECORDS_MAX       255
+
+/**
+ * @brief Sorts frames by MAC, frames of same MAC by sequence number
+ * in serial number order, so held readings stay in order across wrap.
+ * @param frames Frames, FRAME_SIZE bytes each, back to back.
+ * @param count Number of frames.
+ * @return none
+ */
+void delta_sort(uint8_t* frames, uint16_t count);
+
+/**
+ * @brief Encodes as many frames as fit into one datagram body.
+ * @param buf Buffer with at least UPLINK_DATAGRAM_SIZE - UPLINK_HEADER_SIZE free bytes.
+ * @param frames Sorted frames, FRAME_SIZE bytes each, back to back.
+ * @param count Number of frames.
+ * @param round Base round, round of cluster head.
+ * @param used Set to number of frames encoded.
+ * @return Number of bytes written.
+ */
+size_t delta_encode(uint8_t* buf, const uint8_t* frames, uint16_t count, uint8_t round, uint16_t* used);
+
+/**
+ * @brief Returns number of datagrams needed to send frames delta encoded.
+ * @param frames Sorted frames, FRAME_SIZE bytes each, back to back.
+ * @param count Number of frames.
+ * @param round Base round, round of cluster head.
+ * @return Number of datagrams.
+ */
+uint8_t delta_fragments(const uint8_t* frames, uint16_t count, uint8_t round);
+
+/**
+ * @brief Checks uplink datagram with delta encoded records and
+ * rebuilds frames out of it.
+ * @param buf Datagram, with uplink header.
+ * @param len Length of datagram.
+ * @param frames Buffer for at most capacity frames.
+ * @param capacity Number of frames which fit in buffer.
+ * @return Number of frames rebuilt, 0 if datagram is not valid.
+ */
+size_t delta_decode(const uint8_t* buf, size_t len, uint8_t* frames, size_t capacity);
+
+#endif // DELTA_H_
@@ -0,0 +1,113 @@
+/** @file election.h
+ *  @brief Cluster head election in integer arithmetic.
+ *
+ *  LEACH threshold of round r is
+ *
+ *      T(r) = P / (1 - P * (r mod 1/P))
+ *
+ *  and with P = 1/NUMBER_OF_ROUNDS it is 1 / (N - r mod N).
+ *  ESP8266 has no FPU, so thresholds of all rounds are made
+ *  by compiler, as Q16 fixed point table (ELECTION_ONE is
+ *  certain election), and nothing is divided at boot.
+ *
+ *  Random number comes from xorshift32 generator, which is
+ *  seeded once from ESP8266TrueRandom at cold boot and kept
+ *  in RTC memory with round state. TrueRandom samples radio
+ *  noise, which is slow and sits between boot and first
+ *  radio operation of every round.
+ *
+ *  Node is cluster head when top 16 bits of next random
+ *  number are below threshold of its round.
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef ELECTION_H_
+#define ELECTION_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Number of rounds determined apriori. Currently it will be the same as
+ *  number of nodes. Round is kept and sent in one byte.
+*/
+#ifndef NUMBER_OF_ROUNDS
+#define NUMBER_OF_ROUNDS        7
+#endif
+
+#if NUMBER_OF_ROUNDS < 1 || NUMBER_OF_ROUNDS > 255
+#error "NUMBER_OF_ROUNDS must be between 1 and 255."
+#endif
+
+/** Threshold of certain election, and number of possible random draws.*/
+#define ELECTION_ONE            65536u
+
+/** Generator state used when seed is 0, which xorshift never leaves.*/
+#define ELECTION_DEFAULT_SEED   0x2545F491u
+
+/**
+ * Thresholds of all rounds of epoch.
+*/
+typedef struct
+{
+    uint32_t    threshold[NUMBER_OF_ROUNDS]; /**< Q16 threshold of round.*/
+} election_table_s;
+
+/**
+ * @brief Calculates threshold of round at compile time.
+ * @param rounds Rounds in epoch, 1/P.
+ * @param round Round of node.
+ * @return Q16 threshold, rounded to nearest.
+ */
+constexpr uint32_t election_threshold(uint32_t rounds, uint32_t round)
+{
+    return (ELECTION_ONE + (rounds - round % rounds) / 2) / (rounds - round % rounds);
+}
+
+/**
+ * @brief Fills threshold table at compile time.
+ * @param none.
+ * @return Table of NUMBER_OF_ROUNDS thresholds.
+ */
+constexpr election_table_s election_make_table(void)
+{
+    election_table_s table = {};
+
+    for (uint32_t r = 0; r < NUMBER_OF_ROUNDS; r++) {
+        table.threshold[r] = election_threshold(NUMBER_OF_ROUNDS, r);
+    }
+
+    return table;
+}
+
+static_assert(election_threshold(NUMBER_OF_ROUNDS, NUMBER_OF_ROUNDS - 1) == ELECTION_ONE,
+              "every node which was not cluster head in epoch is elected in its last round");
+
+/** Thresholds of all rounds, made by compiler.*/
+extern const election_table_s election_table;
+
+/**
+ * @brief Returns threshold of round.
+ * @param round Round of node, taken modulo NUMBER_OF_ROUNDS.
+ * @return Q16 threshold.
+ */
+uint32_t election_round_threshold(uint16_t round);
+
+/**
+ * @brief Makes generator state from seed.
+ * @param seed Random seed, for example from ESP8266TrueRandom.
+ * @return Generator state, never 0.
+ */
+uint32_t election_seed(uint32_t seed);
+
+/**
+ * @brief Advances generator and returns random draw.
+ * @param state Pointer to generator state.
+ * @return Random number 0 - ELECTION_ONE-1.
+ */
+uint32_t election_random(uint32_t* state);
+
+#endif // ELECTION_H_
@@ -0,0 +1,152 @@
+/** @file energy.h
+ *  @brief Estimate of charge node takes from its battery.
+ *
+ *  Every wake up is split into radio states, and charge
+ *  of each is its duration times supply current of that
+ *  state. Currents are typical values of ESP8266 datasheet
+ *  at 3.3 V, and can be overridden for other boards.
+ *
+ *  | state  | current  | what node does                     |
+ *  |--------|----------|------------------------------------|
+ *  | cpu    | 15 mA    | runs with radio off (modem sleep)  |
+ *  | scan   | 80 mA    | active scan                        |
+ *  | assoc  | 90 mA    | authentication and association     |
+ *  | ap     | 75 mA    | hosts soft AP, beacons and listens |
+ *  | tx     | 170 mA   | sends (802.11b)                    |
+ *  | rx     | 56 mA    | associated, radio idle             |
+ *  | sleep  | 20 uA    | deep sleep                         |
+ *
+ *  Time from reset to setup() is charged as cpu, since
+ *  time is taken from micros(), which starts at reset.
+ *
+ *  Used charge is kept with round state in RTC memory,
+ *  so it adds up over rounds. Cold boot starts it from
+ *  zero, as power was lost (battery replaced).
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef ENERGY_H_
+#define ENERGY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Supply current of every state in uA.*/
+#ifndef CURRENT_CPU_UA
+#define CURRENT_CPU_UA          15000
+#endif
+#ifndef CURRENT_SCAN_UA
+#define CURRENT_SCAN_UA         80000
+#endif
+#ifndef CURRENT_ASSOC_UA
+#define CURRENT_ASSOC_UA        90000
+#endif
+#ifndef CURRENT_AP_UA
+#define CURRENT_AP_UA           75000
+#endif
+#ifndef CURRENT_TX_UA
+#define CURRENT_TX_UA           170000
+#endif
+#ifndef CURRENT_RX_UA
+#define CURRENT_RX_UA           56000
+#endif
+#ifndef CURRENT_SLEEP_UA
+#define CURRENT_SLEEP_UA        20
+#endif
+
+/** Capacity of node battery in mAh.*/
+#ifndef BATTERY_CAPACITY_MAH
+#define BATTERY_CAPACITY_MAH    2000
+#endif
+
+/** Number of uAs in one mAh.*/
+#define UAS_PER_MAH             3600000ULL
+
+/**
+ * States of node with different supply current.
+*/
+typedef enum
+{
+    ENERGY_CPU = 0,
+    ENERGY_SCAN,
+    ENERGY_ASSOC,
+    ENERGY_AP,
+    ENERGY_TX,
+    ENERGY_RX,
+    ENERGY_SLEEP,
+    ENERGY_STATES
+} energy_state_e;
+
+/**
+ * Charge used by node.
+*/
+typedef struct
+{
+    uint64_t    used_uas;               /**< Charge used since battery was new, in uAs.*/
+    uint32_t    since_us;               /**< Time when current state started.*/
+    uint8_t     state;                  /**< Current energy_state_e.*/
+} energy_s;
+
+/**
+ * @brief Starts accounting of wake up, in cpu state from reset.
+ * @param energy Pointer to energy_s structure.
+ * @param used_uas Charge used in earlier rounds.
+ * @return none.
+ */
+void energy_init(energy_s* energy, uint64_t used_uas);
+
+/**
+ * @brief Charges time spent in current state, and switches to new one.
+ * @param energy Pointer to energy_s structure.
+ * @param state New energy_state_e.
+ * @param now_us Time since reset in us.
+ * @return none.
+ */
+void energy_enter(energy_s* energy, uint8_t state, uint32_t now_us);
+
+/**
+ * @brief Charges given time in given state, without changing current state.
+ * @param energy Pointer to energy_s structure.
+ * @param state energy_state_e to charge.
+ * @param duration_us Time in state in us.
+ * @return none.
+ */
+void energy_charge(energy_s* energy, uint8_t state, uint64_t duration_us);
+
+/**
+ * @brief Returns supply current of state.
+ * @param state energy_state_e.
+ * @return Current in uA.
+ */
+uint32_t energy_current(uint8_t state);
+
+/**
+ * @brief Returns charge left in battery.
+ * @param energy Pointer to energy_s structure.
+ * @param capacity_mah Capacity of battery in mAh.
+ * @return Charge left in uAs, 0 if battery is empty.
+ */
+uint64_t energy_left(const energy_s* energy, uint32_t capacity_mah);
+
+/**
+ * @brief Returns charge left in battery as level carried in beacon.
+ * @param energy Pointer to energy_s structure.
+ * @param capacity_mah Capacity of battery in mAh.
+ * @return 0 (empty) - 255 (full).
+ */
+uint8_t energy_level(const energy_s* energy, uint32_t capacity_mah);
+
+/**
+ * @brief Moves running average of energy levels a quarter of
+ * the way towards new level.
+ * @param average Running average, 0 if not known yet.
+ * @param level New level.
+ * @return New running average.
+ */
+uint8_t energy_average_update(uint8_t average, uint8_t level);
+
+#endif // ENERGY_H_
@@ -0,0 +1,184 @@
+/** @file frame.h
+ *  @brief Binary frame which carries one node reading.
+ *
+ *  Station sends one frame to its cluster head (frames
+ *  of readings it held with STATION_BATCH), and
+ *  cluster head sends all frames it collected (its own
+ *  first) back to back in one datagram to base station.
+ *
+ *  Layout (FRAME_SIZE bytes, multi-byte fields little endian):
+ *
+ *  | offset | size | field                          |
+ *  |--------|------|--------------------------------|
+ *  | 0      | 6    | MAC address of node            |
+ *  | 6      | 2    | ADC value                      |
+ *  | 8      | 1    | round                          |
+ *  | 9      | 1    | sequence number of reading     |
+ *  | 10     | 1    | CRC-8 (poly 0x07) of bytes 0-9 |
+ *
+ *  Round wraps at NUMBER_OF_ROUNDS, sequence number counts
+ *  readings of node over deep sleep (see state.h) and wraps
+ *  at 256.
+ *
+ *  Decoder works directly on received buffer, frame_*
+ *  getters read fields of frame which starts at given
+ *  pointer, nothing is copied.
+ *
+ *  Uplink to base station is split into datagrams of
+ *  at most UPLINK_DATAGRAM_SIZE bytes. Every datagram
+ *  starts with UPLINK_HEADER_SIZE bytes header:
+ *
+ *  | offset | size | field                          |
+ *  |--------|------|--------------------------------|
+ *  | 0      | 1    | index of this datagram         |
+ *  | 1      | 1    | number of datagrams in uplink  |
+ *  | 2      | 1    | number of records that follow  |
+ *  | 3      | 1    | type of records (UPLINK_*)     |
+ *
+ *  Every datagram carries whole records, so base station
+ *  decodes each one on its own, in order of arrival, and
+ *  does not reassemble uplink. Index and number of
+ *  datagrams only let capture tools tell how much of
+ *  uplink was lost.
+ *
+ *  This file does not depend on Arduino, so base station
+ *  and host tools can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Local UDP port where data from stations will be sent, and where base listens.*/
+#define UDP_BROADCAST_PORT      50000
+
+/** Size of one frame in bytes.*/
+#define FRAME_SIZE              11
+
+/** Size of MAC address in frame.*/
+#define FRAME_MAC_SIZE          6
+
+/** Offsets of frame fields.*/
+#define FRAME_ADC_OFFSET        6
+#define FRAME_ROUND_OFFSET      8
+#define FRAME_SEQ_OFFSET        9
+#define FRAME_CRC_OFFSET        10
+
+/** Size of header of uplink datagram.*/
+#define UPLINK_HEADER_SIZE      4
+
+/** Types of records in uplink datagram.*/
+#define UPLINK_FRAMES_RAW       0
+#define UPLINK_SUMMARY          1
+#define UPLINK_HISTOGRAM        2
+#define UPLINK_DELTA            3
+
+/** Largest uplink datagram, UDP payload every IPv4 host must accept (576 - 28).*/
+#define UPLINK_DATAGRAM_SIZE    548
+
+/** Number of frames which fit in one uplink datagram.*/
+#define UPLINK_FRAMES           ((UPLINK_DATAGRAM_SIZE - UPLINK_HEADER_SIZE) / FRAME_SIZE)
+
+/**
+ * @brief Calculates CRC-8 (polynomial 0x07, initial value 0).
+ * @param data Bytes to calculate CRC of.
+ * @param len Number of bytes.
+ * @return CRC.
+ */
+uint8_t frame_crc8(const uint8_t* data, size_t len);
+
+/**
+ * @brief Writes frame to buffer.
+ * @param buf Buffer with at least FRAME_SIZE free bytes.
+ * @param mac MAC address of node.
+ * @param adc_value ADC value of node.
+ * @param round Round of reading.
+ * @param seq Sequence number of frame.
+ * @return Number of bytes written (FRAME_SIZE).
+ */
+size_t frame_encode(uint8_t* buf, const uint8_t* mac, uint16_t adc_value, uint8_t round, uint8_t seq);
+
+/**
+ * @brief Checks that frame starting at buf is complete and CRC is correct.
+ * @param buf Start of frame.
+ * @param len Bytes available from buf.
+ * @return true if frame is valid.
+ */
+bool frame_is_valid(const uint8_t* buf, size_t len);
+
+/**
+ * @brief Counts valid frames in datagram. Counting stops at
+ * first invalid frame, as rest of datagram cannot be trusted.
+ * @param buf Datagram.
+ * @param len Length of datagram.
+ * @return Number of valid frames.
+ */
+size_t frame_count(const uint8_t* buf, size_t len);
+
+/**
+ * @brief Returns MAC address of frame.
+ * @param frame Start of valid frame.
+ * @return Pointer to FRAME_MAC_SIZE bytes inside frame.
+ */
+const uint8_t* frame_mac(const uint8_t* frame);
+
+/**
+ * @brief Returns ADC value of frame.
+ * @param frame Start of valid frame.
+ * @return ADC value.
+ */
+uint16_t frame_adc_value(const uint8_t* frame);
+
+/**
+ * @brief Returns round of frame.
+ * @param frame Start of valid frame.
+ * @return Round.
+ */
+uint8_t frame_round(const uint8_t* frame);
+
+/**
+ * @brief Returns sequence number of frame.
+ * @param frame Start of valid frame.
+ * @return Sequence number.
+ */
+uint8_t frame_seq(const uint8_t* frame);
+
+/**
+ * @brief Returns number of datagrams needed to send frames to base.
+ * @param frames Number of frames.
+ * @return Number of datagrams.
+ */
+uint8_t uplink_fragments(uint16_t frames);
+
+/**
+ * @brief Writes header of uplink datagram.
+ * @param buf Buffer with at least UPLINK_HEADER_SIZE free bytes.
+ * @param fragment Index of datagram.
+ * @param fragments Number of datagrams in uplink.
+ * @param count Number of records in this datagram.
+ * @param type Type of records (UPLINK_*).
+ * @return Number of bytes written (UPLINK_HEADER_SIZE).
+ */
+size_t uplink_encode_header(uint8_t* buf, uint8_t fragment, uint8_t fragments, uint8_t count, uint8_t type);
+
+/**
+ * @brief Returns type of records in uplink datagram.
+ * @param buf Datagram of at least UPLINK_HEADER_SIZE bytes.
+ * @return Type of records (UPLINK_*).
+ */
+uint8_t uplink_type(const uint8_t* buf);
+
+/**
+ * @brief Checks header of uplink datagram with raw frames and finds them.
+ * @param buf Datagram.
+ * @param len Length of datagram.
+ * @param count Set to number of valid frames which follow header.
+ * @return Pointer to first frame inside datagram, or NULL if header is invalid.
+ */
+const uint8_t* uplink_frames(const uint8_t* buf, size_t len, size_t* count);
+
+#endif // FRAME_H_
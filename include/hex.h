@@ -0,0 +1,53 @@
+/** @file hex.h
+ *  @brief Check that string is made of hex digits only.
+ *
+ *  Every node SSID is MAC address in hex, and node checks
+ *  SSID of every network its scan finds, base station does
+ *  the same over many records. Checking characters one by
+ *  one with isxdigit() costs call and branch per character.
+ *
+ *  hex_is_valid() checks 8 characters at once in 64-bit
+ *  word (SWAR): for every byte it adds constants which set
+ *  top bit of byte exactly when byte is above bound, so
+ *  ranges '0'-'9' and 'A'-'F' / 'a'-'f' are checked with
+ *  few word operations. Last word is read so it ends at
+ *  end of string, overlapping previous one, so 12 character
+ *  SSID takes two words. Strings shorter than one word are
+ *  checked with lookup table.
+ *
+ *  Neither is faster than isxdigit() on host (see hex and
+ *  ssid benchmarks of leach_bench), and ESP8266 is 32-bit,
+ *  so 64-bit word operations are emulated there. Node
+ *  checks SSIDs with isxdigit() (ssid_is_valid()), these
+ *  checks are kept for host tools and for comparison.
+ *
+ *  This file does not depend on Arduino, so base station
+ *  and host tools can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef HEX_H_
+#define HEX_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Checks characters one by one with lookup table.
+ * @param txt Characters to check.
+ * @param len Number of characters.
+ * @return true if all characters are hex digits (either case).
+ */
+bool hex_is_valid_table(const char* txt, size_t len);
+
+/**
+ * @brief Checks 8 characters at once (SWAR), with lookup table
+ * for strings shorter than 8 characters.
+ * @param txt Characters to check.
+ * @param len Number of characters.
+ * @return true if all characters are hex digits (either case).
+ */
+bool hex_is_valid(const char* txt, size_t len);
+
+#endif // HEX_H_
@@ -19,22 +19,62 @@
 #include <Ticker.h>
 #include <FS.h>
 #include "LittleFS.h"
+#include "frame.h"
+#include "aggregate.h"
+#include "delta.h"
+#include "dedup.h"
+#include "window.h"
+#include "sync.h"
+#include "relay.h"
+#include "batch.h"
+#include "channel.h"
+#include "tdma.h"
+#include "election.h"
+#include "state.h"
+#include "trace.h"
+#include "energy.h"
+#include "sample.h"
 
 /** Name of file where round and ch_enable flag are written.*/
 #define FILENAME                "/setup.txt"
 
 /** Flag which will print debug messages over serial terminal.*/
+#ifndef DEBUG
 #define DEBUG                   1
+#endif
 
 /** This flag will create file in FS where round and ch_enable will be saved.
  *  Also it will reset round to 0, and ch_enable to 1.
 */
 #define ROUNDS_RESET            0
 
-/** Number of rounds determined apriori. Currently it will be the same as
- *  number of nodes.
+/** Writes end of phase of round to trace of node, if PHASE_TRACE is on.*/
+#if PHASE_TRACE
+#define TRACE_MARK(node, phase) trace_mark(&(node)->trace, phase, ESP.getCycleCount())
+#else
+#define TRACE_MARK(node, phase)
+#endif
+
+/** CPU clock in MHz, cycle counter ticks per microsecond.*/
+#define CYCLES_PER_US           (F_CPU / 1000000)
+
+/** Cluster head election modes.*/
+#define ELECTION_LEACH          0
+#define ELECTION_ENERGY         1
+
+/** How node decides to be cluster head:
+ *  - ELECTION_LEACH: classic LEACH threshold, same for every node.
+ *  - ELECTION_ENERGY: LEACH threshold weighted by battery level of node
+ *    relative to network average, which cluster heads carry in their SSID.
 */
-#define NUMBER_OF_ROUNDS        7
+#ifndef ELECTION
+#define ELECTION                ELECTION_LEACH
+#endif
+
+/** Length of soft AP SSID, MAC in hex, followed by level digit with
+ *  MULTI_HOP and energy level in hex with ELECTION_ENERGY.
+*/
+#define NODE_SSID_LENGTH        (12 + (MULTI_HOP ? 1 : 0) + (ELECTION == ELECTION_ENERGY ? 2 : 0))
 
 /** Base station SSID.*/
 #define BASE_SSID               "BASE_STATION"
@@ -42,44 +82,233 @@
 /** This will be password for all nodes.*/
 #define NODE_PASS               "teorijazavere"
 
-/** WiFi channel.*/
-#define WIFI_CHANNEL              1
+/** Most networks node keeps from scans of all its channels,
+ *  strongest ones.
+*/
+#define SCAN_RESULTS            32
 
 /** Maximum possible number of connected devices to node.*/
+#ifndef MAX_CONNECTED
 #define MAX_CONNECTED             7
+#endif
 
-/** Timeout for connection in ms.*/
+/** Timeout for connection in ms, longest one when it is adaptive.*/
 #define CONNECTION_TIMEOUT      15000
 
-/** Timeout for udp packets waiting in ms.*/
+/** Timeout for udp packets waiting in ms, longest one when it is adaptive.*/
 #define WAIT_FOR_PACKETS        10000
 
-/** Local UDP port where data from stations will be sent.*/
-#define UDP_BROADCAST_PORT      50000
+#if TDMA_SCHEDULE && TDMA_START_MS + TDMA_SLOTS * TDMA_SLOT_MS + TDMA_TAIL_MS > WAIT_FOR_PACKETS
+#error "TDMA schedule and its tail must end within WAIT_FOR_PACKETS, cluster head stops listening then."
+#endif
+
+/** Shortest adaptive receive window of cluster head, and time added
+ *  to percentile of station arrivals, in ms (see window.h). Stations
+ *  which come after window closed are never seen, so margin is wide.
+*/
+#ifndef MIN_RECEIVE_WINDOW
+#define MIN_RECEIVE_WINDOW      1000
+#endif
+#ifndef RECEIVE_WINDOW_MARGIN
+#define RECEIVE_WINDOW_MARGIN   2000
+#endif
+
+/** Shortest adaptive connect timeout of station, and time added
+ *  to percentile of connect times, in ms (see window.h).
+*/
+#ifndef MIN_CONNECT_TIMEOUT
+#define MIN_CONNECT_TIMEOUT     1000
+#endif
+#ifndef CONNECT_TIMEOUT_MARGIN
+#define CONNECT_TIMEOUT_MARGIN  500
+#endif
+
+/** timer1 is started with this many ticks at wake up, round lasts until it runs out.*/
+#define ROUND_TIMER_TICKS       8388607
+
+/** Time station waits for sync reply of cluster head in ms.*/
+#define SYNC_WAIT_MS            30
+
+/** Conversion between ms and timer1 ticks (TIM_DIV256, 3.2 us per tick).*/
+#define MS_TO_TICKS(ms)         ((uint32_t)(ms) * 625 / 2)
+#define TICKS_TO_MS(ticks)      ((uint32_t)(ticks) * 2 / 625)
+
+/** Cluster head stops early once all associated stations reported and
+ *  no other station associated for a while. That time covers
+ *  WINDOW_PERCENTILE of gaps between associations in earlier rounds,
+ *  plus margin, and is kept between these bounds in ms (see window.h).
+ *  Station which is still scanning, or whose RTC drifted and woke up
+ *  later, associates within it after the one before.
+*/
+#ifndef MIN_STATION_QUIET
+#define MIN_STATION_QUIET       500
+#endif
+#ifndef MAX_STATION_QUIET
+#define MAX_STATION_QUIET       4000
+#endif
+#ifndef STATION_QUIET_MARGIN
+#define STATION_QUIET_MARGIN    500
+#endif
+
+/** Period in ms in which cluster head checks for received packets.*/
+#define RECEIVE_POLL_PERIOD     5
+
+/** This flag will make station set its IP address from its MAC
+ *  instead of asking cluster head over DHCP, and send frame
+ *  directly to cluster head.
+*/
+#ifndef STATIC_IP
+#define STATIC_IP               1
+#endif
+
+/** Address of soft AP of every cluster head (SDK default).*/
+#define AP_ADDRESS              IPAddress(192, 168, 4, 1)
+
+/** Netmask of soft AP subnet.*/
+#define AP_NETMASK              IPAddress(255, 255, 255, 0)
 
 /** Analog input pin.*/
 #define ADC_PIN                 A0
 
-/** Maximum valid received message size.*/
-#define MAX_MESSAGE_SIZE        18
-
 /** Period in us which is used to calculate for how long node
  * will be in deep sleep.
  */
 #define SLEEP_PERIOD            18750
 
+/** Number of frames cluster head can accumulate in one round (own frame
+ *  included). Memory for them is reserved statically, frames past this
+ *  are dropped. With STATION_BATCH every station, and cluster head,
+ *  can bring up to BATCH_CAPACITY held frames, cluster head also
+ *  reading of this round.
+*/
+#ifndef ACCUMULATE_CAPACITY
+#if STATION_BATCH
+#define ACCUMULATE_CAPACITY     ((MAX_CONNECTED + 1) * BATCH_CAPACITY + 1)
+#else
+#define ACCUMULATE_CAPACITY     64
+#endif
+#endif
+
+#if ACCUMULATE_CAPACITY < MAX_CONNECTED + 1
+#error "ACCUMULATE_CAPACITY must hold frames of all connected stations and cluster head."
+#endif
+
+#if STATION_BATCH && ACCUMULATE_CAPACITY < (MAX_CONNECTED + 1) * BATCH_CAPACITY + 1
+#error "ACCUMULATE_CAPACITY must hold held readings of all connected stations and cluster head."
+#endif
+
+/** Number of slots of table cluster head drops repeated frames with,
+ *  power of two. It holds stations in 3/4 of slots, default keeps it
+ *  at most half full with MAX_CONNECTED stations.
+*/
+#ifndef DEDUP_CAPACITY
+#define DEDUP_CAPACITY          16
+#endif
+
+#if DEDUP_CAPACITY < 2 || (DEDUP_CAPACITY & (DEDUP_CAPACITY - 1)) != 0
+#error "DEDUP_CAPACITY must be power of two."
+#endif
+
+#if DEDUP_CAPACITY - DEDUP_CAPACITY / 4 < MAX_CONNECTED
+#error "DEDUP_CAPACITY must hold all connected stations."
+#endif
+
+/**
+ * Preallocated storage of frames accumulated by cluster head.
+*/
+typedef struct
+{
+    uint8_t     frames[ACCUMULATE_CAPACITY][FRAME_SIZE]; /**< Accumulated frames.*/
+    uint16_t    count;                  /**< Number of frames in arena.*/
+    uint16_t    dropped;                /**< Valid frames which did not fit.*/
+} record_arena_s;
+
+/** Offset of scan cache in RTC user memory, in 4 byte blocks.*/
+#define RTC_SCAN_CACHE_BLOCK    0
+
+/**
+ * Network found by scan, as remembered in RTC memory.
+*/
+typedef struct
+{
+    char        ssid[NODE_SSID_LENGTH + 1]; /**< SSID of network.*/
+    uint8_t     bssid[6];               /**< BSSID of network.*/
+    uint8_t     channel;                /**< Channel of network, 0 if entry is empty.*/
+    int8_t      rssi;                   /**< RSSI when network was found.*/
+    uint8_t     round;                  /**< Round when network was found.*/
+} scan_entry_s;
+
+/**
+ * Scan results and observed times kept in RTC memory during deep sleep.
+*/
+typedef struct
+{
+    uint32_t    crc;                    /**< CRC-8 of rest of structure.*/
+    scan_entry_s base;                  /**< Base station, used by cluster head without scan.*/
+    uint8_t     energy_average;         /**< Estimate of network average energy level, 0 if not known.*/
+    window_s    arrivals;               /**< Arrival times of station frames at cluster head.*/
+    window_s    connects;               /**< Connect times of station.*/
+    window_s    gaps;                   /**< Times from window start or last association to next association at cluster head.*/
+#if MULTI_HOP
+    uint8_t     level;                  /**< Level from cluster heads of last scan, 0 if not known.*/
+#endif
+} scan_cache_s;
+
+/** Offset of round state in RTC user memory, in 4 byte blocks, after scan cache.*/
+#define RTC_STATE_BLOCK         (RTC_SCAN_CACHE_BLOCK + (sizeof(scan_cache_s) + 3) / 4)
+
+/** Offset of held readings in RTC user memory, in 4 byte blocks, after round state.*/
+#define RTC_BATCH_BLOCK         (RTC_STATE_BLOCK + (sizeof(round_state_s) + 3) / 4)
+
+static_assert(RTC_BATCH_BLOCK * 4 + sizeof(batch_s) <= 512, "RTC user memory is 512 bytes.");
+
 /**
  * Structure which defines node.
 */
 typedef struct
 {
     uint8_t     nodeName[6];            /**< Node name (its mac address).*/
-    uint16_t    adc_value;              /**< ADC value of node.*/
+    uint16_t    adc_value;              /**< Reading of node, SAMPLE_BITS bits.*/
+    sample_ring_s samples;              /**< ADC samples reading is made of.*/
     uint8_t     round;                  /**< Current round.*/
     uint8_t     ch_enable;              /**< Flag which indicats if node can be CH in current round.*/
     bool        cluster_head;           /**< True if node is cluster head for current round.*/
-    float       P;                      /**< Probability that node will become cluster head in round 0.*/
     char      strongest_ssid[20];       /**< Strongest valid SSID node can connect to.*/
+    uint8_t     strongest_bssid[6];     /**< BSSID of strongest valid SSID.*/
+    uint8_t     strongest_channel;      /**< Channel of strongest valid SSID.*/
+    int32_t     strongest_rssi;         /**< RSSI of strongest valid SSID.*/
+    int8_t      strongest_index;        /**< Index of strongest valid SSID in scan, -1 if none.*/
+    scan_entry_s found[SCAN_RESULTS];   /**< Valid networks found by last scan, all channels.*/
+    uint8_t     networks;               /**< Number of networks in found.*/
+    scan_cache_s scan_cache;            /**< Scan results from previous rounds.*/
+    round_state_s state;                /**< Round state as kept in RTC memory.*/
+    bool        fs_mounted;             /**< True once LittleFS is mounted in this wake up.*/
+    energy_s    energy;                 /**< Battery charge used so far.*/
+    sync_s      clock;                  /**< RTC skew estimate and pending correction.*/
+    uint32_t    rng;                    /**< Election random generator state.*/
+#if PHASE_TRACE
+    trace_s     trace;                  /**< Phase marks of current round.*/
+#endif
+    dedup_entry_s dedup_slots[DEDUP_CAPACITY]; /**< Stations cluster head received frames from.*/
+    dedup_s     dedup;                  /**< Table over dedup_slots.*/
+    uint8_t     seq;                    /**< Sequence number of reading of this round (see frame.h).*/
+#if AGGREGATION == AGGREGATE_NONE
+    record_arena_s records;             /**< Frames accumulated by cluster head.*/
+#else
+    aggregate_s aggregate;              /**< Readings aggregated by cluster head.*/
+#endif
+#if MULTI_HOP
+    relay_s     relay;                  /**< Uplinks other cluster heads forwarded to this one.*/
+    bool        relaying;               /**< True while cluster head connects to other cluster head.*/
+    uint8_t     level;                  /**< Level cluster head advertised in current round.*/
+#endif
+#if STATION_BATCH
+    batch_s     batch;                  /**< Readings held by station.*/
+    bool        holding;                /**< True if station keeps radio off in current round.*/
+#endif
+#if TDMA_SCHEDULE
+    uint8_t     slot;                   /**< Slot station sends in (see tdma.h).*/
+#endif
 } Node_s;
 
 /**
@@ -95,7 +324,47 @@ typedef enum
 } node_return_codes_e;
 
 /**
- * @brief Calculates for how long node will go to deep sleep.
+ * @brief Starts round timer, turns off WiFi, and fills node structure
+ * with round state read from RTC memory (or FS after cold boot).
+ * @param node Pointer to Node_s structure.
+ * @return none.
+ */
+void init_round(Node_s* node);
+
+/**
+ * @brief Saves state for next round and puts node to deep sleep.
+ * @param node Pointer to Node_s structure.
+ * @return none.
+ */
+void finish_round(Node_s* node);
+
+/**
+ * @brief Charges time spent in current energy state, and switches to new one.
+ * @param node Pointer to Node_s structure.
+ * @param state energy_state_e node enters.
+ * @return none.
+ */
+void energy_phase(Node_s* node, uint8_t state);
+
+/**
+ * @brief Charges deep sleep ahead, and keeps used charge in RTC memory.
+ * @param node Pointer to Node_s structure.
+ * @param sleep_us Duration of deep sleep in us.
+ * @return none.
+ */
+void save_energy(Node_s* node, uint64_t sleep_us);
+
+/**
+ * @brief Prints trace of current round as one line over serial.
+ * @param node Pointer to Node_s structure.
+ * @return none.
+ */
+void print_trace(Node_s* node);
+
+/**
+ * @brief Calculates for how long node will go to deep sleep, so it
+ * wakes at start of next round, corrected by clock state (CLOCK_SYNC).
+ * @param node Pointer to Node_s structure.
  * @return none.
  */
 void sleeping_time(Node_s* node);
@@ -107,33 +376,112 @@ void sleeping_time(Node_s* node);
  */
 void prepare_next_round(Node_s* node);
 
+/**
+ * @brief Empties record arena.
+ * @param arena Pointer to record_arena_s structure.
+ * @return none.
+ */
+void arena_clear(record_arena_s* arena);
+
+/**
+ * @brief Copies frame to record arena.
+ * @param arena Pointer to record_arena_s structure.
+ * @param frame Frame of FRAME_SIZE bytes.
+ * @return true if frame was stored, false if arena is full.
+ */
+bool arena_add(record_arena_s* arena, const uint8_t* frame);
+
+/**
+ * @brief Empties frames or aggregate of cluster head, depending on
+ * AGGREGATION.
+ * @param node Pointer to Node_s structure.
+ * @return none.
+ */
+void clear_accumulated(Node_s* node);
+
+/**
+ * @brief Stores frame in record arena, or folds it into aggregate,
+ * depending on AGGREGATION.
+ * @param node Pointer to Node_s structure.
+ * @param frame Valid frame.
+ * @return false if frame was dropped.
+ */
+bool accumulate_frame(Node_s* node, const uint8_t* frame);
+
 /**
  * @brief Tries to connect to base station, and send accumulated
- * buffer.
+ * frames in as many datagrams as needed, or one aggregate record.
+ * Cluster head of level other than 0 (MULTI_HOP) sends uplink through
+ * cluster head closer to base station first. Readings held as station
+ * (STATION_BATCH) are let go only once uplink was sent.
  * @param node Pointer to Node_s structure.
  * @return none.
  */
 void send_to_base(Node_s* node);
 
+/**
+ * @brief Sends accumulated frames, or aggregate record, to address of
+ * network node is connected to.
+ * @param node Pointer to Node_s structure.
+ * @param address Destination address.
+ * @param hops 0 for base station, otherwise hops put in relay header
+ * of every datagram.
+ * @return true if every datagram was sent.
+ */
+bool send_uplink(Node_s* node, IPAddress address, uint8_t hops);
+
+/**
+ * @brief Connects to strongest cluster head of lower level from new
+ * scan and sends uplink to it, with one hop more than any uplink merged.
+ * @param node Pointer to Node_s structure.
+ * @return true if uplink was sent.
+ */
+bool relay_to_cluster_head(Node_s* node);
+
+/**
+ * @brief Merges records of uplink datagram relayed by other cluster
+ * head into own uplink.
+ * @param node Pointer to Node_s structure.
+ * @param buf Valid relayed datagram.
+ * @param len Length of datagram.
+ * @return none.
+ */
+void merge_relay(Node_s* node, const uint8_t* buf, size_t len);
+
+/**
+ * @brief Returns number of associated stations which reported in this
+ * round, forwarding cluster heads included (MULTI_HOP).
+ * @param node Pointer to Node_s structure.
+ * @return Number of stations.
+ */
+uint32_t reported_stations(Node_s* node);
+
 /**
  * @brief Check if received message from UDP broadcast port
- * has correct pattern.
- * @param txt Received message.
+ * is exactly one frame with correct CRC, or with STATION_BATCH
+ * frames of one station back to back (see batch_frames()).
+ * @param msg Received message.
  * @param l Length of message.
- * @return true if pattern is correct.
+ * @return true if message is valid frame.
  */
-bool check_if_message_is_valid(char *txt, unsigned char l);
+bool check_if_message_is_valid(const uint8_t *msg, size_t l);
 
 /**
- * @brief Listen to UDP broadcast port, parse packet
- * and accumulate message.
+ * @brief Listen to UDP broadcast port, check frames
+ * from stations and accumulate them. Frames already
+ * received or older than last one of their station are
+ * dropped. Uplinks relayed by other cluster heads are
+ * merged (MULTI_HOP). Stops early when every station
+ * associated with soft AP has reported.
  * @param node Pointer to Node_s structure
  * @return none.
  */
 void parse_packets(Node_s* node);
 
 /**
- * @brief Sets access point in order for stations to connect.
+ * @brief Puts own frame at start of record arena, after readings
+ * held as station (STATION_BATCH), and sets
+ * access point in order for stations to connect.
  * @param node Pointer to Node_s structure
  * @return true if successful.
  */
@@ -148,26 +496,146 @@ bool set_access_point(Node_s* node);
 IPAddress create_broadcast_address(IPAddress dns);
 
 /**
- * @brief Sends UDP packet to cluster head (access point).
+ * @brief Derives static address of station in soft AP subnet
+ * from its MAC, so no DHCP is needed. Host part is 2 - 254,
+ * so two stations of same cluster head can share it. Station
+ * only sends to cluster head, and cluster head never sends to
+ * station address, its sync reply is broadcast and carries
+ * MAC of station (see sync.h), so shared address does no harm.
+ * @param mac MAC address of station.
+ * @return IP address of station.
+ */
+IPAddress station_address(const uint8_t* mac);
+
+/**
+ * @brief Sends frame with ADC value to cluster head (access point),
+ * or all held readings with STATION_BATCH, which are let go once
+ * frame was sent.
  * @param node Pointer to Node_s structure.
+ * @return true if frame was sent and, with CLOCK_SYNC, cluster head
+ * answered it.
+ */
+bool send_packet_to_ap(Node_s* node);
+
+#if TDMA_SCHEDULE
+/**
+ * @brief Waits until given time before slot of station begins (see
+ * tdma.h).
+ * @param node Pointer to Node_s structure.
+ * @param lead_ms Wait ends this long before slot begins.
+ * @param radio_off True to keep radio off while waiting (modem sleep)
+ * and turn it on at the end, false to keep association.
  * @return none
  */
-void send_packet_to_ap(Node_s* node);
+void wait_for_slot(Node_s* node, uint32_t lead_ms, bool radio_off);
+#endif
+
+/**
+ * @brief Returns time since round timer was started at wake up.
+ * @param none.
+ * @return Time in us.
+ */
+uint32_t round_elapsed_us(void);
+
+/**
+ * @brief Answers station whose frame was just read with time since
+ * cluster head round start, broadcast in soft AP subnet (see sync.h).
+ * @param udp Socket frame was read from.
+ * @param mac MAC address of station which sent frame.
+ * @return none.
+ */
+void send_sync(WiFiUDP* udp, const uint8_t* mac);
 
 /**
- * @brief Gets and stores value from ADC.
+ * @brief Waits up to SYNC_WAIT_MS for sync reply of cluster head to this
+ * station, and updates clock state with offset to it.
+ * @param node Pointer to Node_s structure.
+ * @param udp Socket frame was sent from.
+ * @return true if reply came.
+ */
+bool receive_sync(Node_s* node, WiFiUDP* udp);
+
+/**
+ * @brief Takes SAMPLE_COUNT samples of ADC, SAMPLE_INTERVAL_US apart,
+ * and stores reading made of them. Called while radio is still in
+ * forced sleep, so radio is not powered during sampling.
  * @param node Pointer to Node_s structure.
  * @return none
  */
 void get_adc_value(Node_s* node);
 
 /**
- * @brief Tries to connect to strongest valid SSID.
+ * @brief Tries to connect to strongest valid SSID (station, or cluster
+ * head which relays), or to base station (cluster head). BSSID and
+ * channel are given when known, so
+ * connecting does not scan again.
  * @param node Pointer to Node_s structure.
  * @return connection status defined in node_return_codes_e.
  */
 int connect_to_strongest_ssid(Node_s* node);
 
+/**
+ * @brief Returns how long cluster head listens for station frames, which
+ * covers WINDOW_PERCENTILE of arrivals in earlier rounds (ADAPTIVE_WINDOW),
+ * or WAIT_FOR_PACKETS.
+ * @param node Pointer to Node_s structure.
+ * @return Receive window in timer1 ticks.
+ */
+uint32_t receive_window(Node_s* node);
+
+/**
+ * @brief Returns how long cluster head keeps listening after last station
+ * associated, which covers WINDOW_PERCENTILE of gaps between associations
+ * in earlier rounds (ADAPTIVE_WINDOW), or MAX_STATION_QUIET.
+ * @param node Pointer to Node_s structure.
+ * @return Quiet time in timer1 ticks.
+ */
+uint32_t station_quiet(Node_s* node);
+
+/**
+ * @brief Returns how long station waits for connection, which covers
+ * WINDOW_PERCENTILE of its connect times in earlier rounds (ADAPTIVE_WINDOW),
+ * or CONNECTION_TIMEOUT. Cluster head connecting to base always gets
+ * CONNECTION_TIMEOUT.
+ * @param node Pointer to Node_s structure.
+ * @return Connect timeout in timer1 ticks.
+ */
+uint32_t connect_timeout(Node_s* node);
+
+/**
+ * @brief Writes SSID of soft AP of node: its MAC in hex, followed
+ * by its level with MULTI_HOP and energy level in hex with
+ * ELECTION_ENERGY.
+ * @param node Pointer to Node_s structure.
+ * @param name Buffer with at least NODE_SSID_LENGTH + 1 free bytes.
+ * @return none.
+ */
+void access_point_name(Node_s* node, char* name);
+
+/**
+ * @brief Returns level of node, hops its uplink needs to base
+ * station (MULTI_HOP): 0 if it knows base station, otherwise
+ * level from cluster heads of its last scan.
+ * @param node Pointer to Node_s structure.
+ * @return Level, RELAY_NO_ROUTE if not known.
+ */
+uint8_t route_level(Node_s* node);
+
+/**
+ * @brief Returns energy level cluster head advertises in its SSID,
+ * its estimate of network average with its own level folded in.
+ * @param node Pointer to Node_s structure.
+ * @return Energy level 0 - 255.
+ */
+uint8_t beacon_energy_level(Node_s* node);
+
+/**
+ * @brief Returns energy level carried in SSID of cluster head.
+ * @param ssid Valid SSID of cluster head.
+ * @return Energy level 0 - 255.
+ */
+uint8_t ssid_energy_level(const char* ssid);
+
 /**
  * @brief Checks if SSID has valid patern.
  * @param txt SSID of found network.
@@ -175,14 +643,78 @@ int connect_to_strongest_ssid(Node_s* node);
  */
 bool ssid_is_valid(const char* txt);
 
+/**
+ * @brief Reads scan cache from RTC memory, and empties it if
+ * CRC is not correct (first power up).
+ * @param cache Pointer to scan_cache_s structure.
+ * @return none.
+ */
+void read_scan_cache(scan_cache_s* cache);
+
+/**
+ * @brief Writes scan cache to RTC memory.
+ * @param cache Pointer to scan_cache_s structure.
+ * @return none.
+ */
+void write_scan_cache(scan_cache_s* cache);
+
+/**
+ * @brief Reads held readings from RTC memory, empty buffer if CRC
+ * does not match (cold boot).
+ * @param batch Pointer to batch_s structure.
+ * @return none.
+ */
+void read_batch(batch_s* batch);
+
+/**
+ * @brief Writes held readings to RTC memory.
+ * @param batch Pointer to batch_s structure.
+ * @return none.
+ */
+void write_batch(batch_s* batch);
+
+/**
+ * @brief Fills scan cache entry.
+ * @param entry Pointer to scan_entry_s structure.
+ * @param ssid SSID of network.
+ * @param bssid BSSID of network.
+ * @param channel Channel of network.
+ * @param rssi RSSI of network.
+ * @param round Current round.
+ * @return none.
+ */
+void cache_network(scan_entry_s* entry, const char* ssid, const uint8_t* bssid, uint8_t channel,
+                   int8_t rssi, uint8_t round);
+
 /**
  * @brief Tries to find strongest valid connection. Connection might be
- * valid if SSID has predefined pattern (MAC address of node).
+ * valid if SSID has predefined pattern (MAC address of node). Every
+ * channel of SCAN_CHANNELS (see channel.h) is scanned on its own, and
+ * valid networks of all of them are kept in node.
  * @param node Pointer to Node_s structure.
  * @return connection status defined in node_return_codes_e.
  */
 int find_strongest_connection(Node_s* node);
 
+/**
+ * @brief Picks next strongest valid connection from results of last
+ * scan, after the one which was tried before, see relay_candidate().
+ * @param node Pointer to Node_s structure.
+ * @return connection status defined in node_return_codes_e.
+ */
+int find_next_connection(Node_s* node);
+
+/**
+ * @brief Checks if network from scan can be connected to. Cluster head
+ * which relays (MULTI_HOP) skips base station, itself, cluster heads
+ * which relayed to it and those of same or higher level, any other
+ * node takes every valid network.
+ * @param node Pointer to Node_s structure.
+ * @param ssid SSID of valid network.
+ * @return true if network can be connected to.
+ */
+bool relay_candidate(Node_s* node, const char* ssid);
+
 /**
  * @brief Handles node regarding if node is cluster head or station
  * @param node Pointer to Node_s structure.
@@ -205,18 +737,19 @@ void mode_decision(Node_s* Node);
 void init_node_name (Node_s * node);
 
 /**
- * @brief Generates threshold for current round.
+ * @brief Looks up threshold for current round in table made by
+ * compiler, weighted by energy level with ELECTION_ENERGY.
  * @param node Pointer to Node_s structure.
- * @return Threshold.
+ * @return Q16 threshold, ELECTION_ONE is certain election.
  */
-float calculate_threshold(Node_s* node);
+uint32_t calculate_threshold(Node_s* node);
 
 /**
- * @brief Generates random number between 0 and 1.
- * @param none.
- * @return random number between 0 and 1.
+ * @brief Draws random number from generator of node.
+ * @param node Pointer to Node_s structure.
+ * @return Random number 0 - ELECTION_ONE-1.
  */
-float random_number(void);
+uint32_t random_number(Node_s* node);
 
 /**
  * @brief Mounts LittleFs.
@@ -240,4 +773,24 @@ void write_fs(uint16_t round, uint8_t ch_enable);
  * @return none.
  */
 void read_fs(uint16_t* round, uint8_t* ch_enable);
+
+/**
+ * @brief Reads current round and ch_enable flag from RTC memory,
+ * or from FS if RTC memory lost state (cold boot).
+ * @param node Pointer to Node_s structure.
+ * @param round Current round.
+ * @param ch_enable Flag which indicates if node can be CH for current round.
+ * @return none.
+ */
+void read_state(Node_s* node, uint16_t* round, uint8_t* ch_enable);
+
+/**
+ * @brief Writes round and ch_enable flag to RTC memory, and to FS
+ * after cold boot or on checkpoint round.
+ * @param node Pointer to Node_s structure.
+ * @param round Next round.
+ * @param ch_enable Flag which indicates if node can be CH for next round.
+ * @return none.
+ */
+void write_state(Node_s* node, uint16_t round, uint8_t ch_enable);
 #endif // INCLUDES_H_
\ No newline at end of file
@@ -0,0 +1,178 @@
+/** @file relay.h
+ *  @brief Multi-hop forwarding of cluster head uplink.
+ *
+ *  Cluster head which cannot connect to base station loses
+ *  readings of its whole cluster. With MULTI_HOP it scans
+ *  instead, connects to strongest cluster head closer to
+ *  base as a station would, and sends it the same uplink
+ *  datagrams it would send to base, each one after relay
+ *  header:
+ *
+ *  | offset | size | field                                |
+ *  |--------|------|--------------------------------------|
+ *  | 0      | 1    | RELAY_MAGIC                          |
+ *  | 1      | 1    | hops uplink made, this one included  |
+ *  | 2      | 6    | MAC address of forwarding node       |
+ *  | 8      | 1    | CRC-8 (poly 0x07) of bytes 0-7       |
+ *
+ *  Receiving cluster head merges records into its own
+ *  uplink (frames into record arena, summary into its
+ *  aggregate), and remembers most hops of merged data.
+ *
+ *  Strongest neighbour of cluster head out of range of
+ *  base is mostly out of range too, so cluster heads carry
+ *  their level, hops to base, as hex digit after MAC in
+ *  SSID. Level is 0 for cluster head which knows base
+ *  station, otherwise one more than lowest level node saw
+ *  in its last scan, RELAY_NO_ROUTE if it saw none. Uplink
+ *  goes only to lower level, and cluster head stops
+ *  listening MULTI_HOP_LEAD_MS earlier per level, so it
+ *  forwards while next one still listens.
+ *
+ *  Loops are prevented by:
+ *
+ *  - levels, which go down on every hop,
+ *  - hop count, relay which made more than
+ *    MULTI_HOP_MAX_HOPS hops is dropped, and cluster
+ *    head whose uplink would make more does not forward,
+ *  - cluster head does not forward to cluster heads which
+ *    forwarded to it in the same round, nor to itself,
+ *  - cluster head accepts relays only while it listens,
+ *    and stops its soft AP before it forwards.
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef RELAY_H_
+#define RELAY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame.h"
+
+/** This flag will make cluster head which cannot reach base station
+ *  forward its uplink through other cluster head.
+*/
+#ifndef MULTI_HOP
+#define MULTI_HOP               0
+#endif
+
+/** Most cluster head to cluster head hops of one reading.*/
+#ifndef MULTI_HOP_MAX_HOPS
+#define MULTI_HOP_MAX_HOPS      3
+#endif
+
+/** Time cluster head stops listening earlier per level, in ms.*/
+#ifndef MULTI_HOP_LEAD_MS
+#define MULTI_HOP_LEAD_MS       1500
+#endif
+
+#if MULTI_HOP_MAX_HOPS < 1 || MULTI_HOP_MAX_HOPS > 14
+#error "MULTI_HOP_MAX_HOPS must be between 1 and 14."
+#endif
+
+/** First byte of relay header.*/
+#define RELAY_MAGIC             0xA7
+
+/** Level of cluster head which knows no way to base station, one hex digit.*/
+#define RELAY_NO_ROUTE          0x0F
+
+/** Size of relay header in bytes.*/
+#define RELAY_HEADER_SIZE       9
+
+/** Largest relayed datagram.*/
+#define RELAY_DATAGRAM_SIZE     (RELAY_HEADER_SIZE + UPLINK_DATAGRAM_SIZE)
+
+/** Most cluster heads remembered as ones which forwarded to this one, soft AP limit.*/
+#define RELAY_SOURCES           8
+
+/**
+ * Relays merged by cluster head in current round.
+*/
+typedef struct
+{
+    uint8_t     hops;                   /**< Most hops of merged data.*/
+    uint8_t     count;                  /**< Number of forwarding nodes in sources.*/
+    uint8_t     sources[RELAY_SOURCES][FRAME_MAC_SIZE]; /**< MAC addresses of forwarding nodes.*/
+    uint16_t    datagrams;              /**< Number of merged datagrams.*/
+    uint16_t    dropped;                /**< Number of datagrams over hop limit.*/
+} relay_s;
+
+/**
+ * @brief Empties relay state.
+ * @param relay Pointer to relay_s structure.
+ * @return none.
+ */
+void relay_init(relay_s* relay);
+
+/**
+ * @brief Writes relay header to buffer.
+ * @param buf Buffer with at least RELAY_HEADER_SIZE free bytes.
+ * @param hops Hops uplink made, this one included.
+ * @param mac MAC address of forwarding node.
+ * @return Number of bytes written (RELAY_HEADER_SIZE).
+ */
+size_t relay_encode_header(uint8_t* buf, uint8_t hops, const uint8_t* mac);
+
+/**
+ * @brief Checks relay header and that uplink header follows it.
+ * @param buf Received datagram.
+ * @param len Length of datagram.
+ * @return true if datagram is relayed uplink.
+ */
+bool relay_is_valid(const uint8_t* buf, size_t len);
+
+/**
+ * @brief Returns hops of valid relayed datagram.
+ * @param buf Start of datagram.
+ * @return Hops uplink made.
+ */
+uint8_t relay_hops(const uint8_t* buf);
+
+/**
+ * @brief Returns MAC address of forwarding node of valid relayed datagram.
+ * @param buf Start of datagram.
+ * @return Pointer to FRAME_MAC_SIZE bytes inside datagram.
+ */
+const uint8_t* relay_mac(const uint8_t* buf);
+
+/**
+ * @brief Decides if valid relayed datagram can be merged, and
+ * remembers its forwarding node and hops if it can.
+ * @param relay Pointer to relay_s structure.
+ * @param buf Start of datagram.
+ * @param mac MAC address of receiving node.
+ * @return true if datagram is within hop limit and not own.
+ */
+bool relay_accept(relay_s* relay, const uint8_t* buf, const uint8_t* mac);
+
+/**
+ * @brief Checks if cluster head SSID names node which forwarded to
+ * this one, or this node itself.
+ * @param relay Pointer to relay_s structure.
+ * @param ssid SSID of cluster head, hex MAC address first.
+ * @param mac MAC address of this node.
+ * @return true if uplink must not be forwarded to that cluster head.
+ */
+bool relay_is_source(const relay_s* relay, const char* ssid, const uint8_t* mac);
+
+/**
+ * @brief Returns level carried in SSID of cluster head.
+ * @param ssid SSID of cluster head, hex MAC address first.
+ * @return Hops to base station, RELAY_NO_ROUTE if not known.
+ */
+uint8_t relay_level(const char* ssid);
+
+/**
+ * @brief Calculates level from lowest level seen in scan.
+ * @param lowest Lowest level of cluster heads in scan,
+ * RELAY_NO_ROUTE if there were none.
+ * @return One more than lowest, RELAY_NO_ROUTE if that is
+ * more than MULTI_HOP_MAX_HOPS.
+ */
+uint8_t relay_next_level(uint8_t lowest);
+
+#endif // RELAY_H_
@@ -0,0 +1,110 @@
+/** @file sample.h
+ *  @brief Acquisition of sensor reading from many ADC samples.
+ *
+ *  Node takes SAMPLE_COUNT samples of ADC, SAMPLE_INTERVAL_US
+ *  apart, right after wake up while radio is still in forced
+ *  sleep. Samples go to small ring buffer, and reading which
+ *  is sent is calculated from them with integer math only:
+ *
+ *  - optional median of 3 neighbouring samples (SAMPLE_MEDIAN),
+ *    which removes single sample spikes,
+ *  - oversampling and decimation, sum of all samples shifted
+ *    right so SAMPLE_EXTRA_BITS bits of resolution remain
+ *    above 10 bits of ADC (4^n samples give n more bits
+ *    when noise is at least 1 LSB).
+ *
+ *  Reading then has SAMPLE_BITS bits, and frame carries it
+ *  in its 16-bit ADC field.
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef SAMPLE_H_
+#define SAMPLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Number of samples per reading is 2^SAMPLE_COUNT_BITS.*/
+#ifndef SAMPLE_COUNT_BITS
+#define SAMPLE_COUNT_BITS       4
+#endif
+
+/** Time between two samples in us.*/
+#ifndef SAMPLE_INTERVAL_US
+#define SAMPLE_INTERVAL_US      500
+#endif
+
+/** Bits of resolution kept above 10 bits of ADC.*/
+#ifndef SAMPLE_EXTRA_BITS
+#define SAMPLE_EXTRA_BITS       0
+#endif
+
+/** Median of 3 filter applied before decimation.*/
+#ifndef SAMPLE_MEDIAN
+#define SAMPLE_MEDIAN           0
+#endif
+
+#if SAMPLE_COUNT_BITS < 0 || SAMPLE_COUNT_BITS > 6
+#error "SAMPLE_COUNT_BITS must be between 0 and 6."
+#endif
+
+#if SAMPLE_EXTRA_BITS < 0 || 2*SAMPLE_EXTRA_BITS > SAMPLE_COUNT_BITS
+#error "SAMPLE_EXTRA_BITS needs at least 4^SAMPLE_EXTRA_BITS samples."
+#endif
+
+/** Number of samples per reading.*/
+#define SAMPLE_COUNT            (1 << SAMPLE_COUNT_BITS)
+
+/** Bits of ADC sample.*/
+#define SAMPLE_ADC_BITS         10
+
+/** Bits of reading.*/
+#define SAMPLE_BITS             (SAMPLE_ADC_BITS + SAMPLE_EXTRA_BITS)
+
+/**
+ * Ring buffer of ADC samples.
+*/
+typedef struct
+{
+    uint16_t    samples[SAMPLE_COUNT];  /**< Samples, oldest at head when full.*/
+    uint8_t     head;                   /**< Index where next sample is written.*/
+    uint8_t     count;                  /**< Number of valid samples.*/
+} sample_ring_s;
+
+/**
+ * @brief Removes all samples.
+ * @param ring Ring buffer.
+ * @return none
+ */
+void sample_clear(sample_ring_s* ring);
+
+/**
+ * @brief Adds sample, overwriting oldest one when ring is full.
+ * @param ring Ring buffer.
+ * @param value ADC sample.
+ * @return none
+ */
+void sample_push(sample_ring_s* ring, uint16_t value);
+
+/**
+ * @brief Returns sample by age.
+ * @param ring Ring buffer.
+ * @param index 0 for oldest sample, up to count - 1.
+ * @return Sample.
+ */
+uint16_t sample_at(const sample_ring_s* ring, uint8_t index);
+
+/**
+ * @brief Calculates reading from samples in ring, with median
+ * filter if SAMPLE_MEDIAN is set. Missing samples (ring not full)
+ * are scaled for, so reading keeps SAMPLE_BITS bits.
+ * @param ring Ring buffer.
+ * @return Reading of SAMPLE_BITS bits, 0 if ring is empty.
+ */
+uint16_t sample_reading(const sample_ring_s* ring);
+
+#endif // SAMPLE_H_
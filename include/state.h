@@ -0,0 +1,162 @@
+/** @file state.h
+ *  @brief Round state kept in RTC memory during deep sleep.
+ *
+ *  Round counter and ch_enable flag survive deep sleep in
+ *  RTC user memory, so node does not touch flash on every
+ *  wake up. RTC memory is lost on power loss, so state is
+ *  also written to LittleFS as cold backup:
+ *
+ *  - on first round after cold boot (RTC state invalid),
+ *  - on every STATE_CHECKPOINT_ROUNDS-th round.
+ *
+ *  After power loss node continues from last checkpoint,
+ *  at most STATE_CHECKPOINT_ROUNDS-1 rounds behind.
+ *
+ *  Layout of state (multi-byte fields little endian as
+ *  stored by ESP8266):
+ *
+ *  | offset | size | field                          |
+ *  |--------|------|--------------------------------|
+ *  | 0      | 4    | CRC-8 of bytes 4-15            |
+ *  | 4      | 2    | round                          |
+ *  | 6      | 1    | ch_enable                      |
+ *  | 7      | 1    | STATE_MAGIC                    |
+ *  | 8      | 8    | used battery charge in uAs     |
+ *  | 16     | 16   | clock state (see sync.h)       |
+ *  | 32     | 4    | election random generator      |
+ *  | 36     | 1    | sequence number of last reading |
+ *
+ *  Used charge, clock state, random generator and sequence
+ *  number are kept
+ *  only in RTC memory, cold boot means power was lost, and
+ *  starts them from zero (generator from new seed).
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef STATE_H_
+#define STATE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame.h"
+#include "sync.h"
+
+/** State is written to flash every this many rounds.*/
+#ifndef STATE_CHECKPOINT_ROUNDS
+#define STATE_CHECKPOINT_ROUNDS 5
+#endif
+
+#if STATE_CHECKPOINT_ROUNDS < 1
+#error "STATE_CHECKPOINT_ROUNDS must be at least 1."
+#endif
+
+/** Marks state written by this firmware, all zero RTC memory is not valid.*/
+#define STATE_MAGIC             0xA5
+
+/**
+ * Round state as kept in RTC memory.
+*/
+typedef struct
+{
+    uint32_t    crc;                    /**< CRC-8 of rest of structure.*/
+    uint16_t    round;                  /**< Round of next wake up.*/
+    uint8_t     ch_enable;              /**< Flag which indicates if node can be CH.*/
+    uint8_t     magic;                  /**< STATE_MAGIC.*/
+    uint64_t    energy_uas;             /**< Used battery charge in uAs.*/
+    sync_s      clock;                  /**< RTC skew estimate and pending correction.*/
+    uint32_t    rng;                    /**< State of election random generator (see election.h).*/
+    uint8_t     seq;                    /**< Sequence number of last reading (see frame.h).*/
+} round_state_s;
+
+/**
+ * @brief Checks CRC and magic of state.
+ * @param state Pointer to round_state_s structure.
+ * @return true if state is valid.
+ */
+bool state_is_valid(const round_state_s* state);
+
+/**
+ * @brief Reads round and ch_enable flag from state.
+ * @param state Pointer to round_state_s structure.
+ * @param round Set to round if state is valid.
+ * @param ch_enable Set to ch_enable flag if state is valid.
+ * @return true if state is valid, round and ch_enable are untouched otherwise.
+ */
+bool state_read(const round_state_s* state, uint16_t* round, uint8_t* ch_enable);
+
+/**
+ * @brief Writes round and ch_enable flag to state.
+ * @param state Pointer to round_state_s structure.
+ * @param round Round of next wake up.
+ * @param ch_enable Flag which indicates if node can be CH.
+ * @return true if state should also be written to flash, because
+ * it was not valid before (cold boot) or checkpoint round came.
+ */
+bool state_write(round_state_s* state, uint16_t round, uint8_t ch_enable);
+
+/**
+ * @brief Returns used battery charge kept in state.
+ * @param state Pointer to round_state_s structure.
+ * @return Used charge in uAs, 0 if state is not valid.
+ */
+uint64_t state_energy(const round_state_s* state);
+
+/**
+ * @brief Writes used battery charge to valid state.
+ * @param state Pointer to round_state_s structure.
+ * @param energy_uas Used charge in uAs.
+ * @return true if state was valid and is updated.
+ */
+bool state_set_energy(round_state_s* state, uint64_t energy_uas);
+
+/**
+ * @brief Returns clock state kept in state.
+ * @param state Pointer to round_state_s structure.
+ * @param clock Set to clock state, zeroed if state is not valid.
+ * @return none.
+ */
+void state_clock(const round_state_s* state, sync_s* clock);
+
+/**
+ * @brief Writes clock state to valid state.
+ * @param state Pointer to round_state_s structure.
+ * @param clock Clock state.
+ * @return true if state was valid and is updated.
+ */
+bool state_set_clock(round_state_s* state, const sync_s* clock);
+
+/**
+ * @brief Returns election random generator state kept in state.
+ * @param state Pointer to round_state_s structure.
+ * @return Generator state, 0 if state is not valid.
+ */
+uint32_t state_rng(const round_state_s* state);
+
+/**
+ * @brief Writes election random generator state to valid state.
+ * @param state Pointer to round_state_s structure.
+ * @param rng Generator state.
+ * @return true if state was valid and is updated.
+ */
+bool state_set_rng(round_state_s* state, uint32_t rng);
+
+/**
+ * @brief Returns sequence number of last reading kept in state.
+ * @param state Pointer to round_state_s structure.
+ * @return Sequence number, 0 if state is not valid.
+ */
+uint8_t state_seq(const round_state_s* state);
+
+/**
+ * @brief Writes sequence number of last reading to valid state.
+ * @param state Pointer to round_state_s structure.
+ * @param seq Sequence number.
+ * @return true if state was valid and is updated.
+ */
+bool state_set_seq(round_state_s* state, uint8_t seq);
+
+#endif // STATE_H_
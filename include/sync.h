@@ -0,0 +1,155 @@
+/** @file sync.h
+ *  @brief Round synchronization of nodes and RTC drift compensation.
+ *
+ *  Every node measures its round with timer1 from wake up,
+ *  and sleeps for the rest of it. Awake time is measured by
+ *  crystal, but deep sleep by RTC clock, which is off by up
+ *  to few thousand ppm. Without correction every node keeps
+ *  its own phase, nodes spread apart round after round, and
+ *  cluster head has to listen long for late stations.
+ *
+ *  Cluster head answers every station frame, repeated ones
+ *  too (station sends again when reply was lost), with sync
+ *  reply which carries time since start of its round:
+ *
+ *  | offset | size | field                                  |
+ *  |--------|------|----------------------------------------|
+ *  | 0      | 1    | SYNC_MARKER                            |
+ *  | 1      | 6    | MAC address of station frame came from |
+ *  | 7      | 4    | time since cluster head round start, us |
+ *  | 11     | 1    | CRC-8 (poly 0x07) of bytes 0-10        |
+ *
+ *  Stations may share address (see station_address()), so
+ *  reply is broadcast in soft AP subnet, and station takes
+ *  only the one which carries its MAC. Length and marker
+ *  tell reply from station frame.
+ *
+ *  Station compares it with time since start of its own
+ *  round, and the difference (offset) is:
+ *
+ *  - added to its next sleep, so it wakes with cluster head,
+ *  - divided by sleep since previous sync, which gives error
+ *    of its RTC rate. Skew estimate is moved towards it by
+ *    1/2^SYNC_GAIN_SHIFT and every sleep is scaled by it.
+ *
+ *  Station which woke more than about start of soft AP before
+ *  cluster head does not see it at all, so large offsets are
+ *  mostly late ones. Rate is taken only from offsets within
+ *  SYNC_RATE_WINDOW_US, where both signs are seen, and larger
+ *  ones correct phase only. Nodes know
+ *  rate relative to each other only, so estimate leaks to 0
+ *  by 1/2^SYNC_LEAK_SHIFT on every sync, which keeps common
+ *  part of all estimates from wandering off.
+ *
+ *  Cluster heads are stations in most rounds, so all nodes
+ *  follow each other and keep common phase. Estimate is
+ *  kept in RTC memory with round state.
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef SYNC_H_
+#define SYNC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** This flag will make cluster head answer station frames with its
+ *  round time, and nodes correct their sleep by it.
+*/
+#ifndef CLOCK_SYNC
+#define CLOCK_SYNC              1
+#endif
+
+/** Size of sync reply in bytes.*/
+#define SYNC_SIZE               12
+
+/** First byte of sync reply.*/
+#define SYNC_MARKER             0x53
+
+/** Skew estimate moves 1/2^SYNC_GAIN_SHIFT of the way to every measurement.*/
+#ifndef SYNC_GAIN_SHIFT
+#define SYNC_GAIN_SHIFT         1
+#endif
+
+/** Skew estimate leaks to 0 by 1/2^SYNC_LEAK_SHIFT on every sync.*/
+#ifndef SYNC_LEAK_SHIFT
+#define SYNC_LEAK_SHIFT         5
+#endif
+
+/** Largest offset rate is measured from, in us.*/
+#ifndef SYNC_RATE_WINDOW_US
+#define SYNC_RATE_WINDOW_US     70000
+#endif
+
+/** Largest skew node believes in, in ppb.*/
+#define SYNC_MAX_SKEW_PPB       20000000
+
+/** Shortest sleep node asks for, in us. Deep sleep of 0 never ends.*/
+#define SYNC_MIN_SLEEP_US       1000
+
+/**
+ * Clock state kept in RTC memory.
+*/
+typedef struct
+{
+    int32_t     skew_ppb;               /**< RTC rate error, positive if RTC sleeps longer than asked.*/
+    int32_t     offset_us;              /**< Correction of next sleep.*/
+    uint32_t    unsynced_us;            /**< Sleep since last sync.*/
+    uint8_t     synced;                 /**< Non zero once offset was measured.*/
+} sync_s;
+
+/**
+ * @brief Writes sync reply to buffer.
+ * @param buf Buffer with at least SYNC_SIZE free bytes.
+ * @param mac MAC address of station reply is for.
+ * @param elapsed_us Time since cluster head round start.
+ * @return Number of bytes written (SYNC_SIZE).
+ */
+size_t sync_encode(uint8_t* buf, const uint8_t* mac, uint32_t elapsed_us);
+
+/**
+ * @brief Checks that sync reply is complete and CRC is correct.
+ * @param buf Received datagram.
+ * @param len Length of datagram.
+ * @return true if reply is valid.
+ */
+bool sync_is_valid(const uint8_t* buf, size_t len);
+
+/**
+ * @brief Returns MAC address of station valid reply is for.
+ * @param buf Start of valid reply.
+ * @return Pointer to FRAME_MAC_SIZE bytes inside reply.
+ */
+const uint8_t* sync_mac(const uint8_t* buf);
+
+/**
+ * @brief Returns time since cluster head round start of valid reply.
+ * @param buf Start of valid reply.
+ * @return Time in us.
+ */
+uint32_t sync_elapsed(const uint8_t* buf);
+
+/**
+ * @brief Updates clock state with measured offset.
+ * @param sync Pointer to sync_s structure.
+ * @param offset_us Own time since round start minus the one of cluster
+ * head, positive when node woke before cluster head.
+ * @return none.
+ */
+void sync_update(sync_s* sync, int32_t offset_us);
+
+/**
+ * @brief Calculates sleep to ask RTC for, so node wakes at start of
+ * next round. Pending offset is used up. Node which is further behind
+ * than rest of round sleeps SYNC_MIN_SLEEP_US.
+ * @param sync Pointer to sync_s structure.
+ * @param sleep_us Rest of round by crystal clock.
+ * @return Sleep time for RTC.
+ */
+uint64_t sync_sleep(sync_s* sync, uint64_t sleep_us);
+
+#endif // SYNC_H_
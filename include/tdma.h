@@ -0,0 +1,135 @@
+/** @file tdma.h
+ *  @brief Slots of station transmissions within cluster.
+ *
+ *  Stations wake together after sleeping_time() and send
+ *  as soon as they associate. UDP broadcasts have no
+ *  MAC layer retry, so frames which overlap are lost.
+ *
+ *  With TDMA_SCHEDULE, part of every round starting at
+ *  TDMA_START_MS of round time is split into TDMA_SLOTS
+ *  slots of TDMA_SLOT_MS. Station takes slot from hash
+ *  of its MAC and round (channel_hash()), keeps radio off until
+ *  TDMA_LEAD_MS before slot and scans, turns it off again
+ *  until TDMA_CONNECT_MS before slot and associates, waits
+ *  associated for what is left, sends and goes to deep
+ *  sleep. While radio is off only CPU runs (modem sleep),
+ *  light sleep would stop timer1 which keeps round time.
+ *  Station which connected after its slot began sends at
+ *  once. Cluster head listens until last slot ends, then
+ *  for TDMA_TAIL_MS more while stations refused by other
+ *  soft AP come, not for adaptive window. It stops early
+ *  after last slot when every associated station reported
+ *  and no other came for a while, and never listens longer than WAIT_FOR_PACKETS (see
+ *  includes.h), which schedule with tail has to fit in.
+ *
+ *  Round time of nodes is common phase kept by
+ *  CLOCK_SYNC (see sync.h), slot length covers what is
+ *  left of phase error. Nothing is announced, so two
+ *  stations of cluster can still get the same slot. With
+ *  CLOCK_SYNC, station whose frame got no sync reply sends
+ *  it once more in later slot picked from other bits of
+ *  that hash (tdma_retry_slot()), so stations which shared
+ *  slot mostly part.
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef TDMA_H_
+#define TDMA_H_
+
+#include <stdint.h>
+#include "channel.h"
+
+/** This flag will make stations send in slots, and cluster head
+ *  listen only until last slot ends.
+*/
+#ifndef TDMA_SCHEDULE
+#define TDMA_SCHEDULE           0
+#endif
+
+/** Number of slots in round.*/
+#ifndef TDMA_SLOTS
+#define TDMA_SLOTS              16
+#endif
+
+/** Length of slot in ms.*/
+#ifndef TDMA_SLOT_MS
+#define TDMA_SLOT_MS            150
+#endif
+
+/** Round time in ms when first slot begins, after most stations
+ *  scanned and associated.
+*/
+#ifndef TDMA_START_MS
+#define TDMA_START_MS           1500
+#endif
+
+/** Time in ms station needs from association to address, radio is
+ *  turned on again this long before its slot.
+*/
+#ifndef TDMA_CONNECT_MS
+#define TDMA_CONNECT_MS         880
+#endif
+
+/** Time in ms station needs from scan to address, radio is turned on
+ *  this long before its slot. Scan takes about 120 ms for every
+ *  channel of SCAN_CHANNELS (see channel.h).
+*/
+#ifndef TDMA_LEAD_MS
+#define TDMA_LEAD_MS            (TDMA_CONNECT_MS + 120 * channel_count(SCAN_CHANNELS))
+#endif
+
+/** Time in ms cluster head listens after last slot ends. Station
+ *  refused by full soft AP associates with next one from its scan,
+ *  and sends at once when its slot already passed.
+*/
+#ifndef TDMA_TAIL_MS
+#define TDMA_TAIL_MS            TDMA_CONNECT_MS
+#endif
+
+#if TDMA_SLOTS < 1 || TDMA_SLOTS > 255
+#error "TDMA_SLOTS must be between 1 and 255."
+#endif
+
+#if TDMA_SLOT_MS < 1 || TDMA_START_MS < 0 || TDMA_START_MS + TDMA_SLOTS * TDMA_SLOT_MS > 20000
+#error "TDMA schedule must end within 20 s of round time."
+#endif
+
+/**
+ * @brief Picks slot of station.
+ * @param mac MAC address of station, 6 bytes.
+ * @param round Round of station.
+ * @return Slot 0 - TDMA_SLOTS-1.
+ */
+uint8_t tdma_slot(const uint8_t* mac, uint8_t round);
+
+/**
+ * @brief Picks later slot for station whose frame was not answered.
+ * @param mac MAC address of station, 6 bytes.
+ * @param round Round of station.
+ * @param slot Slot frame was sent in, replaced with later one.
+ * @return false if there is no later slot.
+ */
+bool tdma_retry_slot(const uint8_t* mac, uint8_t round, uint8_t* slot);
+
+/**
+ * @brief Returns how long station waits for its slot.
+ * @param slot Slot of station.
+ * @param elapsed_ms Round time of station in ms.
+ * @param lead_ms Wait ends this long before slot begins.
+ * @return Time in ms, 0 if that time already passed.
+ */
+uint32_t tdma_wait_ms(uint8_t slot, uint32_t elapsed_ms, uint32_t lead_ms);
+
+/**
+ * @brief Returns how long cluster head listens.
+ * @param elapsed_ms Round time of cluster head in ms.
+ * @param tail_ms Listening ends this long after last slot ends.
+ * @return Time in ms, 0 if that time already passed.
+ */
+uint32_t tdma_window_ms(uint32_t elapsed_ms, uint32_t tail_ms);
+
+#endif // TDMA_H_
@@ -0,0 +1,132 @@
+/** @file trace.h
+ *  @brief Per-phase timestamps of one wake up.
+ *
+ *  With PHASE_TRACE node writes CPU cycle counter into
+ *  small ring buffer at end of every phase of its round,
+ *  and prints it as one line just before deep sleep:
+ *
+ *      TRACE <MAC> <round> <C|S> <phase>=<us> ...
+ *
+ *  C marks cluster head and S station, us is duration of
+ *  phase in microseconds, measured from end of previous
+ *  phase. First phase (boot) is measured from reset, as
+ *  cycle counter starts at 0 after deep sleep wake up.
+ *  Phases are listed in order they ended.
+ *
+ *  Marking costs one cycle counter read and one store,
+ *  line is printed after last mark, so serial output
+ *  does not show in measured phases.
+ *
+ *  Cycle counter is 32 bit, at 80 MHz it wraps every
+ *  53 s, which is longer than any round, so durations
+ *  are plain unsigned differences.
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Flag which will make node trace its phases.*/
+#ifndef PHASE_TRACE
+#define PHASE_TRACE             0
+#endif
+
+/** Number of marks kept, older marks are overwritten.*/
+#define TRACE_CAPACITY          16
+
+/** Longest trace line, terminating zero included.*/
+#define TRACE_LINE_SIZE         256
+
+/** Start of trace line.*/
+#define TRACE_PREFIX            "TRACE"
+
+/**
+ * Phases of round, each mark is written when phase ends.
+*/
+typedef enum
+{
+    TRACE_BOOT = 0,                     /**< Reset to setup().*/
+    TRACE_STATE,                        /**< Round state read (FS on cold boot).*/
+    TRACE_SAMPLE,                       /**< ADC samples taken.*/
+    TRACE_DECISION,                     /**< Cluster head decision.*/
+    TRACE_SCAN,                         /**< Scan for cluster heads.*/
+    TRACE_CONNECT,                      /**< Association (and DHCP).*/
+    TRACE_SEND,                         /**< Frame sent to cluster head.*/
+    TRACE_AP_START,                     /**< Soft AP started.*/
+    TRACE_RECEIVE,                      /**< Receive window of cluster head.*/
+    TRACE_UPLINK,                       /**< Uplink sent to base.*/
+    TRACE_SLEEP,                        /**< State written, going to deep sleep.*/
+    TRACE_PHASES
+} trace_phase_e;
+
+/**
+ * Single mark.
+*/
+typedef struct
+{
+    uint32_t    cycles;                 /**< Cycle counter at end of phase.*/
+    uint8_t     phase;                  /**< trace_phase_e.*/
+} trace_mark_s;
+
+/**
+ * Ring buffer of marks of current round.
+*/
+typedef struct
+{
+    trace_mark_s marks[TRACE_CAPACITY]; /**< Marks, oldest at head when full.*/
+    uint8_t     head;                   /**< Index where next mark is written.*/
+    uint8_t     count;                  /**< Number of valid marks.*/
+} trace_s;
+
+/**
+ * @brief Empties trace.
+ * @param trace Pointer to trace_s structure.
+ * @return none.
+ */
+void trace_clear(trace_s* trace);
+
+/**
+ * @brief Writes end of phase to trace, overwriting oldest mark if full.
+ * @param trace Pointer to trace_s structure.
+ * @param phase Phase which ended.
+ * @param cycles Cycle counter now.
+ * @return none.
+ */
+void trace_mark(trace_s* trace, uint8_t phase, uint32_t cycles);
+
+/**
+ * @brief Returns name of phase, as used in trace line.
+ * @param phase trace_phase_e.
+ * @return Name of phase, or "unknown".
+ */
+const char* trace_phase_name(uint8_t phase);
+
+/**
+ * @brief Finds phase by its name.
+ * @param name Name of phase.
+ * @param len Length of name.
+ * @return trace_phase_e, or TRACE_PHASES if name is not known.
+ */
+uint8_t trace_phase_by_name(const char* name, size_t len);
+
+/**
+ * @brief Writes trace line (without line end).
+ * @param buf Buffer with at least TRACE_LINE_SIZE free bytes.
+ * @param trace Pointer to trace_s structure.
+ * @param mac MAC address of node.
+ * @param round Current round.
+ * @param cluster_head True if node is cluster head in this round.
+ * @param cycles_per_us CPU clock in MHz.
+ * @return Length of line.
+ */
+size_t trace_format(char* buf, const trace_s* trace, const uint8_t* mac, uint16_t round,
+                    bool cluster_head, uint32_t cycles_per_us);
+
+#endif // TRACE_H_
@@ -0,0 +1,100 @@
+/** @file window.h
+ *  @brief Timeouts sized from times observed in earlier rounds.
+ *
+ *  Cluster head listens for station frames for a window, and
+ *  station waits for association with a timeout. Fixed ones
+ *  have to cover worst network, and in stable network most
+ *  of awake time is spent waiting for nothing.
+ *
+ *  Node instead keeps histogram of observed times (arrival
+ *  of station frames at cluster head, time to connect at
+ *  station) in WINDOW_BUCKETS buckets of equal width up to
+ *  fixed maximum. Histogram is kept in RTC memory together
+ *  with scan cache, so it survives deep sleep. Counts are
+ *  halved when they add up to WINDOW_HISTORY, so old rounds
+ *  fade out and histogram follows changes in network.
+ *
+ *  Next timeout is upper edge of bucket which holds given
+ *  percentile of observed times, plus margin, kept between
+ *  given minimum and the fixed maximum. Empty histogram
+ *  (first rounds, cold boot) gives maximum.
+ *
+ *  Times which ran out (station associated but did not
+ *  report, connect timed out) are added at maximum, so
+ *  window which became too short grows back.
+ *
+ *  This file does not depend on Arduino, so host tools
+ *  can use it as well.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef WINDOW_H_
+#define WINDOW_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** This flag will make cluster head receive window and station
+ *  connect timeout follow observed times, 0 keeps them fixed.
+*/
+#ifndef ADAPTIVE_WINDOW
+#define ADAPTIVE_WINDOW         1
+#endif
+
+/** Number of histogram buckets.*/
+#define WINDOW_BUCKETS          16
+
+/** Counts are halved when they add up to this many observations.*/
+#ifndef WINDOW_HISTORY
+#define WINDOW_HISTORY          64
+#endif
+
+/** Percentile of observed times window has to cover.*/
+#ifndef WINDOW_PERCENTILE
+#define WINDOW_PERCENTILE       99
+#endif
+
+#if WINDOW_HISTORY < 2 || WINDOW_HISTORY > 255
+#error "WINDOW_HISTORY must be between 2 and 255."
+#endif
+
+#if WINDOW_PERCENTILE < 1 || WINDOW_PERCENTILE > 100
+#error "WINDOW_PERCENTILE must be between 1 and 100."
+#endif
+
+/**
+ * Histogram of observed times.
+*/
+typedef struct
+{
+    uint8_t     counts[WINDOW_BUCKETS]; /**< Observations per bucket of max_ms / WINDOW_BUCKETS.*/
+} window_s;
+
+/**
+ * @brief Adds observed time to histogram.
+ * @param window Pointer to window_s structure.
+ * @param ms Observed time, times past max_ms go to last bucket.
+ * @param max_ms Time covered by histogram.
+ * @return none.
+ */
+void window_add(window_s* window, uint32_t ms, uint32_t max_ms);
+
+/**
+ * @brief Returns number of observations in histogram.
+ * @param window Pointer to window_s structure.
+ * @return Number of observations.
+ */
+uint32_t window_count(const window_s* window);
+
+/**
+ * @brief Calculates timeout which covers WINDOW_PERCENTILE of observed times.
+ * @param window Pointer to window_s structure.
+ * @param min_ms Shortest timeout.
+ * @param max_ms Time covered by histogram, and longest timeout.
+ * @param margin_ms Time added to percentile.
+ * @return Timeout in ms, max_ms if histogram is empty.
+ */
+uint32_t window_timeout(const window_s* window, uint32_t min_ms, uint32_t max_ms, uint32_t margin_ms);
+
+#endif // WINDOW_H_
@@ -0,0 +1,132 @@
+/** @file Arduino.h
+ *  @brief Host replacement for ESP8266 Arduino core.
+ *
+ *  Provides only part of Arduino API node code uses.
+ *  Every call is executed on behalf of node returned by
+ *  sim_current(), and costs virtual time of that node.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t     uint8;
+typedef uint16_t    uint16;
+typedef uint32_t    uint32;
+typedef int8_t      sint8;
+typedef int16_t     sint16;
+typedef int32_t     sint32;
+
+#define LOW             0
+#define HIGH            1
+#define INPUT           0
+#define OUTPUT          1
+#define LED_BUILTIN     2
+#define A0              17
+#define F_CPU           80000000L
+
+#define TIM_DIV1        0
+#define TIM_DIV16       1
+#define TIM_DIV256      3
+#define TIM_EDGE        0
+#define TIM_LEVEL       1
+#define TIM_SINGLE      0
+#define TIM_LOOP        1
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int analogRead(uint8_t pin);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis(void);
+unsigned long micros(void);
+void yield(void);
+
+void timer1_enable(uint8_t divider, uint8_t int_type, uint8_t reload);
+void timer1_disable(void);
+void timer1_write(uint32_t ticks);
+uint32_t timer1_read(void);
+
+char* utoa(unsigned int value, char* result, int base);
+char* itoa(int value, char* result, int base);
+
+class String
+{
+public:
+    String() {}
+    String(const char* str) : _s(str ? str : "") {}
+    String(const std::string& str) : _s(str) {}
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.length(); }
+    bool operator==(const String& rhs) const { return _s == rhs._s; }
+    bool operator==(const char* rhs) const { return _s == rhs; }
+    String& operator+=(const String& rhs) { _s += rhs._s; return *this; }
+
+private:
+    std::string _s;
+};
+
+class IPAddress
+{
+public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _address(((uint32_t)a << 24) | ((uint32_t)b << 16) | ((uint32_t)c << 8) | d) {}
+    explicit IPAddress(uint32_t address) : _address(address) {}
+    uint8_t operator[](int index) const { return (_address >> (8 * (3 - index))) & 0xFF; }
+    uint32_t v4() const { return _address; }
+    bool isSet() const { return _address != 0; }
+    bool operator==(const IPAddress& rhs) const { return _address == rhs._address; }
+    String toString() const;
+
+private:
+    uint32_t _address;          /**< Address in host order, first octet in top byte.*/
+};
+
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baud);
+    size_t print(const char* str);
+    size_t print(const String& str);
+    size_t print(char c);
+    size_t print(unsigned char n);
+    size_t print(int n);
+    size_t print(unsigned int n);
+    size_t print(long n);
+    size_t print(unsigned long n);
+    size_t print(double n, int digits = 2);
+    size_t print(const IPAddress& ip);
+    size_t println(void);
+    template <typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+    size_t println(double n, int digits) { size_t c = print(n, digits); return c + println(); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void flush(void);
+};
+
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+    void deepSleep(uint64_t time_us);
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size);
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size);
+    uint32_t getFreeHeap(void);
+    uint32_t getChipId(void);
+    uint32_t getCycleCount(void);
+};
+
+extern EspClass ESP;
+
+#endif // ARDUINO_H_
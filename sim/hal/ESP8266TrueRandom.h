@@ -0,0 +1,25 @@
+/** @file ESP8266TrueRandom.h
+ *  @brief Host replacement for ESP8266TrueRandom library.
+ *
+ *  Numbers come from seeded generator of current node,
+ *  so simulation is repeatable.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef ESP8266TRUERANDOM_H_
+#define ESP8266TRUERANDOM_H_
+
+#include "Arduino.h"
+
+class ESP8266TrueRandomClass
+{
+public:
+    int32_t random(void);
+    long random(long howBig);
+    long random(long howSmall, long howBig);
+};
+
+extern ESP8266TrueRandomClass ESP8266TrueRandom;
+
+#endif // ESP8266TRUERANDOM_H_
@@ -0,0 +1,74 @@
+/** @file ESP8266WiFi.h
+ *  @brief Host replacement for ESP8266WiFi library.
+ *
+ *  Scan, association and soft AP are served by radio
+ *  medium of simulator.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef ESP8266WIFI_H_
+#define ESP8266WIFI_H_
+
+#include "Arduino.h"
+#include "user_interface.h"
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} WiFiMode_t;
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_WRONG_PASSWORD = 6,
+    WL_DISCONNECTED = 7
+} wl_status_t;
+
+class ESP8266WiFiClass
+{
+public:
+    bool mode(WiFiMode_t mode);
+    WiFiMode_t getMode(void);
+    void persistent(bool persistent);
+    bool disconnect(bool wifioff = false);
+    bool forceSleepBegin(uint32_t sleepUs = 0);
+    bool forceSleepWake(void);
+
+    wl_status_t begin(const char* ssid, const char* passphrase = NULL, int32_t channel = 0,
+                      const uint8_t* bssid = NULL, bool connect = true);
+    wl_status_t begin(const String& ssid, const String& passphrase = String(), int32_t channel = 0,
+                      const uint8_t* bssid = NULL, bool connect = true);
+    bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+                IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    wl_status_t status(void);
+    IPAddress localIP(void);
+    IPAddress dnsIP(uint8_t dns_no = 0);
+    IPAddress gatewayIP(void);
+
+    bool softAP(const char* ssid, const char* passphrase = NULL, int channel = 1,
+                int ssid_hidden = 0, int max_connection = 4);
+    bool softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet);
+    IPAddress softAPIP(void);
+
+    int8_t scanNetworks(bool async = false, bool show_hidden = false, uint8_t channel = 0,
+                        uint8_t* ssid = NULL);
+    String SSID(uint8_t networkItem);
+    uint8_t* BSSID(uint8_t networkItem);
+    uint8_t* BSSID(void);
+    int32_t RSSI(uint8_t networkItem);
+    int32_t RSSI(void);
+    int32_t channel(uint8_t networkItem);
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif // ESP8266WIFI_H_
@@ -0,0 +1,49 @@
+/** @file FS.h
+ *  @brief Host replacement for ESP8266 file system API.
+ *
+ *  Files are kept per node in memory of simulator.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef FS_H_
+#define FS_H_
+
+#include <vector>
+#include "Arduino.h"
+
+namespace fs {
+
+class File
+{
+public:
+    File() : _data(NULL), _pos(0), _write(false) {}
+    File(std::vector<uint8_t>* data, bool write) : _data(data), _pos(0), _write(write) {}
+    operator bool() const { return _data != NULL; }
+    size_t write(const uint8_t* buf, size_t size);
+    size_t read(uint8_t* buf, size_t size);
+    int available(void) { return _data ? (int)(_data->size() - _pos) : 0; }
+    size_t size(void) { return _data ? _data->size() : 0; }
+    void close(void);
+
+private:
+    std::vector<uint8_t>* _data;
+    size_t      _pos;
+    bool        _write;
+};
+
+class FS
+{
+public:
+    bool begin(void);
+    File open(const char* path, const char* mode);
+    bool exists(const char* path);
+    bool remove(const char* path);
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif // FS_H_
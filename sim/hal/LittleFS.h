@@ -0,0 +1,14 @@
+/** @file LittleFS.h
+ *  @brief Host replacement for LittleFS.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef LITTLEFS_H_
+#define LITTLEFS_H_
+
+#include "FS.h"
+
+extern fs::FS LittleFS;
+
+#endif // LITTLEFS_H_
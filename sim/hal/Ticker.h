@@ -0,0 +1,14 @@
+/** @file Ticker.h
+ *  @brief Host replacement for Ticker library (not used by node code).
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef TICKER_H_
+#define TICKER_H_
+
+class Ticker
+{
+};
+
+#endif // TICKER_H_
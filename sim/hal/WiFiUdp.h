@@ -0,0 +1,47 @@
+/** @file WiFiUdp.h
+ *  @brief Host replacement for WiFiUDP class.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef WIFIUDP_H_
+#define WIFIUDP_H_
+
+#include <vector>
+#include "Arduino.h"
+
+#define UDP_TX_PACKET_MAX_SIZE 8192
+
+class WiFiUDP
+{
+public:
+    WiFiUDP() : _port(0), _rx_pos(0), _remote_port(0), _tx_port(0) {}
+    uint8_t begin(uint16_t port);
+    void stop(void);
+    int parsePacket(void);
+    int available(void);
+    int read(void);
+    int read(unsigned char* buffer, size_t len);
+    int read(char* buffer, size_t len) { return read((unsigned char*)buffer, len); }
+    IPAddress remoteIP(void) { return _remote_ip; }
+    uint16_t remotePort(void) { return _remote_port; }
+    IPAddress destinationIP(void);
+    uint16_t localPort(void) { return _port; }
+    int beginPacket(IPAddress ip, uint16_t port);
+    int endPacket(void);
+    size_t write(uint8_t byte);
+    size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+
+private:
+    uint16_t    _port;
+    std::vector<uint8_t> _rx;
+    size_t      _rx_pos;
+    IPAddress   _remote_ip;
+    uint16_t    _remote_port;
+    std::vector<uint8_t> _tx;
+    IPAddress   _tx_ip;
+    uint16_t    _tx_port;
+};
+
+#endif // WIFIUDP_H_
@@ -0,0 +1,812 @@
+/** @file hal.cpp
+ *  @brief
+ *
+ *  This file implements host replacements of Arduino,
+ *  ESP8266WiFi, WiFiUDP, LittleFS and ESP8266TrueRandom
+ *  on top of simulated node returned by sim_current().
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <stdarg.h>
+#include "propagation.h"
+
+/** Longest deep sleep SDK accepts, longer requests are clamped.*/
+#define MAX_DEEP_SLEEP_US       (3ULL * 3600 * 1000000)
+
+HardwareSerial Serial;
+EspClass ESP;
+ESP8266WiFiClass WiFi;
+fs::FS LittleFS;
+ESP8266TrueRandomClass ESP8266TrueRandom;
+
+static size_t serial_write(const char* txt, size_t len)
+{
+    sim_node_s* node = sim_current();
+
+    if (node->serial_enabled) {
+        if ((int32_t)node->id == Network.config.trace_node) {
+            fwrite(txt, 1, len, stdout);
+        }
+        // 10 bits per character on the wire.
+        sim_advance(node, (uint64_t)len * 10 * 1000000 / node->baud);
+    }
+
+    return len;
+}
+
+static size_t serial_format(const char* format, ...)
+{
+    char txt[64];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(txt, sizeof(txt), format, args);
+    va_end(args);
+
+    return serial_write(txt, strlen(txt));
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+}
+
+int analogRead(uint8_t pin)
+{
+    sim_node_s* node = sim_current();
+
+    sim_advance(node, Network.config.adc_us);
+
+    return sim_sensor_value(node);
+}
+
+void delay(unsigned long ms)
+{
+    sim_advance(sim_current(), (uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    sim_advance(sim_current(), us);
+}
+
+unsigned long millis(void)
+{
+    sim_node_s* node = sim_current();
+
+    return (node->now_us - node->wake_us) / 1000;
+}
+
+unsigned long micros(void)
+{
+    sim_node_s* node = sim_current();
+
+    return node->now_us - node->wake_us;
+}
+
+void yield(void)
+{
+    sim_node_s* node = sim_current();
+    uint64_t next = sim_next_pending(node);
+    uint64_t step = node->now_us + Network.config.yield_step_us;
+
+    if (next > step) {
+        next = step;
+    }
+    sim_advance(node, next - node->now_us);
+}
+
+void timer1_enable(uint8_t divider, uint8_t int_type, uint8_t reload)
+{
+    sim_current()->timer1_enabled = true;
+}
+
+void timer1_disable(void)
+{
+    sim_current()->timer1_enabled = false;
+}
+
+void timer1_write(uint32_t ticks)
+{
+    sim_node_s* node = sim_current();
+
+    node->timer1_load = ticks;
+    node->timer1_start_us = node->now_us;
+}
+
+uint32_t timer1_read(void)
+{
+    sim_node_s* node = sim_current();
+    uint64_t elapsed;
+
+    if (node->timer1_enabled == false) {
+        return 0;
+    }
+
+    elapsed = (node->now_us - node->timer1_start_us) * 1000 / SIM_TIMER1_TICK_NS;
+
+    return elapsed < node->timer1_load ? node->timer1_load - elapsed : 0;
+}
+
+char* utoa(unsigned int value, char* result, int base)
+{
+    char tmp[33];
+    int i = 0;
+    int j = 0;
+
+    do {
+        tmp[i++] = "0123456789abcdefghijklmnopqrstuvwxyz"[value % base];
+        value /= base;
+    } while (value != 0);
+
+    while (i > 0) {
+        result[j++] = tmp[--i];
+    }
+    result[j] = '\0';
+
+    return result;
+}
+
+char* itoa(int value, char* result, int base)
+{
+    if (value < 0 && base == 10) {
+        result[0] = '-';
+        utoa(-(unsigned int)value, result + 1, base);
+        return result;
+    }
+
+    return utoa((unsigned int)value, result, base);
+}
+
+String IPAddress::toString() const
+{
+    char txt[16];
+
+    snprintf(txt, sizeof(txt), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+
+    return String(txt);
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    sim_node_s* node = sim_current();
+
+    node->serial_enabled = true;
+    node->baud = baud;
+}
+
+size_t HardwareSerial::print(const char* str)
+{
+    return serial_write(str, strlen(str));
+}
+
+size_t HardwareSerial::print(const String& str)
+{
+    return serial_write(str.c_str(), str.length());
+}
+
+size_t HardwareSerial::print(char c)
+{
+    return serial_write(&c, 1);
+}
+
+size_t HardwareSerial::print(unsigned char n)
+{
+    return serial_format("%u", n);
+}
+
+size_t HardwareSerial::print(int n)
+{
+    return serial_format("%d", n);
+}
+
+size_t HardwareSerial::print(unsigned int n)
+{
+    return serial_format("%u", n);
+}
+
+size_t HardwareSerial::print(long n)
+{
+    return serial_format("%ld", n);
+}
+
+size_t HardwareSerial::print(unsigned long n)
+{
+    return serial_format("%lu", n);
+}
+
+size_t HardwareSerial::print(double n, int digits)
+{
+    return serial_format("%.*f", digits, n);
+}
+
+size_t HardwareSerial::print(const IPAddress& ip)
+{
+    return print(ip.toString());
+}
+
+size_t HardwareSerial::println(void)
+{
+    return serial_write("\r\n", 2);
+}
+
+void HardwareSerial::flush(void)
+{
+    // serial_write() already charged time of every character.
+}
+
+size_t HardwareSerial::printf(const char* format, ...)
+{
+    char txt[256];
+    va_list args;
+
+    va_start(args, format);
+    int n = vsnprintf(txt, sizeof(txt), format, args);
+    va_end(args);
+
+    if (n < 0) {
+        return 0;
+    }
+
+    return serial_write(txt, strlen(txt));
+}
+
+void EspClass::deepSleep(uint64_t time_us)
+{
+    sim_node_s* node = sim_current();
+
+    if (time_us > MAX_DEEP_SLEEP_US) {
+        time_us = MAX_DEEP_SLEEP_US;
+    }
+
+    sim_ap_stop(node);
+    sim_disconnect(node);
+    sim_radio(node, false);
+    node->sleep_us = time_us;
+    node->asleep = true;
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size)
+{
+    sim_node_s* node = sim_current();
+
+    if (offset * 4 + size > SIM_RTC_MEMORY_SIZE || size == 0) {
+        return false;
+    }
+    memcpy(data, node->rtc_memory + offset * 4, size);
+
+    return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size)
+{
+    sim_node_s* node = sim_current();
+
+    if (offset * 4 + size > SIM_RTC_MEMORY_SIZE || size == 0) {
+        return false;
+    }
+    memcpy(node->rtc_memory + offset * 4, data, size);
+
+    return true;
+}
+
+uint32_t EspClass::getFreeHeap(void)
+{
+    return 45000;
+}
+
+uint32_t EspClass::getChipId(void)
+{
+    sim_node_s* node = sim_current();
+
+    return ((uint32_t)node->mac[3] << 16) | ((uint32_t)node->mac[4] << 8) | node->mac[5];
+}
+
+uint32_t EspClass::getCycleCount(void)
+{
+    sim_node_s* node = sim_current();
+
+    // counter starts from 0 at reset, which is wake up from deep sleep.
+    return (uint32_t)((node->now_us - node->wake_us) * (F_CPU / 1000000));
+}
+
+bool wifi_get_macaddr(uint8 if_index, uint8* macaddr)
+{
+    sim_node_s* node = sim_current();
+
+    memcpy(macaddr, node->mac, 6);
+    if (if_index == SOFTAP_IF) {
+        macaddr[0] |= 0x02;
+    }
+
+    return true;
+}
+
+uint8 wifi_softap_get_station_num(void)
+{
+    sim_node_s* node = sim_current();
+    uint8 count = 0;
+
+    // stations are not removed when they go to deep sleep, like in SDK
+    // which keeps them until inactivity timeout.
+    if (node->ap_up == true) {
+        for (size_t i = 0; i < node->ap_stations_us.size(); i++) {
+            if (node->ap_stations_us[i] <= node->now_us) {
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+static void wifi_enable(sim_node_s* node, uint8_t mode)
+{
+    if (node->radio_on == false) {
+        sim_radio(node, true);
+        sim_advance(node, Network.config.radio_wake_us);
+    }
+    node->wifi_mode |= mode;
+}
+
+bool ESP8266WiFiClass::mode(WiFiMode_t m)
+{
+    sim_node_s* node = sim_current();
+
+    if ((m & WIFI_AP) == 0) {
+        sim_ap_stop(node);
+    }
+    if ((m & WIFI_STA) == 0) {
+        sim_disconnect(node);
+    }
+
+    if (m == WIFI_OFF) {
+        node->wifi_mode = WIFI_OFF;
+    }
+    else {
+        wifi_enable(node, m);
+        node->wifi_mode = m;
+    }
+
+    return true;
+}
+
+WiFiMode_t ESP8266WiFiClass::getMode(void)
+{
+    return (WiFiMode_t)sim_current()->wifi_mode;
+}
+
+void ESP8266WiFiClass::persistent(bool persistent)
+{
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifioff)
+{
+    sim_disconnect(sim_current());
+
+    if (wifioff) {
+        mode(WIFI_OFF);
+    }
+
+    return true;
+}
+
+bool ESP8266WiFiClass::forceSleepBegin(uint32_t sleepUs)
+{
+    sim_node_s* node = sim_current();
+
+    sim_ap_stop(node);
+    sim_disconnect(node);
+    sim_radio(node, false);
+    node->wifi_mode = WIFI_OFF;
+
+    return true;
+}
+
+bool ESP8266WiFiClass::forceSleepWake(void)
+{
+    wifi_enable(sim_current(), WIFI_STA);
+
+    return true;
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel,
+                                    const uint8_t* bssid, bool connect)
+{
+    sim_node_s* node = sim_current();
+
+    wifi_enable(node, WIFI_STA);
+    sim_disconnect(node);
+
+    if (connect) {
+        sim_connect(node, ssid, channel, bssid);
+    }
+
+    return status();
+}
+
+wl_status_t ESP8266WiFiClass::begin(const String& ssid, const String& passphrase, int32_t channel,
+                                    const uint8_t* bssid, bool connect)
+{
+    return begin(ssid.c_str(), passphrase.c_str(), channel, bssid, connect);
+}
+
+bool ESP8266WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+                              IPAddress dns1, IPAddress dns2)
+{
+    // address 0 turns DHCP back on.
+    sim_current()->static_ip = local_ip.v4();
+
+    return true;
+}
+
+wl_status_t ESP8266WiFiClass::status(void)
+{
+    sim_node_s* node = sim_current();
+
+    if (node->now_us < node->connected_us) {
+        return WL_DISCONNECTED;
+    }
+
+    return (wl_status_t)node->connect_status;
+}
+
+IPAddress ESP8266WiFiClass::localIP(void)
+{
+    return status() == WL_CONNECTED ? IPAddress(sim_current()->ip) : IPAddress();
+}
+
+IPAddress ESP8266WiFiClass::dnsIP(uint8_t dns_no)
+{
+    return gatewayIP();
+}
+
+IPAddress ESP8266WiFiClass::gatewayIP(void)
+{
+    sim_node_s* node = sim_current();
+
+    if (status() != WL_CONNECTED) {
+        return IPAddress();
+    }
+
+    return IPAddress((node->ip & 0xFFFFFF00u) | 1);
+}
+
+bool ESP8266WiFiClass::softAP(const char* ssid, const char* passphrase, int channel,
+                              int ssid_hidden, int max_connection)
+{
+    sim_node_s* node = sim_current();
+
+    if (channel < 1 || channel > 13 || max_connection > 8 || strlen(ssid) > 32) {
+        return false;
+    }
+
+    wifi_enable(node, WIFI_AP);
+
+    if (node->ap_up == false) {
+        sim_ap_start(node, ssid, node->now_us + Network.config.ap_start_us, channel, max_connection);
+    }
+    else {
+        // AP was announced by scheduler, it only gets its final parameters.
+        sim_ap_start(node, ssid, node->ap_up_us, channel, max_connection);
+    }
+    sim_advance(node, Network.config.ap_start_us);
+
+    return true;
+}
+
+bool ESP8266WiFiClass::softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet)
+{
+    // every simulated soft AP has SDK default address.
+    return local_ip.v4() == (SIM_AP_SUBNET | 1) && subnet.v4() == 0xFFFFFF00u;
+}
+
+IPAddress ESP8266WiFiClass::softAPIP(void)
+{
+    return IPAddress(SIM_AP_SUBNET | 1);
+}
+
+int8_t ESP8266WiFiClass::scanNetworks(bool async, bool show_hidden, uint8_t channel, uint8_t* ssid)
+{
+    sim_node_s* node = sim_current();
+
+    wifi_enable(node, WIFI_STA);
+
+    return sim_scan(node, channel);
+}
+
+String ESP8266WiFiClass::SSID(uint8_t networkItem)
+{
+    sim_node_s* node = sim_current();
+
+    if (networkItem >= node->scan.size()) {
+        return String();
+    }
+
+    return String(sim_ap_ssid(node->scan[networkItem].ap));
+}
+
+uint8_t* ESP8266WiFiClass::BSSID(uint8_t networkItem)
+{
+    sim_node_s* node = sim_current();
+
+    return networkItem < node->scan.size() ? node->scan[networkItem].bssid : NULL;
+}
+
+uint8_t* ESP8266WiFiClass::BSSID(void)
+{
+    sim_node_s* node = sim_current();
+
+    if (status() != WL_CONNECTED) {
+        return NULL;
+    }
+    sim_ap_bssid(node->assoc, node->assoc_bssid);
+
+    return node->assoc_bssid;
+}
+
+int32_t ESP8266WiFiClass::RSSI(void)
+{
+    sim_node_s* node = sim_current();
+
+    if (status() != WL_CONNECTED) {
+        return 31; // what SDK returns when not connected.
+    }
+    return sim_prop_rssi(node, node->assoc);
+}
+
+int32_t ESP8266WiFiClass::RSSI(uint8_t networkItem)
+{
+    sim_node_s* node = sim_current();
+
+    return networkItem < node->scan.size() ? node->scan[networkItem].rssi : 0;
+}
+
+int32_t ESP8266WiFiClass::channel(uint8_t networkItem)
+{
+    sim_node_s* node = sim_current();
+
+    return networkItem < node->scan.size() ? node->scan[networkItem].channel : 0;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+    sim_node_s* node = sim_current();
+
+    _port = port;
+    node->bound_port = port;
+    node->bound_us = node->now_us;
+
+    return 1;
+}
+
+void WiFiUDP::stop(void)
+{
+    sim_node_s* node = sim_current();
+
+    if (node->bound_port == _port) {
+        node->bound_port = 0;
+    }
+    _port = 0;
+}
+
+int WiFiUDP::parsePacket(void)
+{
+    const sim_packet_s* packet = sim_udp_receive(sim_current());
+
+    _rx.clear();
+    _rx_pos = 0;
+
+    if (packet == NULL) {
+        return 0;
+    }
+
+    _rx = packet->data;
+    _remote_ip = IPAddress(packet->src_ip);
+    _remote_port = packet->src_port;
+
+    return _rx.size();
+}
+
+int WiFiUDP::available(void)
+{
+    return _rx.size() - _rx_pos;
+}
+
+int WiFiUDP::read(void)
+{
+    return _rx_pos < _rx.size() ? _rx[_rx_pos++] : -1;
+}
+
+int WiFiUDP::read(unsigned char* buffer, size_t len)
+{
+    size_t n = _rx.size() - _rx_pos;
+
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buffer, _rx.data() + _rx_pos, n);
+    _rx_pos += n;
+
+    return n;
+}
+
+IPAddress WiFiUDP::destinationIP(void)
+{
+    return IPAddress(SIM_AP_SUBNET | 0xFF);
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+    _tx.clear();
+    _tx_ip = ip;
+    _tx_port = port;
+
+    return 1;
+}
+
+int WiFiUDP::endPacket(void)
+{
+    bool sent = sim_udp_send(sim_current(), _tx_ip.v4(), _tx_port, _tx.data(), _tx.size());
+
+    _tx.clear();
+
+    return sent ? 1 : 0;
+}
+
+size_t WiFiUDP::write(uint8_t byte)
+{
+    _tx.push_back(byte);
+
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size)
+{
+    _tx.insert(_tx.end(), buffer, buffer + size);
+
+    return size;
+}
+
+namespace fs {
+
+size_t File::write(const uint8_t* buf, size_t size)
+{
+    if (_data == NULL || _write == false) {
+        return 0;
+    }
+
+    _data->insert(_data->end(), buf, buf + size);
+
+    return size;
+}
+
+size_t File::read(uint8_t* buf, size_t size)
+{
+    size_t n;
+
+    if (_data == NULL) {
+        return 0;
+    }
+
+    n = _data->size() - _pos;
+    if (n > size) {
+        n = size;
+    }
+    memcpy(buf, _data->data() + _pos, n);
+    _pos += n;
+
+    return n;
+}
+
+void File::close(void)
+{
+    sim_node_s* node = sim_current();
+
+    if (_data != NULL && _write == true) {
+        sim_advance(node, Network.config.fs_write_us);
+        node->stats.flash_writes++;
+    }
+    _data = NULL;
+}
+
+static sim_file_s* find_file(sim_node_s* node, const char* path)
+{
+    for (size_t i = 0; i < node->files.size(); i++) {
+        if (strcmp(node->files[i].name, path) == 0) {
+            return &node->files[i];
+        }
+    }
+
+    return NULL;
+}
+
+bool FS::begin(void)
+{
+    sim_advance(sim_current(), Network.config.fs_mount_us);
+
+    return true;
+}
+
+File FS::open(const char* path, const char* mode)
+{
+    sim_node_s* node = sim_current();
+    sim_file_s* file = find_file(node, path);
+
+    if (mode[0] == 'r') {
+        if (file == NULL) {
+            return File();
+        }
+        sim_advance(node, Network.config.fs_read_us);
+        return File(&file->data, false);
+    }
+
+    if (file == NULL) {
+        // files are referenced by pointer, vector must never grow past its reserve.
+        if (node->files.size() >= SIM_MAX_FILES || strlen(path) >= sizeof(file->name)) {
+            return File();
+        }
+        node->files.push_back(sim_file_s());
+        file = &node->files.back();
+        strcpy(file->name, path);
+    }
+
+    if (mode[0] == 'w') {
+        file->data.clear();
+    }
+
+    return File(&file->data, true);
+}
+
+bool FS::exists(const char* path)
+{
+    return find_file(sim_current(), path) != NULL;
+}
+
+bool FS::remove(const char* path)
+{
+    sim_node_s* node = sim_current();
+    sim_file_s* file = find_file(node, path);
+
+    if (file == NULL) {
+        return false;
+    }
+
+    node->files.erase(node->files.begin() + (file - node->files.data()));
+
+    return true;
+}
+
+} // namespace fs
+
+int32_t ESP8266TrueRandomClass::random(void)
+{
+    sim_node_s* node = sim_current();
+
+    sim_advance(node, Network.config.true_random_us);
+
+    return (int32_t)(sim_random(&node->rng) & 0x7FFFFFFF);
+}
+
+long ESP8266TrueRandomClass::random(long howBig)
+{
+    if (howBig <= 0) {
+        return 0;
+    }
+
+    return random() % howBig;
+}
+
+long ESP8266TrueRandomClass::random(long howSmall, long howBig)
+{
+    if (howSmall >= howBig) {
+        return howSmall;
+    }
+
+    return howSmall + random(howBig - howSmall);
+}
@@ -0,0 +1,18 @@
+/** @file user_interface.h
+ *  @brief Host replacement for part of ESP8266 SDK API.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef USER_INTERFACE_H_
+#define USER_INTERFACE_H_
+
+#include "Arduino.h"
+
+#define STATION_IF      0
+#define SOFTAP_IF       1
+
+bool wifi_get_macaddr(uint8 if_index, uint8* macaddr);
+uint8 wifi_softap_get_station_num(void);
+
+#endif // USER_INTERFACE_H_
@@ -0,0 +1,59 @@
+/** @file pool.h
+ *  @brief Work-stealing thread pool of simulator.
+ *
+ *  pool_run() splits task indexes into one range per
+ *  worker. Worker takes tasks from front of its own
+ *  range, and when it is empty steals back half of
+ *  range of another worker, so uneven tasks (cluster
+ *  head listening for 10 s against station which found
+ *  nothing) still keep all cores busy.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdint.h>
+
+/** Task executed for every index given to pool_run().*/
+typedef void (*pool_task_f)(uint32_t index, void* arg);
+
+/**
+ * @brief Starts worker threads. Calling thread is worker 0.
+ * @param threads Number of workers, 0 for number of cores.
+ * @return none.
+ */
+void pool_start(uint32_t threads);
+
+/**
+ * @brief Stops worker threads.
+ * @param none.
+ * @return none.
+ */
+void pool_stop(void);
+
+/**
+ * @brief Returns number of workers.
+ * @param none.
+ * @return Number of workers.
+ */
+uint32_t pool_threads(void);
+
+/**
+ * @brief Returns index of calling worker.
+ * @param none.
+ * @return Worker index.
+ */
+uint32_t pool_worker(void);
+
+/**
+ * @brief Runs task for indexes 0 .. count-1 and waits until all finish.
+ * @param count Number of tasks.
+ * @param task Function called for every index.
+ * @param arg Argument passed to task.
+ * @return none.
+ */
+void pool_run(uint32_t count, pool_task_f task, void* arg);
+
+#endif // POOL_H_
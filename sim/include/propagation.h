@@ -0,0 +1,103 @@
+/** @file propagation.h
+ *  @brief Radio propagation of simulator.
+ *
+ *  Received power is log-distance path loss plus
+ *  shadowing. Shadowing of link is gaussian with
+ *  standard deviation --shadowing, drawn from hash of
+ *  seed and ids of both ends, so it is the same in both
+ *  directions, for every run and every thread count.
+ *
+ *  Listed soft APs are kept in uniform grid with cells
+ *  as large as longest distance at which network can
+ *  still be seen, so scan looks only at 3x3 cells
+ *  around node instead of at every AP. RSSI of every
+ *  node to base station is calculated once, and links
+ *  to APs node reported in scan or joined are cached
+ *  in node until one of the ends moves.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef PROPAGATION_H_
+#define PROPAGATION_H_
+
+#include "sim.h"
+
+/** Shadowing is clamped to this many standard deviations, bounds radio range.*/
+#define SIM_SHADOW_CLAMP        3
+
+/** RSSI returned by sim_prop_peek() for AP out of range.*/
+#define SIM_OUT_OF_RANGE        INT32_MIN
+
+/**
+ * @brief Calculates radio range and grid, places every node
+ * in it and calculates its RSSI to base station. Called
+ * from sim_init().
+ * @return none.
+ */
+void sim_prop_init(void);
+
+/**
+ * @brief RSSI between node and AP, from link cache of node
+ * when there, otherwise calculated and cached.
+ * @param node Receiving node.
+ * @param ap Node id of AP (or SIM_BASE_ID).
+ * @return RSSI in dBm.
+ */
+int32_t sim_prop_rssi(sim_node_s* node, uint32_t ap);
+
+/**
+ * @brief RSSI between node and AP without caching it,
+ * for scan which looks at many more APs than it keeps.
+ * @param node Receiving node.
+ * @param ap Node id of AP.
+ * @return RSSI in dBm, SIM_OUT_OF_RANGE if AP is
+ * farther than radio range.
+ */
+int32_t sim_prop_peek(const sim_node_s* node, uint32_t ap);
+
+/**
+ * @brief Caches RSSI returned by sim_prop_peek().
+ * @param node Receiving node.
+ * @param ap Node id of AP.
+ * @param rssi RSSI in dBm.
+ * @return none.
+ */
+void sim_prop_remember(sim_node_s* node, uint32_t ap, int32_t rssi);
+
+/**
+ * @brief Adds soft AP of node to grid.
+ * @param node Node hosting soft AP.
+ * @return none.
+ */
+void sim_prop_list(sim_node_s* node);
+
+/**
+ * @brief Removes soft AP of node from grid.
+ * @param node Node hosting soft AP.
+ * @return none.
+ */
+void sim_prop_unlist(sim_node_s* node);
+
+/**
+ * @brief Grid cells around node which can hold visible APs.
+ * @param node Scanning node.
+ * @param x0 First cell in x.
+ * @param x1 Last cell in x.
+ * @param y0 First cell in y.
+ * @param y1 Last cell in y.
+ * @return none.
+ */
+void sim_prop_cells(const sim_node_s* node, uint32_t* x0, uint32_t* x1, uint32_t* y0, uint32_t* y1);
+
+/**
+ * @brief Moves node, cached links of it and to it are dropped.
+ * Must not be called while nodes run.
+ * @param node Node to move.
+ * @param x New position.
+ * @param y New position.
+ * @return none.
+ */
+void sim_prop_move(sim_node_s* node, float x, float y);
+
+#endif // PROPAGATION_H_
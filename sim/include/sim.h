@@ -0,0 +1,536 @@
+/** @file sim.h
+ *  @brief Host-side discrete-event simulator of LEACH network.
+ *
+ *  Simulator runs node code from src/functions.cpp for every
+ *  simulated node. WiFi, WiFiUDP, LittleFS, timer1 and ESP calls
+ *  are served by host implementation in sim/hal, which advances
+ *  virtual clock of the node instead of busy-waiting.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "includes.h"
+
+/** Duration of one timer1 tick with TIM_DIV256 in ns (80 MHz / 256).*/
+#define SIM_TIMER1_TICK_NS      3200
+
+/** Node id used for base station.*/
+#define SIM_BASE_ID             0xFFFFFFFFu
+
+/** Network part of soft AP subnet (192.168.4.0/24), same on every cluster head.*/
+#define SIM_AP_SUBNET           0xC0A80400u
+
+/** Network part of base station subnet (192.168.1.0/24).*/
+#define SIM_BASE_SUBNET         0xC0A80100u
+
+/** Size of ESP8266 RTC user memory in bytes.*/
+#define SIM_RTC_MEMORY_SIZE     512
+
+/** Maximum number of files in LittleFS of one node.*/
+#define SIM_MAX_FILES           8
+
+/** Marks that node is not associated with any network.*/
+#define SIM_NO_AP               0xFFFFFFFEu
+
+/** Slots of per channel counters, indexed by WiFi channel 1 - 13.*/
+#define SIM_CHANNELS            14
+
+/** Links to APs cached by every node, power of 2.*/
+#define SIM_LINK_CACHE          32
+
+/**
+ * Simulation parameters. Times are in us, distances in m, power in dBm.
+*/
+typedef struct
+{
+    uint32_t    nodes;                  /**< Number of simulated nodes.*/
+    uint32_t    rounds;                 /**< Number of wake ups of every node.*/
+    uint64_t    seed;                   /**< Seed of all random processes.*/
+    float       field_size;             /**< Side of square field where nodes are placed.*/
+    float       base_x;                 /**< Base station position.*/
+    float       base_y;                 /**< Base station position.*/
+    float       tx_power;               /**< Transmit power of nodes and base.*/
+    float       path_loss_1m;           /**< Path loss at 1 m in dB.*/
+    float       path_loss_exponent;     /**< Log-distance path loss exponent.*/
+    float       sensitivity;            /**< Lowest RSSI at which network is visible.*/
+    float       shadowing_db;           /**< Standard deviation of per link shadowing.*/
+    uint32_t    drift_ppm;              /**< Maximum deviation of RTC (deep sleep) clock.*/
+    uint32_t    boot_us;                /**< Time from deep sleep wake to setup().*/
+    uint32_t    boot_jitter_us;         /**< Maximum random offset of first boot.*/
+    uint32_t    scan_channel_us;        /**< Active scan time per channel.*/
+    uint32_t    scan_channels;          /**< Number of channels in full scan.*/
+    uint32_t    scan_max_results;       /**< Strongest networks kept by scan, SDK keeps limited list.*/
+    uint32_t    assoc_us;               /**< Authentication and association time.*/
+    uint32_t    dhcp_us;                /**< DHCP exchange time.*/
+    uint32_t    ap_start_us;            /**< Time needed to start soft AP.*/
+    uint32_t    radio_wake_us;          /**< Time needed to wake radio from forced sleep.*/
+    uint32_t    fs_mount_us;            /**< LittleFS mount time.*/
+    uint32_t    fs_read_us;             /**< LittleFS small file read time.*/
+    uint32_t    fs_write_us;            /**< LittleFS small file write time (with erase).*/
+    uint32_t    adc_us;                 /**< Single analogRead() time.*/
+    uint32_t    true_random_us;         /**< Single ESP8266TrueRandom call time.*/
+    uint32_t    phy_rate_kbps;          /**< Rate at which broadcast frames are sent.*/
+    uint32_t    yield_step_us;          /**< Time yield() advances when nothing is pending.*/
+    uint32_t    station_lookahead_us;   /**< Delay after which station work is ordered behind cluster heads.*/
+    uint32_t    ch_defer_us;            /**< Delay after which cluster head work is ordered behind stations.*/
+    uint32_t    battery_mah;            /**< Battery capacity, node dies when firmware estimate reaches it.*/
+    uint32_t    duplicate_percent;      /**< Share of station datagrams delivered twice (lost ACK, retry).*/
+    uint32_t    threads;                /**< Number of worker threads.*/
+    int32_t     trace_node;             /**< Node whose serial output is printed, -1 for none.*/
+} sim_config_s;
+
+/**
+ * Result of one network found by scan.
+*/
+typedef struct
+{
+    uint32_t    ap;                     /**< Node id of AP (or SIM_BASE_ID).*/
+    int32_t     rssi;                   /**< Received power.*/
+    uint8_t     channel;                /**< WiFi channel of AP.*/
+    uint8_t     bssid[6];               /**< BSSID of AP.*/
+} sim_scan_entry_s;
+
+/**
+ * Cached RSSI of link to AP.
+*/
+typedef struct
+{
+    uint32_t    peer;                   /**< Node id of AP.*/
+    uint32_t    epoch;                  /**< Sum of position epochs of both ends when computed.*/
+    int32_t     rssi;                   /**< Received power.*/
+} sim_link_s;
+
+/**
+ * Uniform grid of listed soft APs, cells as large as radio range.
+*/
+typedef struct
+{
+    float       range;                  /**< Longest distance at which network can be visible.*/
+    float       cell_size;              /**< Side of cell.*/
+    uint32_t    width;                  /**< Cells in x.*/
+    uint32_t    height;                 /**< Cells in y.*/
+    std::vector<std::vector<uint32_t> > cells; /**< Ids of listed APs per cell.*/
+} sim_grid_s;
+
+/**
+ * UDP datagram waiting in receiver inbox.
+*/
+typedef struct
+{
+    uint64_t    arrival_us;             /**< Time when datagram is received.*/
+    uint32_t    sender;                 /**< Node id of sender.*/
+    uint32_t    src_ip;                 /**< Source IP address.*/
+    uint16_t    src_port;               /**< Source UDP port.*/
+    uint16_t    dst_port;               /**< Destination UDP port.*/
+    std::vector<uint8_t> data;          /**< Payload.*/
+} sim_packet_s;
+
+/**
+ * Datagram on its way to node.
+*/
+typedef struct
+{
+    uint32_t    to;                     /**< Node id of receiver.*/
+    sim_packet_s packet;                /**< Datagram.*/
+} sim_delivery_s;
+
+/**
+ * Association request to soft AP.
+*/
+typedef struct
+{
+    uint32_t    ap;                     /**< Node id of AP.*/
+    uint64_t    time_us;                /**< Time of request.*/
+    uint32_t    station;                /**< Node id of station.*/
+    uint64_t    assoc_us;               /**< Time station becomes associated.*/
+} sim_request_s;
+
+/**
+ * Datagram received by base station.
+*/
+typedef struct
+{
+    uint32_t    sender;                 /**< Node id of sender.*/
+    uint32_t    round;                  /**< Round of sender.*/
+    uint32_t    len;                    /**< Payload length.*/
+    uint32_t    records;                /**< Node readings in datagram.*/
+} sim_uplink_s;
+
+/**
+ * Types of events.
+*/
+typedef enum
+{
+    SIM_EVENT_WAKE,
+    SIM_EVENT_RUN
+} sim_event_type_e;
+
+/**
+ * Scheduled event.
+*/
+typedef struct
+{
+    uint64_t    time_us;                /**< Time of event.*/
+    uint32_t    node;                   /**< Node id.*/
+    uint8_t     type;                   /**< Type defined in sim_event_type_e.*/
+} sim_event_s;
+
+/**
+ * Effects of node code on rest of network, collected by one worker
+ * thread while nodes run in parallel, and applied after all of them
+ * finish, in order which does not depend on threads.
+*/
+typedef struct
+{
+    std::vector<sim_delivery_s> deliveries; /**< Datagrams sent to soft APs.*/
+    std::vector<sim_request_s> requests;    /**< Association requests.*/
+    std::vector<sim_uplink_s> uplinks;      /**< Datagrams received by base.*/
+    std::vector<sim_event_s> events;        /**< New events.*/
+    std::vector<uint32_t> ap_changes;       /**< Nodes whose soft AP started or stopped.*/
+} sim_worker_s;
+
+/**
+ * File stored in LittleFS of node.
+*/
+typedef struct
+{
+    char        name[32];               /**< Path of file.*/
+    std::vector<uint8_t> data;          /**< Content of file.*/
+} sim_file_s;
+
+/**
+ * Counters of node for one round.
+*/
+typedef struct
+{
+    uint64_t    awake_us;               /**< Time from wake up to deep sleep.*/
+    uint64_t    radio_us;               /**< Time radio was powered.*/
+    uint64_t    tx_us;                  /**< Time spent transmitting.*/
+    uint64_t    tx_channel_us[SIM_CHANNELS]; /**< Time spent transmitting, per channel.*/
+    uint32_t    co_channel;             /**< Other soft APs on channel in range, summed over station datagrams.*/
+    uint32_t    tx_bytes;               /**< UDP payload bytes sent.*/
+    uint32_t    tx_packets;             /**< UDP datagrams sent.*/
+    uint32_t    rx_packets;             /**< UDP datagrams received.*/
+    uint32_t    flash_writes;           /**< Files written to flash.*/
+    uint32_t    relay_packets;          /**< Datagrams cluster head relayed to other cluster head.*/
+    uint64_t    energy_start_uas;       /**< Used charge estimate at wake up.*/
+} sim_node_stats_s;
+
+/**
+ * Simulated node: firmware RAM (Node_s), and state of hardware under it.
+*/
+typedef struct
+{
+    uint32_t    id;                     /**< Index of node.*/
+    uint8_t     mac[6];                 /**< Station MAC address.*/
+    float       x;                      /**< Position.*/
+    float       y;                      /**< Position.*/
+    uint32_t    epoch;                  /**< Position epoch, grows when node moves.*/
+    int32_t     base_rssi;              /**< RSSI of link to base station.*/
+    sim_link_s  links[SIM_LINK_CACHE];  /**< Links to APs, direct mapped by AP id.*/
+    uint32_t    cell;                   /**< Grid cell, valid while AP is listed.*/
+    uint32_t    cell_slot;              /**< Index in grid cell.*/
+    double      drift;                  /**< Relative error of RTC clock.*/
+    uint64_t    rng;                    /**< State of node random generator.*/
+    uint32_t    wake_count;             /**< Number of wake ups so far.*/
+    uint64_t    died_us;                /**< Time when battery ran out, 0 while node is alive.*/
+
+    Node_s      node;                   /**< Firmware RAM, lost in deep sleep.*/
+    uint8_t     rtc_memory[SIM_RTC_MEMORY_SIZE]; /**< RTC user memory, kept in deep sleep.*/
+    std::vector<sim_file_s> files;      /**< LittleFS content, kept in deep sleep.*/
+
+    uint64_t    wake_us;                /**< Time of last wake up.*/
+    uint64_t    now_us;                 /**< Virtual clock of node.*/
+    uint64_t    timer1_start_us;        /**< Time when timer1 was written.*/
+    uint32_t    timer1_load;            /**< Value written to timer1.*/
+    bool        timer1_enabled;         /**< True if timer1 is counting.*/
+    uint64_t    sleep_us;               /**< Requested deep sleep, valid if asleep.*/
+    bool        asleep;                 /**< True after ESP.deepSleep().*/
+    bool        serial_enabled;         /**< True after Serial.begin().*/
+    uint32_t    baud;                   /**< Serial baud rate.*/
+
+    bool        radio_on;               /**< True if radio is powered.*/
+    uint8_t     wifi_mode;              /**< Current WiFiMode_t.*/
+    uint32_t    assoc;                  /**< Node id of associated AP, or SIM_NO_AP.*/
+    uint64_t    connected_us;           /**< Time when association (and DHCP) completes or fails.*/
+    uint8_t     connect_status;         /**< wl_status_t reported once connected_us passes.*/
+    uint8_t     assoc_bssid[6];         /**< BSSID of associated AP, returned by WiFi.BSSID().*/
+    uint32_t    ip;                     /**< Own IP address.*/
+    uint32_t    static_ip;              /**< Address set with WiFi.config(), 0 for DHCP.*/
+    std::vector<sim_scan_entry_s> scan; /**< Result of last scan.*/
+
+    char        ssid[33];               /**< SSID of soft AP hosted by node.*/
+    bool        ap_up;                  /**< True if node hosts soft AP.*/
+    uint64_t    ap_up_us;               /**< Time from which soft AP is visible.*/
+    uint64_t    ap_down_us;             /**< Time soft AP was stopped, valid when it is not up.*/
+    uint8_t     ap_channel;             /**< Channel of soft AP.*/
+    uint8_t     ap_max_connected;       /**< Maximum stations of soft AP.*/
+    std::vector<uint64_t> ap_stations_us;   /**< Association times of stations admitted to soft AP.*/
+    bool        ap_listed;              /**< True if node is in list of active APs.*/
+    char        listed_ssid[33];        /**< SSID under which node is listed.*/
+    uint32_t    ap_slot;                /**< Index in list of active APs.*/
+    std::vector<uint32_t> refused_aps;  /**< Full soft APs which refused association in this round.*/
+    uint16_t    bound_port;             /**< UDP port node listens on, 0 if none.*/
+    uint64_t    bound_us;               /**< Time from which datagrams are received.*/
+    std::vector<sim_packet_s> inbox;    /**< Datagrams sent to this node.*/
+    size_t      inbox_read;             /**< Index of next unread datagram.*/
+
+    sim_node_stats_s stats;             /**< Counters for current round.*/
+} sim_node_s;
+
+/**
+ * Aggregated result of one round (n-th wake up of every node).
+*/
+typedef struct
+{
+    uint32_t    cluster_heads;          /**< Nodes which were cluster heads.*/
+    uint32_t    stations;               /**< Nodes which were stations.*/
+    uint32_t    station_packets;        /**< Datagrams sent by stations.*/
+    uint32_t    uplinks;                /**< Datagrams received by base.*/
+    uint32_t    uplink_bytes;           /**< Bytes received by base.*/
+    uint32_t    records;                /**< Node readings received by base.*/
+    uint64_t    ch_awake_us;            /**< Sum of awake time of cluster heads.*/
+    uint64_t    station_awake_us;       /**< Sum of awake time of stations.*/
+    uint64_t    radio_us;               /**< Sum of radio on time.*/
+    uint64_t    tx_us;                  /**< Sum of airtime.*/
+    uint64_t    tx_channel_us[SIM_CHANNELS]; /**< Sum of airtime per channel.*/
+    uint32_t    co_channel;             /**< Other soft APs on channel in range, summed over station datagrams.*/
+    uint32_t    flash_writes;           /**< Sum of flash file writes.*/
+    uint64_t    energy_uas;             /**< Sum of charge used, sleep after round included.*/
+    uint32_t    deaths;                 /**< Nodes whose battery ran out in this round.*/
+    uint32_t    relay_packets;          /**< Datagrams relayed between cluster heads.*/
+} sim_round_stats_s;
+
+/**
+ * Simulated network.
+*/
+typedef struct
+{
+    sim_config_s config;                /**< Parameters of simulation.*/
+    std::vector<sim_node_s> nodes;      /**< All nodes.*/
+    std::vector<uint32_t> aps;          /**< Ids of nodes hosting soft AP.*/
+    std::unordered_map<std::string, uint32_t> ap_by_ssid; /**< Ids of nodes hosting soft AP by SSID.*/
+    sim_grid_s  grid;                   /**< Listed APs by position.*/
+    std::vector<sim_round_stats_s> rounds; /**< Statistics per round.*/
+    uint64_t    events;                 /**< Number of processed events.*/
+    FILE*       trace_log;              /**< Phase traces of all nodes, NULL if not written.*/
+} sim_network_s;
+
+/** Network which is simulated.*/
+extern sim_network_s Network;
+
+/**
+ * @brief Fills configuration with default values.
+ * @param config Pointer to sim_config_s structure.
+ * @return none.
+ */
+void sim_default_config(sim_config_s* config);
+
+/**
+ * @brief Places nodes and prepares network for simulation.
+ * @param config Parameters of simulation.
+ * @return none.
+ */
+void sim_init(const sim_config_s* config);
+
+/**
+ * @brief Runs simulation until every node woke up config.rounds times.
+ * @param none.
+ * @return none.
+ */
+void sim_run(void);
+
+/**
+ * @brief Returns effects collected by calling thread.
+ * @param none.
+ * @return Pointer to sim_worker_s structure.
+ */
+sim_worker_s* sim_worker(void);
+
+/**
+ * @brief Sets where calling thread collects effects.
+ * @param worker Pointer to sim_worker_s structure.
+ * @return none.
+ */
+void sim_set_worker(sim_worker_s* worker);
+
+/**
+ * @brief Puts node in list of active APs or removes it, depending
+ * on state of its soft AP. Must not run in parallel with node code.
+ * @param node Pointer to sim_node_s structure.
+ * @return none.
+ */
+void sim_ap_update(sim_node_s* node);
+
+/**
+ * @brief Returns node whose code is currently executed.
+ * @param none.
+ * @return Pointer to current node.
+ */
+sim_node_s* sim_current(void);
+
+/**
+ * @brief Sets node whose code is executed.
+ * @param node Pointer to sim_node_s structure.
+ * @return none.
+ */
+void sim_set_current(sim_node_s* node);
+
+/**
+ * @brief Advances virtual clock of node.
+ * @param node Pointer to sim_node_s structure.
+ * @param us Time in us.
+ * @return none.
+ */
+void sim_advance(sim_node_s* node, uint64_t us);
+
+/**
+ * @brief Returns time of next thing node is waiting for.
+ * @param node Pointer to sim_node_s structure.
+ * @return Time in us, UINT64_MAX if nothing is pending.
+ */
+uint64_t sim_next_pending(sim_node_s* node);
+
+/**
+ * @brief Generates next random number of node.
+ * @param state Pointer to random generator state.
+ * @return 64 bit random number.
+ */
+uint64_t sim_random(uint64_t* state);
+
+/**
+ * @brief Powers radio on or off.
+ * @param node Pointer to sim_node_s structure.
+ * @param on True to power on.
+ * @return none.
+ */
+void sim_radio(sim_node_s* node, bool on);
+
+/**
+ * @brief Calculates received power between two positions, log-distance
+ * path loss only (see propagation.h).
+ * @param dx Distance in x.
+ * @param dy Distance in y.
+ * @return Received power in dBm.
+ */
+float sim_path_gain(float dx, float dy);
+
+/**
+ * @brief Calculates airtime of UDP datagram.
+ * @param len Payload length.
+ * @return Airtime in us.
+ */
+uint64_t sim_airtime_us(size_t len);
+
+/**
+ * @brief Returns SSID of network.
+ * @param ap Node id of AP (or SIM_BASE_ID).
+ * @return SSID.
+ */
+const char* sim_ap_ssid(uint32_t ap);
+
+/**
+ * @brief Returns BSSID of network (soft AP MAC of node).
+ * @param ap Node id of AP (or SIM_BASE_ID).
+ * @param bssid Filled with 6 bytes of BSSID.
+ * @return none.
+ */
+void sim_ap_bssid(uint32_t ap, uint8_t* bssid);
+
+/**
+ * @brief Makes soft AP of node visible from given time.
+ * @param node Pointer to sim_node_s structure.
+ * @param ssid SSID of AP.
+ * @param up_us Time from which AP is visible.
+ * @param channel WiFi channel.
+ * @param max_connected Maximum number of stations.
+ * @return none.
+ */
+void sim_ap_start(sim_node_s* node, const char* ssid, uint64_t up_us, uint8_t channel, uint8_t max_connected);
+
+/**
+ * @brief Stops soft AP of node.
+ * @param node Pointer to sim_node_s structure.
+ * @return none.
+ */
+void sim_ap_stop(sim_node_s* node);
+
+/**
+ * @brief Scans for visible networks and stores them in node->scan.
+ * @param node Pointer to sim_node_s structure.
+ * @param channel Channel to scan, 0 for all.
+ * @return Number of networks found.
+ */
+int sim_scan(sim_node_s* node, uint8_t channel);
+
+/**
+ * @brief Starts association with network. Without channel, node has
+ * to scan all channels to find network first. Soft AP capacity is
+ * checked by scheduler once all requests of the batch are known.
+ * @param node Pointer to sim_node_s structure.
+ * @param ssid SSID of network.
+ * @param channel Channel of network, 0 if unknown.
+ * @param bssid BSSID of network, NULL if unknown. Association fails
+ * if network with that SSID has other BSSID.
+ * @return true if association will succeed.
+ */
+bool sim_connect(sim_node_s* node, const char* ssid, uint8_t channel, const uint8_t* bssid);
+
+/**
+ * @brief Drops association.
+ * @param node Pointer to sim_node_s structure.
+ * @return none.
+ */
+void sim_disconnect(sim_node_s* node);
+
+/**
+ * @brief Sends UDP datagram on network node is part of.
+ * @param node Pointer to sim_node_s structure.
+ * @param dst_ip Destination address.
+ * @param dst_port Destination port.
+ * @param data Payload.
+ * @param len Payload length.
+ * @return true if datagram is sent.
+ */
+bool sim_udp_send(sim_node_s* node, uint32_t dst_ip, uint16_t dst_port, const uint8_t* data, size_t len);
+
+/**
+ * @brief Returns next received datagram, or NULL.
+ * @param node Pointer to sim_node_s structure.
+ * @return Pointer to datagram.
+ */
+const sim_packet_s* sim_udp_receive(sim_node_s* node);
+
+/**
+ * @brief Reads value seen on ADC pin of node.
+ * @param node Pointer to sim_node_s structure.
+ * @return ADC value (0 - 1023).
+ */
+uint16_t sim_sensor_value(sim_node_s* node);
+
+/**
+ * @brief Records datagram received by base station.
+ * @param sender Pointer to node which sent datagram.
+ * @param data Payload.
+ * @param len Payload length.
+ * @return none.
+ */
+void sim_base_receive(sim_node_s* sender, const uint8_t* data, size_t len);
+
+/**
+ * @brief Prints summary of simulation.
+ * @param csv File where statistics per round are written, or NULL.
+ * @param wall_s Wall clock duration of simulation.
+ * @return none.
+ */
+void sim_report(const char* csv, double wall_s);
+
+#endif // SIM_H_
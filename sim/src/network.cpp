@@ -0,0 +1,576 @@
+/** @file network.cpp
+ *  @brief
+ *
+ *  This file contains simulated radio medium: placement
+ *  of nodes, path loss, soft APs, scan, association and
+ *  delivery of UDP datagrams.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <algorithm>
+#include "propagation.h"
+
+/** Espressif OUI, first three bytes of every simulated MAC.*/
+static const uint8_t mac_oui[3] = {0x5C, 0xCF, 0x7F};
+
+/** IP, UDP, LLC and 802.11 MAC header bytes added to every datagram.*/
+#define FRAME_OVERHEAD          64
+
+/** Long PLCP preamble and header duration in us.*/
+#define PREAMBLE_US             192
+
+sim_network_s Network;
+
+static thread_local sim_node_s* current = NULL;
+static thread_local sim_worker_s* worker = NULL;
+
+void sim_default_config(sim_config_s* config)
+{
+    config->nodes = 1000;
+    config->rounds = 100;
+    config->seed = 1;
+    config->field_size = 100;
+    config->base_x = 50;
+    config->base_y = 50;
+    config->tx_power = 20;
+    config->path_loss_1m = 40;
+    config->path_loss_exponent = 3;
+    config->sensitivity = -90;
+    config->shadowing_db = 0;
+    config->drift_ppm = 5000;
+    config->boot_us = 150000;
+    config->boot_jitter_us = 50000;
+    config->scan_channel_us = 120000;
+    config->scan_channels = 13;
+    config->scan_max_results = 32;
+    config->assoc_us = 250000;
+    config->dhcp_us = 400000;
+    config->ap_start_us = 50000;
+    config->radio_wake_us = 2000;
+    config->fs_mount_us = 20000;
+    config->fs_read_us = 2000;
+    config->fs_write_us = 30000;
+    config->adc_us = 100;
+    config->true_random_us = 200;
+    config->phy_rate_kbps = 1000;
+    config->yield_step_us = 20000;
+    config->station_lookahead_us = 1000000;
+    config->ch_defer_us = 12000000;
+    config->battery_mah = BATTERY_CAPACITY_MAH;
+    config->duplicate_percent = 0;
+    config->trace_node = -1;
+    config->threads = 0;
+}
+
+uint64_t sim_random(uint64_t* state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+static double random_unit(uint64_t* state)
+{
+    return (sim_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void sim_init(const sim_config_s* config)
+{
+    uint64_t rng = config->seed;
+
+    Network.config = *config;
+    Network.nodes.clear();
+    Network.nodes.resize(config->nodes);
+    Network.aps.clear();
+    Network.ap_by_ssid.clear();
+    Network.rounds.assign(config->rounds, sim_round_stats_s());
+    Network.events = 0;
+
+    for (uint32_t i = 0; i < config->nodes; i++) {
+        sim_node_s* node = &Network.nodes[i];
+
+        node->id = i;
+        memcpy(node->mac, mac_oui, 3);
+        node->mac[3] = (i >> 16) & 0xFF;
+        node->mac[4] = (i >> 8) & 0xFF;
+        node->mac[5] = i & 0xFF;
+        node->x = random_unit(&rng) * config->field_size;
+        node->y = random_unit(&rng) * config->field_size;
+        node->drift = (random_unit(&rng) * 2 - 1) * config->drift_ppm / 1e6;
+        node->rng = config->seed ^ ((uint64_t)(i + 1) * 0xD1B54A32D192ED03ULL);
+        node->files.reserve(SIM_MAX_FILES);
+
+        // RTC memory holds random content after power up.
+        uint64_t garbage = node->rng + 1;
+
+        for (size_t k = 0; k < SIM_RTC_MEMORY_SIZE; k++) {
+            node->rtc_memory[k] = sim_random(&garbage) & 0xFF;
+        }
+        node->assoc = SIM_NO_AP;
+        node->died_us = 0;
+        snprintf(node->ssid, sizeof(node->ssid), "%02X%02X%02X%02X%02X%02X",
+                 node->mac[0], node->mac[1], node->mac[2], node->mac[3], node->mac[4], node->mac[5]);
+        node->wake_us = (uint64_t)(random_unit(&rng) * config->boot_jitter_us);
+    }
+    sim_prop_init();
+}
+
+sim_node_s* sim_current(void)
+{
+    return current;
+}
+
+void sim_set_current(sim_node_s* node)
+{
+    current = node;
+}
+
+sim_worker_s* sim_worker(void)
+{
+    return worker;
+}
+
+void sim_set_worker(sim_worker_s* w)
+{
+    worker = w;
+}
+
+void sim_advance(sim_node_s* node, uint64_t us)
+{
+    if (node->radio_on) {
+        node->stats.radio_us += us;
+    }
+    node->now_us += us;
+}
+
+uint64_t sim_next_pending(sim_node_s* node)
+{
+    uint64_t next = UINT64_MAX;
+
+    if (node->connected_us > node->now_us) {
+        next = node->connected_us;
+    }
+
+    if (node->bound_port != 0) {
+        for (size_t i = node->inbox_read; i < node->inbox.size(); i++) {
+            const sim_packet_s* packet = &node->inbox[i];
+
+            if (packet->arrival_us >= node->bound_us && packet->dst_port == node->bound_port) {
+                if (packet->arrival_us > node->now_us && packet->arrival_us < next) {
+                    next = packet->arrival_us;
+                }
+                break;
+            }
+        }
+    }
+
+    return next;
+}
+
+void sim_radio(sim_node_s* node, bool on)
+{
+    node->radio_on = on;
+}
+
+uint64_t sim_airtime_us(size_t len)
+{
+    return PREAMBLE_US + (uint64_t)(len + FRAME_OVERHEAD) * 8 * 1000 / Network.config.phy_rate_kbps;
+}
+
+const char* sim_ap_ssid(uint32_t ap)
+{
+    return ap == SIM_BASE_ID ? BASE_SSID : Network.nodes[ap].ssid;
+}
+
+void sim_ap_bssid(uint32_t ap, uint8_t* bssid)
+{
+    uint32_t id = ap == SIM_BASE_ID ? 0xFFFFFF : ap;
+
+    // soft AP MAC is station MAC with locally administered bit set.
+    bssid[0] = 0x5C | 0x02;
+    bssid[1] = 0xCF;
+    bssid[2] = 0x7F;
+    bssid[3] = (id >> 16) & 0xFF;
+    bssid[4] = (id >> 8) & 0xFF;
+    bssid[5] = id & 0xFF;
+}
+
+void sim_ap_start(sim_node_s* node, const char* ssid, uint64_t up_us, uint8_t channel, uint8_t max_connected)
+{
+    if (node->ap_up == false) {
+        node->ap_stations_us.clear();
+        node->inbox.clear();
+        node->inbox_read = 0;
+        worker->ap_changes.push_back(node->id);
+    }
+    else if (strcmp(node->ssid, ssid) != 0) {
+        worker->ap_changes.push_back(node->id);
+    }
+
+    if (ssid != node->ssid) {
+        snprintf(node->ssid, sizeof(node->ssid), "%s", ssid);
+    }
+    node->ap_up = true;
+    node->ap_up_us = up_us;
+    node->ap_down_us = UINT64_MAX;
+    node->ap_channel = channel;
+    node->ap_max_connected = max_connected;
+}
+
+void sim_ap_stop(sim_node_s* node)
+{
+    if (node->ap_up == false) {
+        return;
+    }
+
+    node->ap_up = false;
+    node->ap_down_us = node->now_us;
+    node->inbox.clear();
+    node->inbox_read = 0;
+    worker->ap_changes.push_back(node->id);
+}
+
+void sim_ap_update(sim_node_s* node)
+{
+    if (node->ap_listed == true) {
+        uint32_t last = Network.aps.back();
+
+        Network.aps[node->ap_slot] = last;
+        Network.nodes[last].ap_slot = node->ap_slot;
+        Network.aps.pop_back();
+        Network.ap_by_ssid.erase(node->listed_ssid);
+        sim_prop_unlist(node);
+        node->ap_listed = false;
+    }
+
+    if (node->ap_up == true) {
+        node->ap_slot = Network.aps.size();
+        Network.aps.push_back(node->id);
+        Network.ap_by_ssid[node->ssid] = node->id;
+        memcpy(node->listed_ssid, node->ssid, sizeof(node->listed_ssid));
+        sim_prop_list(node);
+        node->ap_listed = true;
+    }
+}
+
+static bool scan_order(const sim_scan_entry_s& a, const sim_scan_entry_s& b)
+{
+    if (a.rssi != b.rssi) {
+        return a.rssi > b.rssi;
+    }
+
+    return a.ap < b.ap;
+}
+
+int sim_scan(sim_node_s* node, uint8_t channel)
+{
+    const sim_config_s* config = &Network.config;
+    uint64_t duration = channel ? config->scan_channel_us : (uint64_t)config->scan_channel_us * config->scan_channels;
+    uint64_t done_us = node->now_us + duration;
+    uint32_t x0, x1, y0, y1;
+    int32_t rssi;
+
+    node->scan.clear();
+
+    sim_prop_cells(node, &x0, &x1, &y0, &y1);
+    for (uint32_t cy = y0; cy <= y1; cy++) {
+        for (uint32_t cx = x0; cx <= x1; cx++) {
+            const std::vector<uint32_t>* cell = &Network.grid.cells[cy * Network.grid.width + cx];
+
+            for (size_t i = 0; i < cell->size(); i++) {
+                const sim_node_s* ap = &Network.nodes[(*cell)[i]];
+
+                if (ap == node || ap->ap_up_us > done_us || (channel && ap->ap_channel != channel)) {
+                    continue;
+                }
+                rssi = sim_prop_peek(node, ap->id);
+                if (rssi >= config->sensitivity) {
+                    sim_scan_entry_s entry = {ap->id, rssi, ap->ap_channel, {0}};
+
+                    sim_ap_bssid(ap->id, entry.bssid);
+                    node->scan.push_back(entry);
+                }
+            }
+        }
+    }
+
+    rssi = sim_prop_rssi(node, SIM_BASE_ID);
+    if (rssi >= config->sensitivity && (channel == 0 || channel == WIFI_CHANNEL)) {
+        sim_scan_entry_s entry = {SIM_BASE_ID, rssi, WIFI_CHANNEL, {0}};
+
+        sim_ap_bssid(SIM_BASE_ID, entry.bssid);
+        node->scan.push_back(entry);
+    }
+
+    if (node->scan.size() > config->scan_max_results) {
+        std::partial_sort(node->scan.begin(), node->scan.begin() + config->scan_max_results,
+                          node->scan.end(), scan_order);
+        node->scan.resize(config->scan_max_results);
+    }
+    else {
+        std::sort(node->scan.begin(), node->scan.end(), scan_order);
+    }
+
+    // node reports and joins only what it kept.
+    for (size_t i = 0; i < node->scan.size(); i++) {
+        if (node->scan[i].ap != SIM_BASE_ID) {
+            sim_prop_remember(node, node->scan[i].ap, node->scan[i].rssi);
+        }
+    }
+    sim_advance(node, duration);
+
+    return node->scan.size();
+}
+
+static bool bssid_matches(uint32_t ap, const uint8_t* bssid)
+{
+    uint8_t expected[6];
+
+    if (bssid == NULL) {
+        return true;
+    }
+    sim_ap_bssid(ap, expected);
+
+    return memcmp(expected, bssid, sizeof(expected)) == 0;
+}
+
+bool sim_connect(sim_node_s* node, const char* ssid, uint8_t channel, const uint8_t* bssid)
+{
+    const sim_config_s* config = &Network.config;
+    uint64_t search_us = 0;
+    uint64_t assoc_us;
+    int32_t rssi;
+
+    if (channel == 0) {
+        search_us = (uint64_t)config->scan_channel_us * config->scan_channels;
+    }
+    else if (bssid == NULL) {
+        search_us = config->scan_channel_us;
+    }
+    assoc_us = node->now_us + search_us;
+
+    // station learns that network is not there, or refused it, after association attempt.
+    node->assoc = SIM_NO_AP;
+    node->connected_us = assoc_us + config->assoc_us;
+    node->connect_status = WL_NO_SSID_AVAIL;
+
+    if (strcmp(ssid, BASE_SSID) == 0) {
+        rssi = sim_prop_rssi(node, SIM_BASE_ID);
+        if (rssi < config->sensitivity || (channel != 0 && channel != WIFI_CHANNEL) ||
+            bssid_matches(SIM_BASE_ID, bssid) == false) {
+            return false;
+        }
+        node->assoc = SIM_BASE_ID;
+        node->ip = node->static_ip ? node->static_ip : SIM_BASE_SUBNET | (2 + node->id % 250);
+    }
+    else {
+        std::unordered_map<std::string, uint32_t>::const_iterator it = Network.ap_by_ssid.find(ssid);
+
+        if (it == Network.ap_by_ssid.end()) {
+            return false;
+        }
+
+        sim_node_s* ap = &Network.nodes[it->second];
+
+        // cluster heads run in parallel, soft AP is taken as it was when they started.
+        rssi = sim_prop_rssi(node, ap->id);
+        if (rssi < config->sensitivity || ap->ap_listed == false || ap->ap_up_us > assoc_us ||
+            (channel != 0 && channel != ap->ap_channel) || bssid_matches(ap->id, bssid) == false) {
+            return false;
+        }
+        if (std::find(node->refused_aps.begin(), node->refused_aps.end(), ap->id) != node->refused_aps.end()) {
+            node->connect_status = WL_CONNECT_FAILED;
+            return false;
+        }
+        worker->requests.push_back({ap->id, node->now_us, node->id, assoc_us + config->assoc_us});
+        node->assoc = ap->id;
+        node->ip = node->static_ip ? node->static_ip : SIM_AP_SUBNET | (2 + node->id % 250);
+    }
+
+    // static address needs no DHCP exchange.
+    node->connected_us = assoc_us + config->assoc_us + (node->static_ip ? 0 : config->dhcp_us);
+    node->connect_status = WL_CONNECTED;
+
+    return true;
+}
+
+void sim_disconnect(sim_node_s* node)
+{
+    node->assoc = SIM_NO_AP;
+    node->connected_us = 0;
+    node->connect_status = WL_DISCONNECTED;
+    node->ip = 0;
+}
+
+/**
+ * @brief Counts listed soft APs, other than the one node is associated
+ * with, which share its channel and hear node.
+ * @param node Sending node.
+ * @param channel Channel of datagram.
+ * @return Number of soft APs.
+ */
+static uint32_t co_channel_aps(const sim_node_s* node, uint8_t channel)
+{
+    uint32_t x0, x1, y0, y1;
+    uint32_t count = 0;
+
+    sim_prop_cells(node, &x0, &x1, &y0, &y1);
+    for (uint32_t cy = y0; cy <= y1; cy++) {
+        for (uint32_t cx = x0; cx <= x1; cx++) {
+            const std::vector<uint32_t>* cell = &Network.grid.cells[cy * Network.grid.width + cx];
+
+            for (size_t i = 0; i < cell->size(); i++) {
+                uint32_t ap = (*cell)[i];
+
+                if (ap != node->assoc && Network.nodes[ap].ap_channel == channel &&
+                    sim_prop_peek(node, ap) >= Network.config.sensitivity) {
+                    count++;
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+bool sim_udp_send(sim_node_s* node, uint32_t dst_ip, uint16_t dst_port, const uint8_t* data, size_t len)
+{
+    uint64_t airtime = sim_airtime_us(len);
+    uint32_t subnet;
+    uint8_t channel;
+
+    if (node->radio_on == false || node->assoc == SIM_NO_AP || node->now_us < node->connected_us) {
+        return false;
+    }
+
+    subnet = node->assoc == SIM_BASE_ID ? SIM_BASE_SUBNET : SIM_AP_SUBNET;
+    if ((dst_ip & 0xFFFFFF00u) != subnet) {
+        return false;
+    }
+
+    sim_advance(node, airtime);
+    channel = node->assoc == SIM_BASE_ID ? WIFI_CHANNEL : Network.nodes[node->assoc].ap_channel;
+    node->stats.tx_us += airtime;
+    node->stats.tx_channel_us[channel] += airtime;
+    node->stats.tx_bytes += len;
+    node->stats.tx_packets++;
+
+    if (node->assoc == SIM_BASE_ID) {
+        sim_base_receive(node, data, len);
+    }
+    else {
+        sim_delivery_s delivery;
+
+        delivery.to = node->assoc;
+        delivery.packet.arrival_us = node->now_us;
+        delivery.packet.sender = node->id;
+        delivery.packet.src_ip = node->ip;
+        delivery.packet.src_port = 4097;
+        delivery.packet.dst_port = dst_port;
+        delivery.packet.data.assign(data, data + len);
+        worker->deliveries.push_back(delivery);
+
+        if (node->node.cluster_head == true) {
+            node->stats.relay_packets++;
+        }
+        else {
+            node->stats.co_channel += co_channel_aps(node, channel);
+        }
+
+#if CLOCK_SYNC
+        // cluster head runs after its stations, so its sync reply (see
+        // parse_packets()) is made here, from time of its round start.
+        if (node->bound_port != 0 && check_if_message_is_valid(data, len)) {
+            const sim_node_s* ap = &Network.nodes[node->assoc];
+            uint8_t reply[SYNC_SIZE];
+            sim_packet_s packet;
+
+            sync_encode(reply, node->node.nodeName, (uint32_t)(node->now_us - ap->timer1_start_us));
+            packet.arrival_us = node->now_us + sim_airtime_us(SYNC_SIZE);
+            packet.sender = ap->id;
+            packet.src_ip = SIM_AP_SUBNET | 1;
+            packet.src_port = dst_port;
+            packet.dst_port = node->bound_port;
+            packet.data.assign(reply, reply + SYNC_SIZE);
+            node->inbox.push_back(packet);
+        }
+#endif
+
+        // ACK of sender was lost, retry is received as second copy.
+        if (Network.config.duplicate_percent > 0 && sim_random(&node->rng) % 100 < Network.config.duplicate_percent) {
+            delivery.packet.arrival_us += airtime;
+            worker->deliveries.push_back(delivery);
+        }
+    }
+
+    return true;
+}
+
+const sim_packet_s* sim_udp_receive(sim_node_s* node)
+{
+    if (node->bound_port == 0) {
+        return NULL;
+    }
+
+    while (node->inbox_read < node->inbox.size()) {
+        const sim_packet_s* packet = &node->inbox[node->inbox_read];
+
+        if (packet->arrival_us < node->bound_us || packet->dst_port != node->bound_port) {
+            node->inbox_read++;
+            continue;
+        }
+        if (packet->arrival_us > node->now_us) {
+            break;
+        }
+        node->inbox_read++;
+        node->stats.rx_packets++;
+        return packet;
+    }
+
+    return NULL;
+}
+
+uint16_t sim_sensor_value(sim_node_s* node)
+{
+    // slow daily-like wave around per node level, with little noise.
+    double level = 300 + (node->id * 37) % 400;
+    double phase = (node->id % 97) * 0.0648;
+    double value = level + 50 * sin(2 * M_PI * node->now_us / 3.6e9 + phase) +
+                   (double)(sim_random(&node->rng) % 5) - 2;
+
+    if (value < 0) {
+        value = 0;
+    }
+    if (value > 1023) {
+        value = 1023;
+    }
+
+    return (uint16_t)value;
+}
+
+void sim_base_receive(sim_node_s* sender, const uint8_t* data, size_t len)
+{
+    sim_uplink_s uplink = {sender->id, sender->wake_count - 1, (uint32_t)len, 0};
+    size_t count;
+
+    if (len >= UPLINK_HEADER_SIZE && uplink_type(data) == UPLINK_DELTA) {
+        uint8_t frames[DELTA_RECORDS_MAX * FRAME_SIZE];
+
+        uplink.records = delta_decode(data, len, frames, DELTA_RECORDS_MAX);
+    }
+    else if (len >= UPLINK_HEADER_SIZE && uplink_type(data) != UPLINK_FRAMES_RAW) {
+        if (summary_is_valid(data + UPLINK_HEADER_SIZE, len - UPLINK_HEADER_SIZE, uplink_type(data))) {
+            uplink.records = summary_count(data + UPLINK_HEADER_SIZE);
+        }
+    }
+    else if (uplink_frames(data, len, &count) != NULL) {
+        uplink.records = count;
+    }
+
+    worker->uplinks.push_back(uplink);
+}
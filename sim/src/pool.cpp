@@ -0,0 +1,201 @@
+/** @file pool.cpp
+ *  @brief
+ *
+ *  This file contains work-stealing thread pool which
+ *  runs node code of one simulation phase in parallel.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "pool.h"
+
+/**
+ * Range of task indexes owned by one worker.
+*/
+typedef struct
+{
+    std::mutex  lock;                   /**< Protects begin and end.*/
+    uint32_t    begin;                  /**< Next task owner takes.*/
+    uint32_t    end;                    /**< One past last task of range.*/
+} pool_queue_s;
+
+static std::vector<std::thread> Threads;
+static pool_queue_s* Queues = nullptr;
+static uint32_t Workers = 1;
+
+static std::mutex JobLock;
+static std::condition_variable JobStart;
+static std::condition_variable JobDone;
+static uint64_t Generation = 0;
+static bool Stopping = false;
+static uint32_t Busy = 0;
+
+static pool_task_f Task = nullptr;
+static void* TaskArg = nullptr;
+
+static thread_local uint32_t Worker = 0;
+
+static bool take(uint32_t w, uint32_t* index)
+{
+    std::lock_guard<std::mutex> guard(Queues[w].lock);
+
+    if (Queues[w].begin < Queues[w].end) {
+        *index = Queues[w].begin++;
+        return true;
+    }
+
+    return false;
+}
+
+static bool steal(uint32_t w, uint32_t* index)
+{
+    for (uint32_t k = 1; k < Workers; k++) {
+        pool_queue_s* victim = &Queues[(w + k) % Workers];
+        uint32_t begin;
+        uint32_t end;
+
+        {
+            std::lock_guard<std::mutex> guard(victim->lock);
+
+            if (victim->begin >= victim->end) {
+                continue;
+            }
+            end = victim->end;
+            begin = end - (end - victim->begin + 1) / 2;
+            victim->end = begin;
+        }
+
+        std::lock_guard<std::mutex> guard(Queues[w].lock);
+
+        *index = begin;
+        Queues[w].begin = begin + 1;
+        Queues[w].end = end;
+        return true;
+    }
+
+    return false;
+}
+
+static void work(uint32_t w)
+{
+    uint32_t index;
+
+    while (take(w, &index) || steal(w, &index)) {
+        Task(index, TaskArg);
+    }
+}
+
+static void worker_loop(uint32_t w)
+{
+    uint64_t seen = 0;
+
+    Worker = w;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(JobLock);
+
+            JobStart.wait(guard, [&] { return Stopping || Generation != seen; });
+            if (Stopping) {
+                return;
+            }
+            seen = Generation;
+        }
+
+        work(w);
+
+        std::lock_guard<std::mutex> guard(JobLock);
+
+        if (--Busy == 0) {
+            JobDone.notify_one();
+        }
+    }
+}
+
+void pool_start(uint32_t threads)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    Workers = threads;
+    Queues = new pool_queue_s[Workers];
+    Stopping = false;
+    Worker = 0;
+
+    for (uint32_t w = 1; w < Workers; w++) {
+        Threads.push_back(std::thread(worker_loop, w));
+    }
+}
+
+void pool_stop(void)
+{
+    {
+        std::lock_guard<std::mutex> guard(JobLock);
+        Stopping = true;
+    }
+    JobStart.notify_all();
+
+    for (size_t i = 0; i < Threads.size(); i++) {
+        Threads[i].join();
+    }
+    Threads.clear();
+    delete[] Queues;
+    Queues = nullptr;
+    Workers = 1;
+}
+
+uint32_t pool_threads(void)
+{
+    return Workers;
+}
+
+uint32_t pool_worker(void)
+{
+    return Worker;
+}
+
+void pool_run(uint32_t count, pool_task_f task, void* arg)
+{
+    if (count == 0) {
+        return;
+    }
+
+    if (Workers == 1 || count == 1) {
+        for (uint32_t i = 0; i < count; i++) {
+            task(i, arg);
+        }
+        return;
+    }
+
+    Task = task;
+    TaskArg = arg;
+
+    for (uint32_t w = 0; w < Workers; w++) {
+        std::lock_guard<std::mutex> guard(Queues[w].lock);
+
+        Queues[w].begin = (uint64_t)count * w / Workers;
+        Queues[w].end = (uint64_t)count * (w + 1) / Workers;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(JobLock);
+        Busy = Workers - 1;
+        Generation++;
+    }
+    JobStart.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> guard(JobLock);
+
+    JobDone.wait(guard, [] { return Busy == 0; });
+}
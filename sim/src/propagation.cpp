@@ -0,0 +1,215 @@
+/** @file propagation.cpp
+ *  @brief
+ *
+ *  This file contains path loss and shadowing of links,
+ *  grid of listed soft APs and link cache of nodes.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <math.h>
+#include "propagation.h"
+
+/** Largest number of grid cells in x or y.*/
+#define SIM_GRID_MAX_CELLS      4096
+
+/**
+ * @brief Shadowing of link between two nodes, same for
+ * both directions.
+ * @param a Node id of one end (or SIM_BASE_ID).
+ * @param b Node id of other end (or SIM_BASE_ID).
+ * @return Shadowing in dB.
+ */
+static float shadowing(uint32_t a, uint32_t b)
+{
+    const sim_config_s* config = &Network.config;
+    uint64_t state;
+    double u1;
+    double u2;
+    double g;
+
+    if (config->shadowing_db <= 0) {
+        return 0;
+    }
+
+    if (a > b) {
+        uint32_t t = a;
+
+        a = b;
+        b = t;
+    }
+    state = config->seed ^ (((uint64_t)a << 32) | b) * 0xD6E8FEB86659FD93ULL;
+
+    // Box-Muller, u1 is kept off zero.
+    u1 = ((sim_random(&state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+    u2 = (sim_random(&state) >> 11) * (1.0 / 9007199254740992.0);
+    g = sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+
+    if (g > SIM_SHADOW_CLAMP) {
+        g = SIM_SHADOW_CLAMP;
+    }
+    else if (g < -SIM_SHADOW_CLAMP) {
+        g = -SIM_SHADOW_CLAMP;
+    }
+
+    return (float)(g * config->shadowing_db);
+}
+
+static int32_t link_rssi(const sim_node_s* node, const sim_node_s* ap)
+{
+    return (int32_t)lroundf(sim_path_gain(ap->x - node->x, ap->y - node->y) + shadowing(node->id, ap->id));
+}
+
+static uint32_t cell_of(float v, uint32_t cells)
+{
+    float c = v / Network.grid.cell_size;
+
+    if (c < 0) {
+        return 0;
+    }
+    if (c >= cells) {
+        return cells - 1;
+    }
+
+    return (uint32_t)c;
+}
+
+float sim_path_gain(float dx, float dy)
+{
+    const sim_config_s* config = &Network.config;
+    float d = sqrtf(dx * dx + dy * dy);
+
+    if (d < 1) {
+        d = 1;
+    }
+
+    return config->tx_power - config->path_loss_1m - 10 * config->path_loss_exponent * log10f(d);
+}
+
+void sim_prop_init(void)
+{
+    const sim_config_s* config = &Network.config;
+    sim_grid_s* grid = &Network.grid;
+    float margin;
+    float cells;
+
+    // farthest distance at which rounded RSSI with largest shadowing still reaches sensitivity.
+    margin = config->tx_power - config->path_loss_1m - config->sensitivity + 0.5f +
+             SIM_SHADOW_CLAMP * (config->shadowing_db > 0 ? config->shadowing_db : 0);
+    grid->range = powf(10, margin / (10 * config->path_loss_exponent)) * 1.01f + 1;
+    grid->cell_size = grid->range;
+
+    cells = ceilf(config->field_size / grid->cell_size);
+    if (cells > SIM_GRID_MAX_CELLS) {
+        cells = SIM_GRID_MAX_CELLS;
+        grid->cell_size = config->field_size / SIM_GRID_MAX_CELLS;
+    }
+    grid->width = cells < 1 ? 1 : (uint32_t)cells;
+    grid->height = grid->width;
+    grid->cells.assign((size_t)grid->width * grid->height, std::vector<uint32_t>());
+
+    for (size_t i = 0; i < Network.nodes.size(); i++) {
+        sim_node_s* node = &Network.nodes[i];
+
+        node->epoch = 1;
+        for (size_t k = 0; k < SIM_LINK_CACHE; k++) {
+            node->links[k].peer = SIM_NO_AP;
+            node->links[k].epoch = 0;
+        }
+        node->base_rssi = (int32_t)lroundf(sim_path_gain(config->base_x - node->x, config->base_y - node->y) +
+                                           shadowing(node->id, SIM_BASE_ID));
+    }
+}
+
+int32_t sim_prop_rssi(sim_node_s* node, uint32_t ap)
+{
+    if (ap == SIM_BASE_ID) {
+        return node->base_rssi;
+    }
+
+    const sim_node_s* peer = &Network.nodes[ap];
+    sim_link_s* link = &node->links[ap & (SIM_LINK_CACHE - 1)];
+
+    if (link->peer != ap || link->epoch != node->epoch + peer->epoch) {
+        link->peer = ap;
+        link->epoch = node->epoch + peer->epoch;
+        link->rssi = link_rssi(node, peer);
+    }
+
+    return link->rssi;
+}
+
+int32_t sim_prop_peek(const sim_node_s* node, uint32_t ap)
+{
+    const sim_node_s* peer = &Network.nodes[ap];
+    const sim_link_s* link = &node->links[ap & (SIM_LINK_CACHE - 1)];
+    float dx = peer->x - node->x;
+    float dy = peer->y - node->y;
+
+    if (link->peer == ap && link->epoch == node->epoch + peer->epoch) {
+        return link->rssi;
+    }
+    if (dx * dx + dy * dy > Network.grid.range * Network.grid.range) {
+        return SIM_OUT_OF_RANGE;
+    }
+
+    return link_rssi(node, peer);
+}
+
+void sim_prop_remember(sim_node_s* node, uint32_t ap, int32_t rssi)
+{
+    sim_link_s* link = &node->links[ap & (SIM_LINK_CACHE - 1)];
+
+    link->peer = ap;
+    link->epoch = node->epoch + Network.nodes[ap].epoch;
+    link->rssi = rssi;
+}
+
+void sim_prop_list(sim_node_s* node)
+{
+    sim_grid_s* grid = &Network.grid;
+    std::vector<uint32_t>* cell;
+
+    node->cell = cell_of(node->y, grid->height) * grid->width + cell_of(node->x, grid->width);
+    cell = &grid->cells[node->cell];
+    node->cell_slot = cell->size();
+    cell->push_back(node->id);
+}
+
+void sim_prop_unlist(sim_node_s* node)
+{
+    std::vector<uint32_t>* cell = &Network.grid.cells[node->cell];
+    uint32_t last = cell->back();
+
+    (*cell)[node->cell_slot] = last;
+    Network.nodes[last].cell_slot = node->cell_slot;
+    cell->pop_back();
+}
+
+void sim_prop_cells(const sim_node_s* node, uint32_t* x0, uint32_t* x1, uint32_t* y0, uint32_t* y1)
+{
+    const sim_grid_s* grid = &Network.grid;
+
+    *x0 = cell_of(node->x - grid->range, grid->width);
+    *x1 = cell_of(node->x + grid->range, grid->width);
+    *y0 = cell_of(node->y - grid->range, grid->height);
+    *y1 = cell_of(node->y + grid->range, grid->height);
+}
+
+void sim_prop_move(sim_node_s* node, float x, float y)
+{
+    const sim_config_s* config = &Network.config;
+
+    if (node->ap_listed == true) {
+        sim_prop_unlist(node);
+    }
+    node->x = x;
+    node->y = y;
+    node->epoch++;
+    node->base_rssi = (int32_t)lroundf(sim_path_gain(config->base_x - x, config->base_y - y) +
+                                       shadowing(node->id, SIM_BASE_ID));
+    if (node->ap_listed == true) {
+        sim_prop_list(node);
+    }
+}
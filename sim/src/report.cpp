@@ -0,0 +1,160 @@
+/** @file report.cpp
+ *  @brief
+ *
+ *  This file prints summary of simulation and writes
+ *  statistics of every round to CSV file.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "sim.h"
+
+static double ratio(double a, double b)
+{
+    return b > 0 ? a / b : 0;
+}
+
+/**
+ * @brief Finds channel with most airtime in round.
+ * @param r Statistics of round.
+ * @return Channel.
+ */
+static size_t busiest_channel(const sim_round_stats_s* r)
+{
+    size_t busiest = 1;
+
+    for (size_t k = 1; k < SIM_CHANNELS; k++) {
+        if (r->tx_channel_us[k] > r->tx_channel_us[busiest]) {
+            busiest = k;
+        }
+    }
+
+    return busiest;
+}
+
+static void print_death(const char* name, uint64_t died_us, int round)
+{
+    if (round < 0) {
+        printf("%s none\n", name);
+    }
+    else {
+        printf("%s %.1f s (%.2f h, round %d)\n", name, died_us / 1e6, died_us / 3.6e9, round);
+    }
+}
+
+void sim_report(const char* csv, double wall_s)
+{
+    const sim_config_s* config = &Network.config;
+    sim_round_stats_s total = sim_round_stats_s();
+    uint64_t node_rounds;
+    uint64_t last_wake = 0;
+    uint64_t first_death = 0;
+    uint64_t last_death = 0;
+    uint32_t dead = 0;
+    int first_death_round = -1;
+    int last_death_round = -1;
+
+    for (size_t i = 0; i < Network.rounds.size(); i++) {
+        const sim_round_stats_s* r = &Network.rounds[i];
+
+        total.cluster_heads += r->cluster_heads;
+        total.stations += r->stations;
+        total.station_packets += r->station_packets;
+        total.uplinks += r->uplinks;
+        total.uplink_bytes += r->uplink_bytes;
+        total.records += r->records;
+        total.ch_awake_us += r->ch_awake_us;
+        total.station_awake_us += r->station_awake_us;
+        total.radio_us += r->radio_us;
+        total.tx_us += r->tx_us;
+        for (size_t k = 0; k < SIM_CHANNELS; k++) {
+            total.tx_channel_us[k] += r->tx_channel_us[k];
+        }
+        total.co_channel += r->co_channel;
+        total.flash_writes += r->flash_writes;
+        total.energy_uas += r->energy_uas;
+        total.deaths += r->deaths;
+        total.relay_packets += r->relay_packets;
+
+        if (r->deaths > 0) {
+            if (first_death_round < 0) {
+                first_death_round = i;
+            }
+            last_death_round = i;
+        }
+    }
+    for (size_t i = 0; i < Network.nodes.size(); i++) {
+        const sim_node_s* node = &Network.nodes[i];
+
+        if (node->now_us > last_wake) {
+            last_wake = node->now_us;
+        }
+        if (node->died_us != 0) {
+            if (dead == 0 || node->died_us < first_death) {
+                first_death = node->died_us;
+            }
+            if (node->died_us > last_death) {
+                last_death = node->died_us;
+            }
+            dead++;
+        }
+    }
+    node_rounds = (uint64_t)total.cluster_heads + total.stations;
+
+    printf("nodes                 %u\n", config->nodes);
+    printf("rounds                %u\n", config->rounds);
+    printf("events                %llu\n", (unsigned long long)Network.events);
+    printf("simulated time        %.1f s\n", last_wake / 1e6);
+    printf("wall time             %.2f s\n", wall_s);
+    printf("cluster heads/round   %.2f\n", ratio(total.cluster_heads, config->rounds));
+    printf("readings at base      %.2f %%\n", 100 * ratio(total.records, node_rounds));
+    printf("uplink bytes/round    %.1f\n", ratio(total.uplink_bytes, config->rounds));
+    printf("relayed/round         %.2f\n", ratio(total.relay_packets, config->rounds));
+    printf("CH awake              %.1f ms\n", ratio(total.ch_awake_us, total.cluster_heads) / 1000);
+    printf("station awake         %.1f ms\n", ratio(total.station_awake_us, total.stations) / 1000);
+    printf("radio on/node/round   %.1f ms\n", ratio(total.radio_us, node_rounds) / 1000);
+    printf("airtime/node/round    %.2f ms\n", ratio(total.tx_us, node_rounds) / 1000);
+    printf("airtime/round by ch  ");
+    for (size_t k = 1; k < SIM_CHANNELS; k++) {
+        if (total.tx_channel_us[k] > 0) {
+            printf(" %zu: %.1f ms", k, ratio(total.tx_channel_us[k], config->rounds) / 1000);
+        }
+    }
+    printf("\n");
+    printf("co-channel APs/packet %.2f\n", ratio(total.co_channel, total.station_packets));
+    printf("flash writes/node/round %.2f\n", ratio(total.flash_writes, node_rounds));
+    printf("charge/node/round     %.2f mAs\n", ratio(total.energy_uas, node_rounds) / 1000);
+    printf("dead nodes            %u (battery %u mAh)\n", dead, config->battery_mah);
+    print_death("first node death     ", first_death, first_death_round);
+    // lifetime ends when last node dies, which is known only if all did.
+    print_death("last node death      ", last_death, dead == config->nodes ? last_death_round : -1);
+
+    if (csv == NULL) {
+        return;
+    }
+
+    FILE* fp = fopen(csv, "w");
+
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open %s to write!\n", csv);
+        return;
+    }
+
+    fprintf(fp, "round,cluster_heads,stations,station_packets,uplinks,uplink_bytes,records,"
+                "ch_awake_ms,station_awake_ms,radio_ms,airtime_ms,flash_writes,charge_mas,deaths,relay_packets,"
+                "busiest_channel,busiest_channel_ms,co_channel_aps\n");
+    for (size_t i = 0; i < Network.rounds.size(); i++) {
+        const sim_round_stats_s* r = &Network.rounds[i];
+
+        size_t busiest = busiest_channel(r);
+
+        fprintf(fp, "%zu,%u,%u,%u,%u,%u,%u,%.1f,%.1f,%.1f,%.2f,%u,%.1f,%u,%u,%zu,%.2f,%.2f\n", i,
+                r->cluster_heads, r->stations, r->station_packets, r->uplinks, r->uplink_bytes, r->records,
+                ratio(r->ch_awake_us, r->cluster_heads) / 1000, ratio(r->station_awake_us, r->stations) / 1000,
+                r->radio_us / 1000.0, r->tx_us / 1000.0, r->flash_writes, r->energy_uas / 1000.0, r->deaths,
+                r->relay_packets, busiest, r->tx_channel_us[busiest] / 1000.0,
+                ratio(r->co_channel, r->station_packets));
+    }
+    fclose(fp);
+}
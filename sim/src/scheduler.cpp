@@ -0,0 +1,528 @@
+/** @file scheduler.cpp
+ *  @brief
+ *
+ *  This file contains discrete-event scheduler which
+ *  wakes simulated nodes and runs their round code.
+ *
+ *  Every wake up is split into two events. WAKE runs
+ *  init_round() and mode_decision(), and makes soft AP of
+ *  new cluster head visible. RUN runs handle_node() and
+ *  finish_round(). Stations are run after cluster heads
+ *  around them woke up, and cluster heads after stations
+ *  have sent their packets, so node code never has to
+ *  be suspended. Each node keeps its own virtual clock,
+ *  and datagrams carry time of arrival, so cluster head
+ *  sees them exactly when its listening loop reaches it.
+ *
+ *  Events are taken in batches one station lookahead
+ *  long, no event of a batch can cause another event in
+ *  the same batch. Batch runs in three phases (wake ups,
+ *  stations, cluster heads), and every node of a phase
+ *  is a task on work-stealing pool. Effects on other
+ *  nodes are collected per worker and applied after the
+ *  phase in fixed order, and soft AP capacity is given
+ *  to earliest association requests, so results for a
+ *  seed do not depend on number of threads.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <queue>
+#include <algorithm>
+#include "pool.h"
+#include "sim.h"
+
+/** Maximum number of times stations refused by full soft AP are run again.*/
+#define MAX_ADMISSION_PASSES    16
+
+/** Maximum number of times cluster heads are run again with relays of other cluster heads.*/
+#define MAX_RELAY_PASSES        16
+
+/** Marks node which is not cluster head of current batch.*/
+#define NOT_A_HEAD              0xFFFFFFFFu
+
+struct event_later
+{
+    bool operator()(const sim_event_s& a, const sim_event_s& b) const
+    {
+        if (a.time_us != b.time_us) {
+            return a.time_us > b.time_us;
+        }
+        if (a.node != b.node) {
+            return a.node > b.node;
+        }
+        return a.type > b.type;
+    }
+};
+
+static std::priority_queue<sim_event_s, std::vector<sim_event_s>, event_later> Events;
+static std::vector<sim_worker_s> Workers;
+static std::vector<sim_node_s> Snapshots;
+static std::vector<uint8_t> RolledBack;
+static std::vector<uint32_t> HeadIndex;
+
+static void schedule(uint64_t time_us, uint32_t node, uint8_t type)
+{
+    sim_worker()->events.push_back({time_us, node, type});
+}
+
+static bool packet_order(const sim_packet_s& a, const sim_packet_s& b)
+{
+    if (a.arrival_us != b.arrival_us) {
+        return a.arrival_us < b.arrival_us;
+    }
+
+    return a.sender < b.sender;
+}
+
+static bool delivery_order(const sim_delivery_s& a, const sim_delivery_s& b)
+{
+    if (a.to != b.to) {
+        return a.to < b.to;
+    }
+
+    return packet_order(a.packet, b.packet);
+}
+
+static bool same_packets(const std::vector<sim_packet_s>& a, const std::vector<sim_packet_s>& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].arrival_us != b[i].arrival_us || a[i].sender != b[i].sender || a[i].data != b[i].data) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool request_order(const sim_request_s& a, const sim_request_s& b)
+{
+    if (a.ap != b.ap) {
+        return a.ap < b.ap;
+    }
+    if (a.time_us != b.time_us) {
+        return a.time_us < b.time_us;
+    }
+
+    return a.station < b.station;
+}
+
+static void node_wake(sim_node_s* node, uint64_t time_us)
+{
+    const sim_config_s* config = &Network.config;
+
+    // RAM is lost in deep sleep, RTC memory and flash are not.
+    memset(&node->node, 0, sizeof(node->node));
+    memset(&node->stats, 0, sizeof(node->stats));
+    node->wake_us = time_us;
+    node->now_us = time_us + config->boot_us;
+    node->timer1_enabled = false;
+    node->asleep = false;
+    node->serial_enabled = false;
+    node->radio_on = true;
+    node->wifi_mode = WIFI_STA;
+    node->assoc = SIM_NO_AP;
+    node->connected_us = 0;
+    node->connect_status = WL_DISCONNECTED;
+    node->refused_aps.clear();
+    node->static_ip = 0;
+    node->bound_port = 0;
+    node->scan.clear();
+    node->inbox.clear();
+    node->inbox_read = 0;
+    node->wake_count++;
+
+    sim_set_current(node);
+    init_round(&node->node);
+    node->stats.energy_start_uas = node->node.energy.used_uas;
+    mode_decision(&node->node);
+
+    if (node->node.cluster_head == true) {
+        char ssid[40];
+
+        // soft AP is visible from wake up under name and channel firmware will give it.
+        access_point_name(&node->node, ssid);
+        sim_ap_start(node, ssid, node->now_us + config->ap_start_us,
+                     channel_select(node->node.nodeName, node->node.round), MAX_CONNECTED);
+        schedule(time_us + config->ch_defer_us, node->id, SIM_EVENT_RUN);
+    }
+    else {
+        schedule(node->now_us + config->station_lookahead_us, node->id, SIM_EVENT_RUN);
+    }
+}
+
+static void node_run(sim_node_s* node)
+{
+    if (node->node.cluster_head == true) {
+        std::sort(node->inbox.begin(), node->inbox.end(), packet_order);
+        node->inbox_read = 0;
+    }
+
+    sim_set_current(node);
+    handle_node(&node->node);
+    finish_round(&node->node);
+    sim_ap_stop(node);
+
+    node->stats.awake_us = node->now_us - node->wake_us;
+
+    // node does not wake up any more once its estimate used whole battery.
+    if (energy_left(&node->node.energy, Network.config.battery_mah) == 0) {
+        node->died_us = node->now_us;
+    }
+    else if (node->asleep == true && node->wake_count < Network.config.rounds) {
+        schedule(node->now_us + (uint64_t)(node->sleep_us * (1 + node->drift)), node->id, SIM_EVENT_WAKE);
+    }
+}
+
+static void account(const sim_node_s* node)
+{
+    sim_round_stats_s* stats = &Network.rounds[node->wake_count - 1];
+
+    if (node->node.cluster_head == true) {
+        stats->cluster_heads++;
+        stats->ch_awake_us += node->stats.awake_us;
+    }
+    else {
+        stats->stations++;
+        stats->station_awake_us += node->stats.awake_us;
+        stats->station_packets += node->stats.tx_packets;
+    }
+    stats->radio_us += node->stats.radio_us;
+    stats->tx_us += node->stats.tx_us;
+    for (size_t k = 0; k < SIM_CHANNELS; k++) {
+        stats->tx_channel_us[k] += node->stats.tx_channel_us[k];
+    }
+    stats->co_channel += node->stats.co_channel;
+    stats->flash_writes += node->stats.flash_writes;
+    stats->relay_packets += node->stats.relay_packets;
+    stats->energy_uas += node->node.energy.used_uas - node->stats.energy_start_uas;
+
+    if (node->died_us != 0) {
+        stats->deaths++;
+    }
+
+#if PHASE_TRACE
+    if (Network.trace_log != NULL) {
+        char line[TRACE_LINE_SIZE];
+
+        trace_format(line, &node->node.trace, node->node.nodeName, node->node.round,
+                     node->node.cluster_head, CYCLES_PER_US);
+        fprintf(Network.trace_log, "%s\n", line);
+    }
+#endif
+}
+
+static void wake_task(uint32_t index, void* arg)
+{
+    const sim_event_s* event = &(*(std::vector<sim_event_s>*)arg)[index];
+
+    sim_set_worker(&Workers[pool_worker()]);
+    node_wake(&Network.nodes[event->node], event->time_us);
+}
+
+static void run_task(uint32_t index, void* arg)
+{
+    uint32_t id = (*(std::vector<uint32_t>*)arg)[index];
+
+    sim_set_worker(&Workers[pool_worker()]);
+    node_run(&Network.nodes[id]);
+}
+
+static void snapshot_task(uint32_t index, void* arg)
+{
+    uint32_t id = (*(std::vector<uint32_t>*)arg)[index];
+
+    Snapshots[index] = Network.nodes[id];
+    run_task(index, arg);
+}
+
+static void apply_ap_changes(void)
+{
+    std::vector<uint32_t> changed;
+
+    for (size_t w = 0; w < Workers.size(); w++) {
+        changed.insert(changed.end(), Workers[w].ap_changes.begin(), Workers[w].ap_changes.end());
+        Workers[w].ap_changes.clear();
+    }
+
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+    for (size_t i = 0; i < changed.size(); i++) {
+        sim_ap_update(&Network.nodes[changed[i]]);
+    }
+}
+
+static void apply_effects(void)
+{
+    apply_ap_changes();
+
+    for (size_t w = 0; w < Workers.size(); w++) {
+        sim_worker_s* worker = &Workers[w];
+
+        for (size_t i = 0; i < worker->events.size(); i++) {
+            Events.push(worker->events[i]);
+        }
+        for (size_t i = 0; i < worker->uplinks.size(); i++) {
+            sim_round_stats_s* stats = &Network.rounds[worker->uplinks[i].round];
+
+            stats->uplinks++;
+            stats->uplink_bytes += worker->uplinks[i].len;
+            stats->records += worker->uplinks[i].records;
+        }
+        for (size_t i = 0; i < worker->deliveries.size(); i++) {
+            sim_node_s* ap = &Network.nodes[worker->deliveries[i].to];
+
+            if (ap->ap_up == true) {
+                ap->inbox.push_back(worker->deliveries[i].packet);
+            }
+        }
+        worker->events.clear();
+        worker->uplinks.clear();
+        worker->deliveries.clear();
+        worker->requests.clear();
+    }
+}
+
+static void drop_rolled_back(void)
+{
+    for (size_t w = 0; w < Workers.size(); w++) {
+        sim_worker_s* worker = &Workers[w];
+
+        worker->events.erase(std::remove_if(worker->events.begin(), worker->events.end(),
+            [](const sim_event_s& e) { return RolledBack[e.node] != 0; }), worker->events.end());
+        worker->uplinks.erase(std::remove_if(worker->uplinks.begin(), worker->uplinks.end(),
+            [](const sim_uplink_s& u) { return RolledBack[u.sender] != 0; }), worker->uplinks.end());
+        worker->deliveries.erase(std::remove_if(worker->deliveries.begin(), worker->deliveries.end(),
+            [](const sim_delivery_s& d) { return RolledBack[d.packet.sender] != 0; }), worker->deliveries.end());
+        worker->requests.erase(std::remove_if(worker->requests.begin(), worker->requests.end(),
+            [](const sim_request_s& r) { return RolledBack[r.station] != 0; }), worker->requests.end());
+        worker->ap_changes.erase(std::remove_if(worker->ap_changes.begin(), worker->ap_changes.end(),
+            [](uint32_t id) { return RolledBack[id] != 0; }), worker->ap_changes.end());
+    }
+}
+
+static void run_stations(std::vector<uint32_t>* stations)
+{
+    std::vector<sim_request_s> requests;
+    std::vector<uint32_t> refused;
+    std::vector<uint32_t> refused_by;
+
+    Snapshots.resize(stations->size());
+    pool_run(stations->size(), snapshot_task, stations);
+
+    for (int pass = 0; pass < MAX_ADMISSION_PASSES; pass++) {
+        requests.clear();
+        refused.clear();
+        refused_by.clear();
+
+        for (size_t w = 0; w < Workers.size(); w++) {
+            requests.insert(requests.end(), Workers[w].requests.begin(), Workers[w].requests.end());
+        }
+        std::sort(requests.begin(), requests.end(), request_order);
+
+        for (size_t i = 0; i < requests.size(); ) {
+            const sim_node_s* ap = &Network.nodes[requests[i].ap];
+            uint32_t connected = ap->ap_stations_us.size();
+            uint32_t free = ap->ap_max_connected > connected ? ap->ap_max_connected - connected : 0;
+            size_t j = i;
+
+            for (; j < requests.size() && requests[j].ap == requests[i].ap; j++) {
+                if (j - i >= free) {
+                    refused.push_back(requests[j].station);
+                    refused_by.push_back(requests[j].ap);
+                }
+            }
+            i = j;
+        }
+
+        if (refused.empty()) {
+            break;
+        }
+
+        // run refused stations again from their state before this batch.
+        std::vector<uint32_t> rerun;
+
+        for (size_t i = 0; i < refused.size(); i++) {
+            RolledBack[refused[i]] = 1;
+        }
+        drop_rolled_back();
+
+        for (size_t k = 0; k < stations->size(); k++) {
+            uint32_t id = (*stations)[k];
+
+            if (RolledBack[id] != 0) {
+                std::vector<uint32_t> refused_aps;
+
+                // APs which refused station in earlier passes stay refused.
+                refused_aps.swap(Network.nodes[id].refused_aps);
+                Network.nodes[id] = Snapshots[k];
+                Network.nodes[id].refused_aps.swap(refused_aps);
+                rerun.push_back(id);
+            }
+        }
+        for (size_t i = 0; i < refused.size(); i++) {
+            Network.nodes[refused[i]].refused_aps.push_back(refused_by[i]);
+            RolledBack[refused[i]] = 0;
+        }
+        pool_run(rerun.size(), run_task, &rerun);
+    }
+
+    for (size_t w = 0; w < Workers.size(); w++) {
+        for (size_t i = 0; i < Workers[w].requests.size(); i++) {
+            const sim_request_s* request = &Workers[w].requests[i];
+
+            Network.nodes[request->ap].ap_stations_us.push_back(request->assoc_us);
+        }
+    }
+}
+
+static void run_heads(std::vector<uint32_t>* heads)
+{
+    std::vector<std::vector<sim_packet_s> > inputs(heads->size());
+    std::vector<sim_delivery_s> relays;
+
+    Snapshots.resize(heads->size());
+    for (size_t k = 0; k < heads->size(); k++) {
+        HeadIndex[(*heads)[k]] = k;
+    }
+    pool_run(heads->size(), snapshot_task, heads);
+
+    // cluster head which relays runs in parallel with the one it relays to,
+    // which is then run again from its state before this batch with relays
+    // added to its inbox, until relays stop changing.
+    for (int pass = 0; pass < MAX_RELAY_PASSES; pass++) {
+        std::vector<std::vector<sim_packet_s> > received(heads->size());
+        std::vector<uint32_t> rerun;
+        std::vector<uint32_t> refused;
+        std::vector<uint32_t> refused_by;
+
+        relays.clear();
+        for (size_t w = 0; w < Workers.size(); w++) {
+            for (size_t i = 0; i < Workers[w].deliveries.size(); i++) {
+                if (HeadIndex[Workers[w].deliveries[i].to] != NOT_A_HEAD) {
+                    relays.push_back(Workers[w].deliveries[i]);
+                }
+            }
+        }
+        std::sort(relays.begin(), relays.end(), delivery_order);
+
+        for (size_t i = 0; i < relays.size(); i++) {
+            const sim_node_s* to = &Network.nodes[relays[i].to];
+
+            // soft AP which was down already would not have let relaying node in.
+            if (to->ap_down_us < relays[i].packet.arrival_us) {
+                if (RolledBack[relays[i].packet.sender] == 0) {
+                    RolledBack[relays[i].packet.sender] = 1;
+                    refused.push_back(relays[i].packet.sender);
+                    refused_by.push_back(relays[i].to);
+                }
+            }
+        }
+        for (size_t i = 0; i < relays.size(); i++) {
+            if (RolledBack[relays[i].packet.sender] == 0) {
+                received[HeadIndex[relays[i].to]].push_back(relays[i].packet);
+            }
+        }
+        for (size_t k = 0; k < heads->size(); k++) {
+            if (same_packets(received[k], inputs[k]) == false) {
+                inputs[k].swap(received[k]);
+                RolledBack[(*heads)[k]] = 1;
+            }
+        }
+
+        for (size_t k = 0; k < heads->size(); k++) {
+            if (RolledBack[(*heads)[k]] != 0) {
+                rerun.push_back((*heads)[k]);
+            }
+        }
+        if (rerun.empty()) {
+            break;
+        }
+        drop_rolled_back();
+
+        for (size_t i = 0; i < rerun.size(); i++) {
+            uint32_t k = HeadIndex[rerun[i]];
+            std::vector<uint32_t> refused_aps;
+
+            refused_aps.swap(Network.nodes[rerun[i]].refused_aps);
+            Network.nodes[rerun[i]] = Snapshots[k];
+            Network.nodes[rerun[i]].refused_aps.swap(refused_aps);
+            Network.nodes[rerun[i]].inbox.insert(Network.nodes[rerun[i]].inbox.end(),
+                                                 inputs[k].begin(), inputs[k].end());
+            RolledBack[rerun[i]] = 0;
+        }
+        for (size_t i = 0; i < refused.size(); i++) {
+            Network.nodes[refused[i]].refused_aps.push_back(refused_by[i]);
+        }
+        pool_run(rerun.size(), run_task, &rerun);
+    }
+
+    for (size_t k = 0; k < heads->size(); k++) {
+        HeadIndex[(*heads)[k]] = NOT_A_HEAD;
+    }
+}
+
+void sim_run(void)
+{
+    std::vector<sim_event_s> wakes;
+    std::vector<uint32_t> stations;
+    std::vector<uint32_t> heads;
+
+    pool_start(Network.config.threads);
+    Workers.assign(pool_threads(), sim_worker_s());
+    RolledBack.assign(Network.nodes.size(), 0);
+    HeadIndex.assign(Network.nodes.size(), NOT_A_HEAD);
+    Events = std::priority_queue<sim_event_s, std::vector<sim_event_s>, event_later>();
+
+    for (size_t i = 0; i < Network.nodes.size(); i++) {
+        Events.push({Network.nodes[i].wake_us, (uint32_t)i, SIM_EVENT_WAKE});
+    }
+
+    while (Events.empty() == false) {
+        uint64_t end = Events.top().time_us + Network.config.station_lookahead_us;
+
+        wakes.clear();
+        stations.clear();
+        heads.clear();
+
+        while (Events.empty() == false && Events.top().time_us < end) {
+            sim_event_s event = Events.top();
+
+            Events.pop();
+            Network.events++;
+
+            if (event.type == SIM_EVENT_WAKE) {
+                wakes.push_back(event);
+            }
+            else if (Network.nodes[event.node].node.cluster_head == true) {
+                heads.push_back(event.node);
+            }
+            else {
+                stations.push_back(event.node);
+            }
+        }
+
+        pool_run(wakes.size(), wake_task, &wakes);
+        apply_effects();
+
+        run_stations(&stations);
+        apply_effects();
+        for (size_t i = 0; i < stations.size(); i++) {
+            account(&Network.nodes[stations[i]]);
+        }
+
+        run_heads(&heads);
+        apply_effects();
+        for (size_t i = 0; i < heads.size(); i++) {
+            account(&Network.nodes[heads[i]]);
+        }
+    }
+
+    pool_stop();
+    sim_set_current(NULL);
+}
@@ -0,0 +1,140 @@
+/** @file sim_main.cpp
+ *  @brief
+ *
+ *  Command line entry of LEACH network simulator.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <chrono>
+#include "sim.h"
+
+static void usage(const char* name)
+{
+    printf("Usage: %s [options]\n"
+           "  --nodes N          number of nodes (default 1000)\n"
+           "  --rounds N         wake ups of every node (default 100)\n"
+           "  --seed N           random seed (default 1)\n"
+           "  --field M          side of square field in m (default 100)\n"
+           "  --base X,Y         base station position in m (default field center)\n"
+           "  --shadowing DB     standard deviation of per link shadowing (default 0)\n"
+           "  --drift-ppm N      maximum RTC drift of node (default 5000)\n"
+           "  --battery-mah N    battery capacity of node (default %u)\n"
+           "  --duplicate P      percent of station datagrams cluster head receives twice (default 0)\n"
+           "  --threads N        worker threads, 0 for number of cores (default 0)\n"
+           "  --trace-node N     print serial output of node N\n"
+           "  --csv FILE         write statistics of every round\n"
+           "  --trace-log FILE   write phase trace of every wake up (needs -DPHASE_TRACE=1)\n",
+           name, BATTERY_CAPACITY_MAH);
+}
+
+int main(int argc, char** argv)
+{
+    sim_config_s config;
+    const char* csv = NULL;
+    const char* trace_log = NULL;
+    bool base_set = false;
+
+    sim_default_config(&config);
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0 || value == NULL) {
+            usage(argv[0]);
+            return strcmp(arg, "--help") == 0 ? 0 : 1;
+        }
+        i++;
+
+        if (strcmp(arg, "--nodes") == 0) {
+            config.nodes = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--rounds") == 0) {
+            config.rounds = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--seed") == 0) {
+            config.seed = strtoull(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--field") == 0) {
+            config.field_size = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--base") == 0) {
+            if (sscanf(value, "%f,%f", &config.base_x, &config.base_y) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            base_set = true;
+        }
+        else if (strcmp(arg, "--shadowing") == 0) {
+            config.shadowing_db = strtof(value, NULL);
+        }
+        else if (strcmp(arg, "--drift-ppm") == 0) {
+            config.drift_ppm = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--battery-mah") == 0) {
+            config.battery_mah = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--duplicate") == 0) {
+            config.duplicate_percent = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--threads") == 0) {
+            config.threads = strtoul(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--trace-node") == 0) {
+            config.trace_node = strtol(value, NULL, 10);
+        }
+        else if (strcmp(arg, "--csv") == 0) {
+            csv = value;
+        }
+        else if (strcmp(arg, "--trace-log") == 0) {
+            trace_log = value;
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (base_set == false) {
+        config.base_x = config.field_size / 2;
+        config.base_y = config.field_size / 2;
+    }
+
+    if (config.nodes == 0 || config.nodes > 0xFFFFFF || config.rounds == 0) {
+        fprintf(stderr, "Number of nodes must be 1 - 16777215, and rounds at least 1!\n");
+        return 1;
+    }
+
+    if (trace_log != NULL && PHASE_TRACE == 0) {
+        fprintf(stderr, "Phase trace needs firmware built with -DPHASE_TRACE=1!\n");
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    sim_init(&config);
+
+    if (trace_log != NULL) {
+        Network.trace_log = fopen(trace_log, "w");
+
+        if (Network.trace_log == NULL) {
+            fprintf(stderr, "Could not open %s to write!\n", trace_log);
+            return 1;
+        }
+    }
+
+    sim_run();
+
+    if (Network.trace_log != NULL) {
+        fclose(Network.trace_log);
+        Network.trace_log = NULL;
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+    sim_report(csv, wall.count());
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+/** @file aggregate_test.cpp
+ *  @brief
+ *
+ *  Host test of aggregation at cluster head, built with
+ *  AGGREGATE_HISTOGRAM so summary and bins are both
+ *  checked: minimum, maximum, sum and mean of readings,
+ *  record read back as encoded, merge of other cluster
+ *  head record, and empty and corrupted records.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "check.h"
+#include "aggregate.h"
+
+static const uint8_t mac[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x00, 0x00, 0x07};
+
+static const uint16_t values[] = {5, ADC_RANGE - 1, ADC_RANGE / 2, 100};
+
+#define VALUES                  (sizeof(values) / sizeof(values[0]))
+
+static void fill(aggregate_s* aggregate)
+{
+    uint8_t frame[FRAME_SIZE];
+
+    aggregate_init(aggregate);
+    for (size_t i = 0; i < VALUES; i++) {
+        frame_encode(frame, mac, values[i], 3, i);
+        aggregate_add(aggregate, frame);
+    }
+}
+
+static void test_summary(void)
+{
+    uint8_t record[HISTOGRAM_SIZE];
+    aggregate_s aggregate;
+    uint32_t sum = 5 + (ADC_RANGE - 1) + ADC_RANGE / 2 + 100;
+
+    fill(&aggregate);
+    CHECK(aggregate.count == VALUES);
+    CHECK(aggregate.min == 5);
+    CHECK(aggregate.max == ADC_RANGE - 1);
+    CHECK(aggregate.sum == sum);
+
+    CHECK(aggregate_encode(record, &aggregate, mac, 3) == HISTOGRAM_SIZE);
+    CHECK(summary_is_valid(record, HISTOGRAM_SIZE, UPLINK_HISTOGRAM));
+    CHECK(summary_count(record) == VALUES);
+    CHECK(summary_min(record) == 5);
+    CHECK(summary_max(record) == ADC_RANGE - 1);
+    CHECK(summary_sum(record) == sum);
+    CHECK(summary_sum(record) / summary_count(record) == sum / VALUES);
+
+    // 5 and 100 share first bin, middle value starts upper half, maximum is in last bin.
+    CHECK(summary_bin(record, 0) == 2);
+    CHECK(summary_bin(record, AGGREGATE_BINS / 2) == 1);
+    CHECK(summary_bin(record, AGGREGATE_BINS - 1) == 1);
+
+    record[SUMMARY_SUM_OFFSET] ^= 0x01;
+    CHECK(summary_is_valid(record, HISTOGRAM_SIZE, UPLINK_HISTOGRAM) == false);
+    CHECK(summary_is_valid(record, HISTOGRAM_SIZE - 1, UPLINK_HISTOGRAM) == false);
+    CHECK(summary_is_valid(record, HISTOGRAM_SIZE, UPLINK_DELTA) == false);
+}
+
+static void test_merge(void)
+{
+    uint8_t record[HISTOGRAM_SIZE];
+    uint8_t frame[FRAME_SIZE];
+    aggregate_s aggregate;
+    aggregate_s other;
+
+    fill(&other);
+    aggregate_encode(record, &other, mac, 3);
+
+    aggregate_init(&aggregate);
+    frame_encode(frame, mac, 1, 3, 0);
+    aggregate_add(&aggregate, frame);
+
+    // relayed record counts as if its readings were added one by one.
+    aggregate_merge(&aggregate, record);
+    CHECK(aggregate.count == VALUES + 1);
+    CHECK(aggregate.min == 1);
+    CHECK(aggregate.max == ADC_RANGE - 1);
+    CHECK(aggregate.sum == other.sum + 1);
+    CHECK(aggregate.bins[0] == 3);
+}
+
+static void test_empty(void)
+{
+    uint8_t record[HISTOGRAM_SIZE];
+    aggregate_s aggregate;
+    aggregate_s other;
+
+    aggregate_init(&aggregate);
+    aggregate_encode(record, &aggregate, mac, 0);
+    CHECK(summary_is_valid(record, HISTOGRAM_SIZE, UPLINK_HISTOGRAM));
+    CHECK(summary_count(record) == 0);
+    CHECK(summary_min(record) == 0);
+
+    // empty record leaves aggregate as it was.
+    fill(&other);
+    aggregate_merge(&other, record);
+    CHECK(other.count == VALUES && other.min == 5);
+}
+
+int main(void)
+{
+    test_summary();
+    test_merge();
+    test_empty();
+
+    return CHECK_RESULT();
+}
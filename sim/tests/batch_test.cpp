@@ -0,0 +1,118 @@
+/** @file batch_test.cpp
+ *  @brief
+ *
+ *  Host test of readings held by station: batch whose
+ *  readings span wrap of round and of sequence number is
+ *  taken by base station as new readings, raw and delta
+ *  encoded, and resent batch as late and duplicate ones.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "check.h"
+#include "batch.h"
+#include "election.h"
+#include "base.h"
+
+/** Held readings, round and sequence number wrap between them.*/
+#define READINGS                8
+
+/** Columnar file test writes, removed at the end.*/
+#define OUTPUT                  "batch_test.col"
+
+static const uint8_t mac[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x00, 0x01, 0x2A};
+
+static column_writer_s writer;
+
+static void hold(batch_s* batch)
+{
+    batch_init(batch);
+
+    for (uint32_t reading = 250; reading < 250 + READINGS; reading++) {
+        batch_add(batch, 100 + reading, reading % NUMBER_OF_ROUNDS, reading & 0xFF);
+    }
+}
+
+static void test_frames(void)
+{
+    uint8_t held[BATCH_DATAGRAM_SIZE];
+    batch_s batch;
+
+    hold(&batch);
+    size_t len = batch_encode(held, &batch, mac);
+
+    CHECK(batch_frames(held, len) == READINGS);
+
+    // no two frames of batch carry same round and sequence number.
+    for (size_t i = 0; i < READINGS; i++) {
+        for (size_t j = i + 1; j < READINGS; j++) {
+            CHECK(frame_round(held + i * FRAME_SIZE) != frame_round(held + j * FRAME_SIZE) ||
+                  frame_seq(held + i * FRAME_SIZE) != frame_seq(held + j * FRAME_SIZE));
+        }
+    }
+}
+
+static void test_raw(void)
+{
+    static base_datagram_s datagram;
+    base_ingest_s ingest;
+    batch_s batch;
+
+    hold(&batch);
+    base_ingest_init(&ingest, &writer, 16);
+
+    uplink_encode_header(datagram.data, 0, 1, READINGS, UPLINK_FRAMES_RAW);
+    datagram.len = UPLINK_HEADER_SIZE + batch_encode(datagram.data + UPLINK_HEADER_SIZE, &batch, mac);
+
+    base_ingest(&ingest, &datagram);
+    CHECK(ingest.stats.records == READINGS);
+    CHECK(ingest.stats.duplicates == 0 && ingest.stats.late == 0);
+
+    // other cluster head resends whole batch.
+    base_ingest(&ingest, &datagram);
+    CHECK(ingest.stats.duplicates == 1 && ingest.stats.late == READINGS - 1);
+}
+
+static void test_delta(void)
+{
+    static base_datagram_s datagram;
+    uint8_t frames[BATCH_DATAGRAM_SIZE];
+    base_ingest_s ingest;
+    batch_s batch;
+    uint16_t used;
+
+    hold(&batch);
+    base_ingest_init(&ingest, &writer, 16);
+
+    batch_encode(frames, &batch, mac);
+    delta_sort(frames, READINGS);
+
+    // cluster head round is round of newest reading.
+    size_t len = delta_encode(datagram.data + UPLINK_HEADER_SIZE, frames, READINGS,
+                              (250 + READINGS - 1) % NUMBER_OF_ROUNDS, &used);
+
+    uplink_encode_header(datagram.data, 0, 1, used, UPLINK_DELTA);
+    datagram.len = UPLINK_HEADER_SIZE + len;
+
+    base_ingest(&ingest, &datagram);
+    CHECK(used == READINGS);
+    CHECK(ingest.stats.records == READINGS);
+    CHECK(ingest.stats.duplicates == 0 && ingest.stats.late == 0);
+}
+
+int main(void)
+{
+    CHECK(column_open(&writer, OUTPUT));
+
+    test_frames();
+    test_raw();
+    test_delta();
+
+    column_close(&writer);
+    remove(OUTPUT);
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,73 @@
+/** @file channel_test.cpp
+ *  @brief
+ *
+ *  Host test of cluster head channel: picked channel is
+ *  always one of CLUSTER_CHANNELS, picks spread evenly
+ *  over the set, and one cluster head changes channel
+ *  from round to round. Built with default set and with
+ *  channels 1, 6 and 11.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "check.h"
+#include "channel.h"
+
+/** Cluster heads picking channel.*/
+#define HEADS                   3000
+
+static void test_count(void)
+{
+    CHECK(channel_count(0) == 0);
+    CHECK(channel_count(0x0842) == 3);
+    CHECK(channel_count(0x3FFE) == 13);
+    CHECK((SCAN_CHANNELS & CLUSTER_CHANNELS) == CLUSTER_CHANNELS);
+    CHECK((SCAN_CHANNELS & 1 << WIFI_CHANNEL) != 0);
+}
+
+static void test_spread(void)
+{
+    uint32_t picks[14] = {0};
+    uint32_t changed = 0;
+
+    for (uint32_t h = 0; h < HEADS; h++) {
+        uint8_t mac[6] = {0x5C, 0xCF, 0x7F, (uint8_t)(h >> 16), (uint8_t)(h >> 8), (uint8_t)h};
+        uint8_t previous = channel_select(mac, 0);
+
+        for (uint16_t round = 0; round < 256; round += 51) {
+            uint8_t channel = channel_select(mac, round);
+
+            CHECK(channel >= 1 && channel <= 13);
+            CHECK((CLUSTER_CHANNELS & 1 << channel) != 0);
+            picks[channel]++;
+            changed += channel != previous;
+            previous = channel;
+        }
+    }
+
+    // every channel of set gets its share within 10 %.
+    for (uint8_t channel = 1; channel <= 13; channel++) {
+        if ((CLUSTER_CHANNELS & 1 << channel) != 0) {
+            uint32_t share = 6 * HEADS / channel_count(CLUSTER_CHANNELS);
+
+            CHECK(picks[channel] > share - share / 10 && picks[channel] < share + share / 10);
+        }
+    }
+
+    // with more than one channel, pairs which collide change between rounds.
+    if (channel_count(CLUSTER_CHANNELS) > 1) {
+        CHECK(changed > HEADS);
+    }
+    else {
+        CHECK(changed == 0);
+    }
+}
+
+int main(void)
+{
+    test_count();
+    test_spread();
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,31 @@
+/** @file check.h
+ *  @brief Minimal checks of host tests.
+ *
+ *  Every test is a program which runs its cases and
+ *  returns non zero if any check failed, so ctest can
+ *  run it. Failed checks are printed with file and line.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs.
+ */
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+/** Number of failed checks of test program.*/
+static int check_failures = 0;
+
+/** Checks that condition holds, prints it otherwise.*/
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            check_failures++;                                               \
+        }                                                                   \
+    } while (0)
+
+/** Result of test program.*/
+#define CHECK_RESULT()          (check_failures == 0 ? 0 : 1)
+
+#endif // CHECK_H_
@@ -0,0 +1,148 @@
+/** @file dedup_test.cpp
+ *  @brief
+ *
+ *  Host test of duplicate suppression: readings of many
+ *  epochs, whose rounds wrap at NUMBER_OF_ROUNDS and
+ *  sequence numbers at 256, are all new, repeated ones
+ *  are duplicates, resent older ones are late, node which
+ *  restarted is taken again, every station keeps its own
+ *  counters, and stations past 3/4 of slots are let through
+ *  as new.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "check.h"
+#include "frame.h"
+#include "dedup.h"
+#include "election.h"
+
+/** Slots of test table.*/
+#define SLOTS                   64
+
+static const uint8_t mac[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x00, 0x00, 0x2A};
+
+static dedup_result_e check(dedup_s* table, uint32_t reading)
+{
+    uint8_t frame[FRAME_SIZE];
+
+    frame_encode(frame, mac, 100, reading % NUMBER_OF_ROUNDS, reading & 0xFF);
+
+    return dedup_check(table, frame);
+}
+
+static void test_wrap(void)
+{
+    dedup_entry_s slots[SLOTS];
+    dedup_s table;
+
+    dedup_init(&table, slots, SLOTS);
+
+    // several epochs, sequence number wraps as well.
+    for (uint32_t reading = 0; reading < 600; reading++) {
+        CHECK(check(&table, reading) == DEDUP_NEW);
+        CHECK(check(&table, reading) == DEDUP_DUPLICATE);
+    }
+    CHECK(table.late == 0);
+    CHECK(table.duplicated == 600);
+}
+
+static void test_late(void)
+{
+    dedup_entry_s slots[SLOTS];
+    dedup_s table;
+
+    dedup_init(&table, slots, SLOTS);
+
+    for (uint32_t reading = 250; reading < 262; reading++) {
+        CHECK(check(&table, reading) == DEDUP_NEW);
+    }
+
+    // readings resent by other cluster head, across wrap of both fields.
+    CHECK(check(&table, 254) == DEDUP_LATE);
+    CHECK(check(&table, 256) == DEDUP_LATE);
+    CHECK(check(&table, 261 - DEDUP_LATE_WINDOW) == DEDUP_LATE);
+
+    // node restarted, numbering went far back.
+    CHECK(check(&table, 261 - DEDUP_LATE_WINDOW - 1) == DEDUP_NEW);
+    CHECK(check(&table, 261 - DEDUP_LATE_WINDOW) == DEDUP_NEW);
+}
+
+static void frame_of(uint8_t* frame, uint16_t station, uint8_t seq)
+{
+    uint8_t other[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x01, (uint8_t)(station >> 8), (uint8_t)station};
+
+    frame_encode(frame, other, 100, 3, seq);
+}
+
+static void test_stations(void)
+{
+    static dedup_entry_s slots[1024];
+    uint8_t frame[FRAME_SIZE];
+    dedup_s table;
+
+    CHECK(dedup_capacity(0) == 2);
+    CHECK(dedup_capacity(7) == 16);
+    CHECK(dedup_capacity(500) == 1024);
+
+    dedup_init(&table, slots, dedup_capacity(500));
+
+    // station s sends s % 3 + 1 readings, last one twice.
+    for (uint16_t s = 0; s < 500; s++) {
+        for (uint8_t seq = 0; seq <= s % 3; seq++) {
+            frame_of(frame, s, seq);
+            CHECK(dedup_check(&table, frame) == DEDUP_NEW);
+        }
+        CHECK(dedup_check(&table, frame) == DEDUP_DUPLICATE);
+    }
+
+    CHECK(table.count == 500);
+    CHECK(table.overflow == 0);
+    for (uint16_t s = 0; s < 500; s++) {
+        const dedup_entry_s* entry;
+
+        frame_of(frame, s, 0);
+        entry = dedup_find(&table, frame_mac(frame));
+        CHECK(entry != NULL && entry->seq == s % 3);
+        CHECK(entry != NULL && entry->received == s % 3 + 2 && entry->duplicated == 1 && entry->late == 0);
+    }
+
+    frame_of(frame, 500, 0);
+    CHECK(dedup_find(&table, frame_mac(frame)) == NULL);
+
+    dedup_clear(&table);
+    frame_of(frame, 0, 0);
+    CHECK(table.count == 0 && table.received == 0);
+    CHECK(dedup_find(&table, frame_mac(frame)) == NULL);
+}
+
+static void test_overflow(void)
+{
+    dedup_entry_s slots[8];
+    uint8_t frame[FRAME_SIZE];
+    dedup_s table;
+
+    dedup_init(&table, slots, 8);
+
+    // 6 of 8 slots take stations, other 4 are never suppressed.
+    for (uint16_t s = 0; s < 10; s++) {
+        frame_of(frame, s, 0);
+        CHECK(dedup_check(&table, frame) == DEDUP_NEW);
+        CHECK(dedup_check(&table, frame) == (s < 6 ? DEDUP_DUPLICATE : DEDUP_NEW));
+    }
+
+    CHECK(table.count == 6);
+    CHECK(table.overflow == 8);
+    CHECK(table.duplicated == 6);
+}
+
+int main(void)
+{
+    test_wrap();
+    test_late();
+    test_stations();
+    test_overflow();
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,148 @@
+/** @file delta_test.cpp
+ *  @brief
+ *
+ *  Host test of delta encoded uplink: frames come back
+ *  as they were sorted, across round wrap and for values
+ *  which jump, held readings of one station stay in order
+ *  across wrap of sequence number, frames which do not fit
+ *  go to next datagrams, and corrupted datagram is rejected.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "check.h"
+#include "frame.h"
+#include "delta.h"
+
+/** Frames in test uplink, more than one keyframe interval.*/
+#define FRAMES                  40
+
+/** Frames which need several datagrams.*/
+#define MANY_FRAMES             600
+
+static size_t build(uint8_t* datagram, uint8_t* frames, uint16_t count, uint8_t round, uint16_t* used)
+{
+    size_t len = delta_encode(datagram + UPLINK_HEADER_SIZE, frames, count, round, used);
+
+    uplink_encode_header(datagram, 0, 1, *used, UPLINK_DELTA);
+
+    return UPLINK_HEADER_SIZE + len;
+}
+
+static void make_frames(uint8_t* frames)
+{
+    for (uint16_t i = 0; i < FRAMES; i++) {
+        uint8_t mac[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x00, (uint8_t)(i >> 3), (uint8_t)(i * 37)};
+        // rounds of held readings before wrap of NUMBER_OF_ROUNDS, values jump.
+        uint8_t round = (i % 3 == 0) ? 5 : (i % 3 == 1) ? 6 : 0;
+        uint16_t value = (i % 5 == 0) ? 1023 : (uint16_t)(i * 11);
+
+        frame_encode(frames + i * FRAME_SIZE, mac, value, round, (uint8_t)(250 + i));
+    }
+    delta_sort(frames, FRAMES);
+}
+
+static void test_round_trip(void)
+{
+    uint8_t frames[FRAMES * FRAME_SIZE];
+    uint8_t decoded[FRAMES * FRAME_SIZE];
+    uint8_t datagram[UPLINK_DATAGRAM_SIZE];
+    uint16_t used;
+
+    make_frames(frames);
+
+    // round of cluster head is 0, frames of rounds 5 and 6 are behind it.
+    size_t len = build(datagram, frames, FRAMES, 0, &used);
+
+    CHECK(used == FRAMES);
+    CHECK(len <= UPLINK_DATAGRAM_SIZE);
+    CHECK(delta_decode(datagram, len, decoded, FRAMES) == FRAMES);
+    CHECK(memcmp(decoded, frames, sizeof(frames)) == 0);
+}
+
+static void test_reject(void)
+{
+    uint8_t frames[FRAMES * FRAME_SIZE];
+    uint8_t decoded[FRAMES * FRAME_SIZE];
+    uint8_t datagram[UPLINK_DATAGRAM_SIZE];
+    uint16_t used;
+
+    make_frames(frames);
+    size_t len = build(datagram, frames, FRAMES, 0, &used);
+
+    datagram[UPLINK_HEADER_SIZE + 7] ^= 0x04;
+    CHECK(delta_decode(datagram, len, decoded, FRAMES) == 0);
+    datagram[UPLINK_HEADER_SIZE + 7] ^= 0x04;
+
+    CHECK(delta_decode(datagram, len - 1, decoded, FRAMES) == 0);
+
+    datagram[3] = UPLINK_FRAMES_RAW;
+    CHECK(delta_decode(datagram, len, decoded, FRAMES) == 0);
+}
+
+static void test_sort(void)
+{
+    static const uint8_t mac[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x00, 0x00, 0x2A};
+    static const uint8_t seqs[] = {3, 254, 0, 252, 1, 255, 253, 2};
+    uint8_t frames[sizeof(seqs) * FRAME_SIZE];
+
+    for (size_t i = 0; i < sizeof(seqs); i++) {
+        frame_encode(frames + i * FRAME_SIZE, mac, 100, 0, seqs[i]);
+    }
+    delta_sort(frames, sizeof(seqs));
+
+    // 252 .. 255 come before 0 .. 3, they were taken earlier.
+    for (size_t i = 0; i < sizeof(seqs); i++) {
+        CHECK(frame_seq(frames + i * FRAME_SIZE) == (uint8_t)(252 + i));
+    }
+}
+
+static void test_split(void)
+{
+    static uint8_t frames[MANY_FRAMES * FRAME_SIZE];
+    static uint8_t decoded[MANY_FRAMES * FRAME_SIZE];
+    uint8_t datagram[UPLINK_DATAGRAM_SIZE];
+    uint32_t x = 12345;
+    uint16_t sent = 0;
+    uint8_t datagrams = 0;
+
+    // MACs far apart and values random, records do not compress well.
+    for (uint16_t i = 0; i < MANY_FRAMES; i++) {
+        uint8_t mac[FRAME_MAC_SIZE];
+
+        for (uint8_t b = 0; b < FRAME_MAC_SIZE; b++) {
+            x = x * 1103515245 + 12345;
+            mac[b] = x >> 16;
+        }
+        frame_encode(frames + i * FRAME_SIZE, mac, (x >> 8) & 0x3FF, i % 7, i & 0xFF);
+    }
+    delta_sort(frames, MANY_FRAMES);
+
+    while (sent < MANY_FRAMES) {
+        uint16_t used;
+        size_t len = build(datagram, frames + sent * FRAME_SIZE, MANY_FRAMES - sent, 3, &used);
+
+        CHECK(used > 0 && used <= DELTA_RECORDS_MAX);
+        CHECK(len <= UPLINK_DATAGRAM_SIZE);
+        CHECK(delta_decode(datagram, len, decoded + sent * FRAME_SIZE, MANY_FRAMES - sent) == used);
+
+        sent += used;
+        datagrams++;
+    }
+
+    CHECK(datagrams > 1);
+    CHECK(datagrams == delta_fragments(frames, MANY_FRAMES, 3));
+    CHECK(memcmp(decoded, frames, sizeof(frames)) == 0);
+}
+
+int main(void)
+{
+    test_round_trip();
+    test_reject();
+    test_sort();
+    test_split();
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,107 @@
+/** @file election_test.cpp
+ *  @brief
+ *
+ *  Host test of cluster head election: thresholds made by
+ *  compiler follow LEACH formula, generator never sticks
+ *  and its draws are even, and with nodes which stay out
+ *  for the rest of epoch once elected, about 1/N of nodes
+ *  is elected in every round and every node once per epoch.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <math.h>
+#include <string.h>
+#include "check.h"
+#include "election.h"
+
+/** Nodes of simulated network.*/
+#define NODES                   7000
+
+/** Epochs of simulated network.*/
+#define EPOCHS                  20
+
+static void test_table(void)
+{
+    for (uint16_t r = 0; r < NUMBER_OF_ROUNDS; r++) {
+        double p = 1.0 / NUMBER_OF_ROUNDS;
+        double t = p / (1 - p * (r % NUMBER_OF_ROUNDS));
+
+        CHECK(fabs(election_round_threshold(r) - t * ELECTION_ONE) <= 0.5);
+        CHECK(election_round_threshold(r) == election_round_threshold(r + NUMBER_OF_ROUNDS));
+        if (r > 0) {
+            CHECK(election_round_threshold(r) > election_round_threshold(r - 1));
+        }
+    }
+    CHECK(election_round_threshold(NUMBER_OF_ROUNDS - 1) == ELECTION_ONE);
+}
+
+static void test_random(void)
+{
+    uint32_t state = election_seed(0);
+    uint32_t buckets[16];
+
+    CHECK(state == ELECTION_DEFAULT_SEED);
+    CHECK(election_seed(12345) == 12345);
+
+    memset(buckets, 0, sizeof(buckets));
+    for (uint32_t i = 0; i < 160000; i++) {
+        uint32_t x = election_random(&state);
+
+        CHECK(x < ELECTION_ONE);
+        buckets[x >> 12]++;
+    }
+    CHECK(state != 0);
+
+    // 10000 draws expected in every bucket, standard deviation about 100.
+    for (uint8_t b = 0; b < 16; b++) {
+        CHECK(buckets[b] > 9500 && buckets[b] < 10500);
+    }
+}
+
+static void test_rounds(void)
+{
+    static uint32_t rng[NODES];
+    static uint8_t elected[NODES];
+    uint32_t per_round[NUMBER_OF_ROUNDS];
+
+    for (uint32_t n = 0; n < NODES; n++) {
+        rng[n] = election_seed(n * 2654435761u);
+    }
+    memset(per_round, 0, sizeof(per_round));
+
+    for (uint32_t epoch = 0; epoch < EPOCHS; epoch++) {
+        memset(elected, 0, sizeof(elected));
+
+        for (uint16_t r = 0; r < NUMBER_OF_ROUNDS; r++) {
+            for (uint32_t n = 0; n < NODES; n++) {
+                if (elected[n] == 0 && election_random(&rng[n]) < election_round_threshold(r)) {
+                    elected[n] = 1;
+                    per_round[r]++;
+                }
+            }
+        }
+
+        // node not elected earlier is certain in last round.
+        for (uint32_t n = 0; n < NODES; n++) {
+            CHECK(elected[n] == 1);
+        }
+    }
+
+    // every round elects 1/N of nodes, within 5 %.
+    for (uint16_t r = 0; r < NUMBER_OF_ROUNDS; r++) {
+        double share = (double)per_round[r] / EPOCHS / NODES * NUMBER_OF_ROUNDS;
+
+        CHECK(share > 0.95 && share < 1.05);
+    }
+}
+
+int main(void)
+{
+    test_table();
+    test_random();
+    test_rounds();
+
+    return CHECK_RESULT();
+}
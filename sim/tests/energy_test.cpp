@@ -0,0 +1,113 @@
+/** @file energy_test.cpp
+ *  @brief
+ *
+ *  Host test of energy accounting: every state is charged
+ *  its current for time spent in it, also when micros()
+ *  wraps, charge adds up over rounds, and battery level
+ *  and its running average stay in range.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "check.h"
+#include "energy.h"
+
+static void test_states(void)
+{
+    energy_s energy;
+
+    // 100 ms cpu, 200 ms scan, 50 ms tx, then deep sleep.
+    energy_init(&energy, 0);
+    energy_enter(&energy, ENERGY_SCAN, 100000);
+    energy_enter(&energy, ENERGY_TX, 300000);
+    energy_enter(&energy, ENERGY_SLEEP, 350000);
+
+    CHECK(energy.state == ENERGY_SLEEP);
+    CHECK(energy.used_uas == (uint64_t)CURRENT_CPU_UA / 10 + CURRENT_SCAN_UA / 5 + CURRENT_TX_UA / 20);
+
+    // 10 s of deep sleep, charged without leaving state.
+    energy_charge(&energy, ENERGY_SLEEP, 10000000);
+    CHECK(energy.used_uas == (uint64_t)CURRENT_CPU_UA / 10 + CURRENT_SCAN_UA / 5 + CURRENT_TX_UA / 20 +
+                             CURRENT_SLEEP_UA * 10);
+
+    CHECK(energy_current(ENERGY_STATES) == 0);
+}
+
+static void test_wrap(void)
+{
+    energy_s energy;
+
+    // micros() wraps while node is in soft AP state.
+    energy_init(&energy, 1000);
+    energy_enter(&energy, ENERGY_AP, 0xFFFFFFFF - 499999);
+    uint64_t before = energy.used_uas;
+    energy_enter(&energy, ENERGY_CPU, 500000);
+
+    CHECK(energy.used_uas - before == CURRENT_AP_UA);
+}
+
+static void test_rounding(void)
+{
+    energy_s energy;
+
+    // 1 us at 15 mA is 0.015 uAs, a million of them add up to 15000.
+    energy_init(&energy, 0);
+    energy_charge(&energy, ENERGY_CPU, 1);
+    CHECK(energy.used_uas == 0);
+    energy_charge(&energy, ENERGY_CPU, 34);
+    CHECK(energy.used_uas == 1);
+}
+
+static void test_level(void)
+{
+    energy_s energy;
+
+    energy_init(&energy, 0);
+    CHECK(energy_left(&energy, 2000) == 2000 * UAS_PER_MAH);
+    CHECK(energy_level(&energy, 2000) == 255);
+
+    energy_init(&energy, 1000 * UAS_PER_MAH);
+    CHECK(energy_left(&energy, 2000) == 1000 * UAS_PER_MAH);
+    CHECK(energy_level(&energy, 2000) == 127);
+
+    // used more than capacity, battery is empty, not negative.
+    energy_init(&energy, 3000 * UAS_PER_MAH);
+    CHECK(energy_left(&energy, 2000) == 0);
+    CHECK(energy_level(&energy, 2000) == 0);
+    CHECK(energy_level(&energy, 0) == 0);
+}
+
+static void test_average(void)
+{
+    uint8_t average = 0;
+
+    // first level is taken as it is, then average moves a quarter of the way.
+    average = energy_average_update(average, 200);
+    CHECK(average == 200);
+    average = energy_average_update(average, 100);
+    CHECK(average == 175);
+
+    // steady level is followed to within rounding, and average never leaves range.
+    for (int i = 0; i < 40; i++) {
+        average = energy_average_update(average, 255);
+    }
+    CHECK(average >= 254);
+
+    for (int i = 0; i < 40; i++) {
+        average = energy_average_update(average, 1);
+    }
+    CHECK(average >= 1 && average <= 3);
+    CHECK(energy_average_update(1, 0) == 1);
+}
+
+int main(void)
+{
+    test_states();
+    test_wrap();
+    test_rounding();
+    test_level();
+    test_average();
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,111 @@
+/** @file frame_test.cpp
+ *  @brief
+ *
+ *  Host test of frame codec: fields read back as written,
+ *  corrupted and truncated frames are rejected, frames
+ *  back to back are counted up to first invalid one, uplink
+ *  is split in datagrams of whole frames, and raw uplink
+ *  datagram gives back its valid frames.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "check.h"
+#include "frame.h"
+
+static const uint8_t mac[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x01, 0x02, 0x03};
+
+static void test_round_trip(void)
+{
+    uint8_t frame[FRAME_SIZE];
+
+    CHECK(frame_encode(frame, mac, 1023, 6, 255) == FRAME_SIZE);
+    CHECK(frame_is_valid(frame, FRAME_SIZE));
+    CHECK(memcmp(frame_mac(frame), mac, FRAME_MAC_SIZE) == 0);
+    CHECK(frame_adc_value(frame) == 1023);
+    CHECK(frame_round(frame) == 6);
+    CHECK(frame_seq(frame) == 255);
+}
+
+static void test_crc_reject(void)
+{
+    uint8_t frame[FRAME_SIZE];
+
+    frame_encode(frame, mac, 512, 3, 7);
+
+    // every single bit error is caught by CRC-8.
+    for (size_t i = 0; i < FRAME_SIZE; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            frame[i] ^= 1 << bit;
+            CHECK(frame_is_valid(frame, FRAME_SIZE) == false);
+            frame[i] ^= 1 << bit;
+        }
+    }
+    CHECK(frame_is_valid(frame, FRAME_SIZE));
+    CHECK(frame_is_valid(frame, FRAME_SIZE - 1) == false);
+}
+
+static void test_count(void)
+{
+    uint8_t buf[3 * FRAME_SIZE + 5];
+
+    for (uint8_t i = 0; i < 3; i++) {
+        frame_encode(buf + i * FRAME_SIZE, mac, 200 + i, 1, i);
+    }
+    memset(buf + 3 * FRAME_SIZE, 0, 5);
+
+    // frames back to back, trailing bytes which are not whole frame are ignored.
+    CHECK(frame_count(buf, sizeof(buf)) == 3);
+    CHECK(frame_count(buf, 3 * FRAME_SIZE - 1) == 2);
+    CHECK(frame_count(buf, 0) == 0);
+
+    // counting stops at first invalid frame.
+    buf[FRAME_SIZE + 6] ^= 0x01;
+    CHECK(frame_count(buf, sizeof(buf)) == 1);
+}
+
+static void test_fragments(void)
+{
+    // uplink is split in datagrams of whole frames.
+    CHECK(uplink_fragments(0) == 0);
+    CHECK(uplink_fragments(1) == 1);
+    CHECK(uplink_fragments(UPLINK_FRAMES) == 1);
+    CHECK(uplink_fragments(UPLINK_FRAMES + 1) == 2);
+    CHECK(UPLINK_HEADER_SIZE + UPLINK_FRAMES * FRAME_SIZE <= UPLINK_DATAGRAM_SIZE);
+}
+
+static void test_raw_uplink(void)
+{
+    uint8_t buf[UPLINK_HEADER_SIZE + 3 * FRAME_SIZE];
+    size_t count = 0;
+
+    uplink_encode_header(buf, 0, 1, 3, UPLINK_FRAMES_RAW);
+    for (uint8_t i = 0; i < 3; i++) {
+        frame_encode(buf + UPLINK_HEADER_SIZE + i * FRAME_SIZE, mac, 100 + i, i, i);
+    }
+
+    const uint8_t* frames = uplink_frames(buf, sizeof(buf), &count);
+
+    CHECK(frames != NULL && count == 3);
+    CHECK(frames != NULL && frame_adc_value(frames + 2 * FRAME_SIZE) == 102);
+
+    // frames from corrupted one on are dropped.
+    buf[UPLINK_HEADER_SIZE + FRAME_SIZE + 4] ^= 0x10;
+    CHECK(uplink_frames(buf, sizeof(buf), &count) != NULL && count == 1);
+
+    buf[3] = UPLINK_DELTA;
+    CHECK(uplink_frames(buf, sizeof(buf), &count) == NULL);
+}
+
+int main(void)
+{
+    test_round_trip();
+    test_crc_reject();
+    test_count();
+    test_fragments();
+    test_raw_uplink();
+
+    return CHECK_RESULT();
+}
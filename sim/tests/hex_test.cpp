@@ -0,0 +1,98 @@
+/** @file hex_test.cpp
+ *  @brief
+ *
+ *  Host test of hex digit checks: SWAR and table checks
+ *  agree with isxdigit() for every byte value at every
+ *  position, for lengths below, at and above word size,
+ *  and at every alignment of string.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <ctype.h>
+#include <string.h>
+#include "check.h"
+#include "hex.h"
+
+/** Longest string checked, three words.*/
+#define MAX_LEN                 24
+
+/** Alignments of string in buffer.*/
+#define ALIGNMENTS              8
+
+static bool hex_is_valid_ref(const char* txt, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (!isxdigit((uint8_t)txt[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void test_bytes(void)
+{
+    static const char digits[] = "0123456789abcdefABCDEF";
+    char buffer[ALIGNMENTS + MAX_LEN + 1];
+    uint32_t mismatches = 0;
+
+    for (size_t align = 0; align < ALIGNMENTS; align++) {
+        char* txt = buffer + align;
+
+        for (size_t len = 0; len <= MAX_LEN; len++) {
+            for (size_t i = 0; i < len; i++) {
+                txt[i] = digits[(i + len) % (sizeof(digits) - 1)];
+            }
+            // byte past end is not hex, check must not read it.
+            txt[len] = 'x';
+
+            mismatches += hex_is_valid(txt, len) != true;
+            mismatches += hex_is_valid_table(txt, len) != true;
+
+            // every byte value at every position, rest of string valid.
+            for (size_t pos = 0; pos < len; pos++) {
+                char saved = txt[pos];
+
+                for (int b = 0; b < 256; b++) {
+                    bool ref;
+
+                    txt[pos] = (char)b;
+                    ref = hex_is_valid_ref(txt, len);
+                    mismatches += hex_is_valid(txt, len) != ref;
+                    mismatches += hex_is_valid_table(txt, len) != ref;
+                }
+                txt[pos] = saved;
+            }
+        }
+    }
+
+    CHECK(mismatches == 0);
+}
+
+static void test_neighbours(void)
+{
+    // bytes next to ranges, and bytes whose carry could reach next lane.
+    static const char* bad[] = {
+        "0123456789a/", "0123456789a:", "0123456789a@", "0123456789aG",
+        "0123456789a`", "0123456789ag", "\xff""123456789abc", "0\x80""23456789abc",
+        "01234567\xb0""9ab", "0123456789\xc1""b", "0123456789 b", "012345678\x10""ab"
+    };
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        CHECK(hex_is_valid(bad[i], strlen(bad[i])) == false);
+        CHECK(hex_is_valid_table(bad[i], strlen(bad[i])) == false);
+    }
+
+    CHECK(hex_is_valid("5CCF7F00012A", 12) == true);
+    CHECK(hex_is_valid("5ccf7f00012a", 12) == true);
+}
+
+int main(void)
+{
+    test_bytes();
+    test_neighbours();
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,119 @@
+/** @file relay_test.cpp
+ *  @brief
+ *
+ *  Host test of multi-hop forwarding: relay header is read
+ *  back and damaged one rejected, relays over hop limit or
+ *  of own uplink are dropped, forwarding nodes are kept
+ *  once each, and level in SSID of cluster head is read
+ *  and passed on.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "check.h"
+#include "relay.h"
+
+static const uint8_t own[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x00, 0x00, 0x01};
+static const uint8_t far[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0xAB, 0xCD, 0xEF};
+
+static size_t relayed(uint8_t* buf, uint8_t hops, const uint8_t* mac)
+{
+    size_t len = relay_encode_header(buf, hops, mac);
+
+    return len + uplink_encode_header(buf + len, 0, 1, 0, UPLINK_FRAMES_RAW);
+}
+
+static void test_header(void)
+{
+    uint8_t buf[RELAY_DATAGRAM_SIZE + 1];
+    size_t len = relayed(buf, 2, far);
+
+    CHECK(len == RELAY_HEADER_SIZE + UPLINK_HEADER_SIZE);
+    CHECK(relay_is_valid(buf, len));
+    CHECK(relay_hops(buf) == 2);
+    CHECK(memcmp(relay_mac(buf), far, FRAME_MAC_SIZE) == 0);
+
+    // uplink header has to follow, and datagram fit uplink size.
+    CHECK(relay_is_valid(buf, RELAY_HEADER_SIZE + UPLINK_HEADER_SIZE - 1) == false);
+    CHECK(relay_is_valid(buf, RELAY_DATAGRAM_SIZE) == true);
+    CHECK(relay_is_valid(buf, RELAY_DATAGRAM_SIZE + 1) == false);
+
+    for (size_t i = 0; i < RELAY_HEADER_SIZE; i++) {
+        buf[i] ^= 0x20;
+        CHECK(relay_is_valid(buf, len) == false);
+        buf[i] ^= 0x20;
+    }
+
+    // no hop made is not relay.
+    relayed(buf, 0, far);
+    CHECK(relay_is_valid(buf, len) == false);
+}
+
+static void test_accept(void)
+{
+    uint8_t buf[RELAY_DATAGRAM_SIZE];
+    relay_s relay;
+
+    relay_init(&relay);
+
+    relayed(buf, MULTI_HOP_MAX_HOPS + 1, far);
+    CHECK(relay_accept(&relay, buf, own) == false);
+    relayed(buf, 1, own);
+    CHECK(relay_accept(&relay, buf, own) == false);
+    CHECK(relay.dropped == 2 && relay.count == 0);
+
+    // one forwarding node sends several datagrams, and is kept once.
+    relayed(buf, 1, far);
+    CHECK(relay_accept(&relay, buf, own) == true);
+    relayed(buf, MULTI_HOP_MAX_HOPS, far);
+    CHECK(relay_accept(&relay, buf, own) == true);
+    CHECK(relay.count == 1 && relay.datagrams == 2);
+    CHECK(relay.hops == MULTI_HOP_MAX_HOPS);
+
+    // more forwarding nodes than soft AP takes are merged, not remembered.
+    for (uint8_t i = 0; i < RELAY_SOURCES + 2; i++) {
+        uint8_t mac[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x10, 0x00, i};
+
+        relayed(buf, 1, mac);
+        CHECK(relay_accept(&relay, buf, own) == true);
+    }
+    CHECK(relay.count == RELAY_SOURCES);
+}
+
+static void test_ssid(void)
+{
+    uint8_t buf[RELAY_DATAGRAM_SIZE];
+    relay_s relay;
+
+    relay_init(&relay);
+    relayed(buf, 1, far);
+    relay_accept(&relay, buf, own);
+
+    // cluster head does not forward to itself nor to node which forwarded to it.
+    CHECK(relay_is_source(&relay, "5CCF7F0000012", own) == true);
+    CHECK(relay_is_source(&relay, "5CCF7FABCDEF1", own) == true);
+    CHECK(relay_is_source(&relay, "5CCF7FABCDEE1", own) == false);
+    CHECK(relay_is_source(&relay, "5CCF7FABCD", own) == false);
+
+    CHECK(relay_level("5CCF7FABCDEF0") == 0);
+    CHECK(relay_level("5CCF7FABCDEF9") == 9);
+    CHECK(relay_level("5CCF7FABCDEFE") == 14);
+    CHECK(relay_level("5CCF7FABCDEF") == RELAY_NO_ROUTE);
+    CHECK(relay_level("5CCF7FABCDEFx") == RELAY_NO_ROUTE);
+
+    CHECK(relay_next_level(0) == 1);
+    CHECK(relay_next_level(MULTI_HOP_MAX_HOPS - 1) == MULTI_HOP_MAX_HOPS);
+    CHECK(relay_next_level(MULTI_HOP_MAX_HOPS) == RELAY_NO_ROUTE);
+    CHECK(relay_next_level(RELAY_NO_ROUTE) == RELAY_NO_ROUTE);
+}
+
+int main(void)
+{
+    test_header();
+    test_accept();
+    test_ssid();
+
+    return CHECK_RESULT();
+}
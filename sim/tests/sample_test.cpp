@@ -0,0 +1,104 @@
+/** @file sample_test.cpp
+ *  @brief
+ *
+ *  Host test of reading acquisition: ring keeps newest
+ *  SAMPLE_COUNT samples in order, reading of constant
+ *  input is that input in SAMPLE_BITS bits also when ring
+ *  is not full, decimation gives extra bits, and median
+ *  filter removes single sample spike. Built with default
+ *  options and with median filter and extra bits.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "check.h"
+#include "sample.h"
+
+static void fill(sample_ring_s* ring, uint16_t value, uint8_t count)
+{
+    sample_clear(ring);
+
+    for (uint8_t i = 0; i < count; i++) {
+        sample_push(ring, value);
+    }
+}
+
+static void test_ring(void)
+{
+    sample_ring_s ring;
+
+    sample_clear(&ring);
+    CHECK(ring.count == 0);
+    CHECK(sample_reading(&ring) == 0);
+
+    // three samples more than ring holds, oldest ones are overwritten.
+    for (uint16_t i = 0; i < SAMPLE_COUNT + 3; i++) {
+        sample_push(&ring, i);
+    }
+    CHECK(ring.count == SAMPLE_COUNT);
+    for (uint8_t i = 0; i < SAMPLE_COUNT; i++) {
+        CHECK(sample_at(&ring, i) == i + 3);
+    }
+}
+
+static void test_constant(void)
+{
+    sample_ring_s ring;
+    static const uint16_t values[] = {0, 1, 512, 1023};
+
+    for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+        fill(&ring, values[v], SAMPLE_COUNT);
+        CHECK(sample_reading(&ring) == values[v] << SAMPLE_EXTRA_BITS);
+
+        // node which woke late took fewer samples, reading is scaled for them.
+        fill(&ring, values[v], SAMPLE_COUNT / 2 + 1);
+        CHECK(sample_reading(&ring) == values[v] << SAMPLE_EXTRA_BITS);
+    }
+
+    fill(&ring, 1023, SAMPLE_COUNT);
+    CHECK(sample_reading(&ring) < 1u << SAMPLE_BITS);
+}
+
+static void test_decimation(void)
+{
+    sample_ring_s ring;
+
+    // input between two ADC steps, mean is 512.5.
+    sample_clear(&ring);
+    for (uint8_t i = 0; i < SAMPLE_COUNT; i++) {
+        sample_push(&ring, 512 + (i & 1));
+    }
+
+#if SAMPLE_EXTRA_BITS == 0
+    CHECK(sample_reading(&ring) == 513);
+#else
+    CHECK(sample_reading(&ring) == (1025u << (SAMPLE_EXTRA_BITS - 1)));
+#endif
+}
+
+static void test_spike(void)
+{
+    sample_ring_s ring;
+
+    fill(&ring, 300, SAMPLE_COUNT);
+    sample_push(&ring, 300);
+    sample_push(&ring, 1023);
+    sample_push(&ring, 300);
+
+#if SAMPLE_MEDIAN
+    CHECK(sample_reading(&ring) == 300u << SAMPLE_EXTRA_BITS);
+#else
+    CHECK(sample_reading(&ring) > 300u << SAMPLE_EXTRA_BITS);
+#endif
+}
+
+int main(void)
+{
+    test_ring();
+    test_constant();
+    test_decimation();
+    test_spike();
+
+    return CHECK_RESULT();
+}
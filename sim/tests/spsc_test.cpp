@@ -0,0 +1,156 @@
+/** @file spsc_test.cpp
+ *  @brief
+ *
+ *  Host test of datagram queue of base station: reserved
+ *  and peeked slots never wrap around or pass the other
+ *  side, producer sees slots consumer released although
+ *  queue never looked full, and datagrams cross between
+ *  two threads whole and in order.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include <thread>
+#include "check.h"
+#include "spsc.h"
+
+/** Slots of test queue.*/
+#define SLOTS                   8
+
+/** Datagrams sent between threads.*/
+#define DATAGRAMS               20000
+
+static void test_bounds(void)
+{
+    spsc_s queue;
+    base_datagram_s* first;
+    base_datagram_s* read;
+
+    CHECK(spsc_init(&queue, SLOTS - 1));
+    CHECK(queue.mask == SLOTS - 1);
+
+    CHECK(spsc_peek(&queue, &read, SLOTS) == 0);
+    CHECK(spsc_reserve(&queue, &first, 3) == 3);
+    CHECK(first == &queue.slots[0]);
+    spsc_publish(&queue, 3);
+
+    CHECK(spsc_peek(&queue, &read, SLOTS) == 3);
+    CHECK(read == &queue.slots[0]);
+    spsc_release(&queue, 3);
+
+    // free slots from 3 up to end of ring only.
+    CHECK(spsc_reserve(&queue, &first, SLOTS) == SLOTS - 3);
+    CHECK(first == &queue.slots[3]);
+    spsc_publish(&queue, SLOTS - 3);
+
+    CHECK(spsc_reserve(&queue, &first, SLOTS) == 3);
+    CHECK(first == &queue.slots[0]);
+    spsc_publish(&queue, 3);
+
+    // queue is full, consumer reads up to end of ring, then from start.
+    CHECK(spsc_reserve(&queue, &first, SLOTS) == 0);
+    CHECK(spsc_peek(&queue, &read, SLOTS) == SLOTS - 3);
+    CHECK(read == &queue.slots[3]);
+    spsc_release(&queue, SLOTS - 3);
+    CHECK(spsc_peek(&queue, &read, 2) == 2);
+    CHECK(read == &queue.slots[0]);
+
+    spsc_free(&queue);
+}
+
+static void test_refresh(void)
+{
+    spsc_s queue;
+    base_datagram_s* first;
+    base_datagram_s* read;
+
+    CHECK(spsc_init(&queue, SLOTS));
+
+    CHECK(spsc_reserve(&queue, &first, SLOTS) == SLOTS);
+    spsc_publish(&queue, SLOTS);
+
+    // producer sees two slots released when queue is full.
+    CHECK(spsc_peek(&queue, &read, 2) == 2);
+    spsc_release(&queue, 2);
+    CHECK(spsc_reserve(&queue, &first, SLOTS) == 2);
+
+    // consumer released the rest, producer asks for more than it last saw.
+    CHECK(spsc_peek(&queue, &read, SLOTS) == SLOTS - 2);
+    spsc_release(&queue, SLOTS - 2);
+    CHECK(spsc_reserve(&queue, &first, SLOTS) == SLOTS);
+
+    // consumer which saw one slot sees the ones published after it.
+    spsc_publish(&queue, 1);
+    CHECK(spsc_peek(&queue, &read, SLOTS) == 1);
+    spsc_publish(&queue, 4);
+    CHECK(spsc_peek(&queue, &read, SLOTS) == 5);
+
+    spsc_free(&queue);
+}
+
+static void test_threads(void)
+{
+    spsc_s queue;
+    uint32_t received = 0;
+    bool in_order = true;
+
+    CHECK(spsc_init(&queue, SLOTS));
+
+    std::thread producer([&queue]() {
+        uint32_t sent = 0;
+
+        while (sent < DATAGRAMS) {
+            base_datagram_s* first;
+            uint32_t n = spsc_reserve(&queue, &first, 3);
+
+            if (n == 0) {
+                std::this_thread::yield();
+            }
+
+            for (uint32_t i = 0; i < n && sent + i < DATAGRAMS; i++) {
+                first[i].len = sizeof(uint32_t);
+                first[i].source = sent + i;
+                memcpy(first[i].data, &first[i].source, sizeof(uint32_t));
+            }
+            n = sent + n > DATAGRAMS ? DATAGRAMS - sent : n;
+            spsc_publish(&queue, n);
+            sent += n;
+        }
+    });
+
+    while (received < DATAGRAMS) {
+        base_datagram_s* first;
+        uint32_t n = spsc_peek(&queue, &first, 5);
+
+        if (n == 0) {
+            std::this_thread::yield();
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t value;
+
+            memcpy(&value, first[i].data, sizeof(value));
+            in_order &= first[i].len == sizeof(uint32_t) && first[i].source == received + i &&
+                        value == received + i;
+        }
+        spsc_release(&queue, n);
+        received += n;
+    }
+
+    producer.join();
+    CHECK(in_order);
+    CHECK(received == DATAGRAMS);
+
+    spsc_free(&queue);
+}
+
+int main(void)
+{
+    test_bounds();
+    test_refresh();
+    test_threads();
+
+    return CHECK_RESULT();
+}
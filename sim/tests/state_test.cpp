@@ -0,0 +1,110 @@
+/** @file state_test.cpp
+ *  @brief
+ *
+ *  Host test of round state: zeroed or corrupted RTC
+ *  memory is not valid and asks for flash backup, fields
+ *  written back are read back, and flash is written only
+ *  on checkpoint rounds afterwards.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "check.h"
+#include "state.h"
+
+static void test_cold(void)
+{
+    round_state_s state;
+    uint16_t round = 7;
+    uint8_t ch_enable = 3;
+    sync_s clock;
+
+    // RTC memory after power up.
+    memset(&state, 0, sizeof(state));
+    CHECK(state_is_valid(&state) == false);
+    CHECK(state_read(&state, &round, &ch_enable) == false);
+    CHECK(round == 7 && ch_enable == 3);
+
+    CHECK(state_energy(&state) == 0);
+    CHECK(state_rng(&state) == 0);
+    CHECK(state_seq(&state) == 0);
+    CHECK(state_set_energy(&state, 1000) == false);
+    CHECK(state_set_rng(&state, 1) == false);
+    CHECK(state_set_seq(&state, 1) == false);
+
+    memset(&clock, 0xFF, sizeof(clock));
+    state_clock(&state, &clock);
+    CHECK(clock.offset_us == 0 && clock.skew_ppb == 0);
+
+    // cold boot is always backed up, whatever round it is.
+    CHECK(state_write(&state, STATE_CHECKPOINT_ROUNDS + 1, 1) == true);
+    CHECK(state_read(&state, &round, &ch_enable) == true);
+    CHECK(round == STATE_CHECKPOINT_ROUNDS + 1 && ch_enable == 1);
+}
+
+static void test_fields(void)
+{
+    round_state_s state;
+    sync_s clock;
+    sync_s read;
+
+    memset(&state, 0, sizeof(state));
+    state_write(&state, 0, 1);
+
+    memset(&clock, 0, sizeof(clock));
+    clock.offset_us = -1234;
+    clock.skew_ppb = 567;
+
+    CHECK(state_set_energy(&state, 0x123456789ULL) == true);
+    CHECK(state_set_clock(&state, &clock) == true);
+    CHECK(state_set_rng(&state, 0xCAFEBABE) == true);
+    CHECK(state_set_seq(&state, 255) == true);
+
+    CHECK(state_is_valid(&state) == true);
+    CHECK(state_energy(&state) == 0x123456789ULL);
+    CHECK(state_rng(&state) == 0xCAFEBABE);
+    CHECK(state_seq(&state) == 255);
+    state_clock(&state, &read);
+    CHECK(read.offset_us == -1234 && read.skew_ppb == 567);
+
+    // flipped bit anywhere past CRC makes whole state invalid.
+    for (size_t i = sizeof(state.crc); i < sizeof(state); i++) {
+        round_state_s bad;
+
+        memcpy(&bad, &state, sizeof(state));
+        ((uint8_t*)&bad)[i] ^= 0x10;
+        CHECK(state_is_valid(&bad) == false);
+    }
+
+    state.rng ^= 1;
+    CHECK(state_is_valid(&state) == false);
+    CHECK(state_rng(&state) == 0);
+}
+
+static void test_checkpoint(void)
+{
+    round_state_s state;
+    uint32_t backups = 0;
+
+    memset(&state, 0, sizeof(state));
+    state_write(&state, 0, 1);
+
+    for (uint16_t round = 1; round <= 4 * STATE_CHECKPOINT_ROUNDS; round++) {
+        bool backup = state_write(&state, round, round & 1);
+
+        CHECK(backup == (round % STATE_CHECKPOINT_ROUNDS == 0));
+        backups += backup;
+    }
+    CHECK(backups == 4);
+}
+
+int main(void)
+{
+    test_cold();
+    test_fields();
+    test_checkpoint();
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,103 @@
+/** @file sync_test.cpp
+ *  @brief
+ *
+ *  Host test of round synchronization: sync reply is read
+ *  back with MAC of station it is for, corrupted one and
+ *  station frame are rejected, node which woke late
+ *  (negative offset) sleeps shorter, but never 0, and the
+ *  one which woke early longer, and skew estimate follows
+ *  RTC rate while phase error stays small.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "check.h"
+#include "sync.h"
+#include "frame.h"
+
+static const uint8_t mac[FRAME_MAC_SIZE] = {0x5C, 0xCF, 0x7F, 0x00, 0x00, 0x2A};
+
+static void test_reply(void)
+{
+    uint8_t reply[SYNC_SIZE];
+
+    CHECK(sync_encode(reply, mac, 0xDEADBEEF) == SYNC_SIZE);
+    CHECK(sync_is_valid(reply, SYNC_SIZE));
+    CHECK(sync_elapsed(reply) == 0xDEADBEEF);
+    CHECK(memcmp(sync_mac(reply), mac, FRAME_MAC_SIZE) == 0);
+    CHECK(sync_is_valid(reply, SYNC_SIZE - 1) == false);
+
+    for (size_t i = 0; i < SYNC_SIZE; i++) {
+        reply[i] ^= 0x01;
+        CHECK(sync_is_valid(reply, SYNC_SIZE) == false);
+        reply[i] ^= 0x01;
+    }
+}
+
+static void test_frame(void)
+{
+    uint8_t datagram[SYNC_SIZE + FRAME_SIZE];
+
+    // station frame, or frame with byte more, is not taken for reply.
+    frame_encode(datagram, mac, 1000, 3, 7);
+    CHECK(sync_is_valid(datagram, FRAME_SIZE) == false);
+
+    datagram[FRAME_SIZE] = 0;
+    CHECK(sync_is_valid(datagram, FRAME_SIZE + 1) == false);
+
+    // reply is not taken for station frame or held readings either.
+    CHECK(SYNC_SIZE % FRAME_SIZE != 0);
+}
+
+static void test_offset(void)
+{
+    sync_s clock;
+
+    // node woke 20 ms after cluster head, next sleep is shorter.
+    memset(&clock, 0, sizeof(clock));
+    sync_update(&clock, -20000);
+    CHECK(sync_sleep(&clock, 10000000) == 10000000 - 20000);
+    CHECK(clock.offset_us == 0);
+    CHECK(sync_sleep(&clock, 10000000) == 10000000);
+
+    // node woke 20 ms before cluster head, next sleep is longer.
+    memset(&clock, 0, sizeof(clock));
+    sync_update(&clock, 20000);
+    CHECK(sync_sleep(&clock, 10000000) == 10000000 + 20000);
+
+    // node woke later than rest of round, it still wakes up.
+    memset(&clock, 0, sizeof(clock));
+    sync_update(&clock, -15000000);
+    CHECK(sync_sleep(&clock, 10000000) == SYNC_MIN_SLEEP_US);
+}
+
+static void test_skew(void)
+{
+    sync_s clock;
+    int64_t late = 0;
+
+    memset(&clock, 0, sizeof(clock));
+    sync_update(&clock, 0);
+
+    // RTC sleeps 1000 ppm longer than asked, cluster head sleeps exactly.
+    for (int i = 0; i < 40; i++) {
+        uint64_t sleep = sync_sleep(&clock, 10000000);
+
+        late += (int64_t)(sleep + sleep / 1000) - 10000000;
+        sync_update(&clock, (int32_t)-late);
+    }
+    CHECK(clock.skew_ppb > 900000 && clock.skew_ppb < 1000000);
+    CHECK(late > -1000 && late < 1000);
+}
+
+int main(void)
+{
+    test_reply();
+    test_frame();
+    test_offset();
+    test_skew();
+
+    return CHECK_RESULT();
+}
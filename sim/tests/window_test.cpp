@@ -0,0 +1,93 @@
+/** @file window_test.cpp
+ *  @brief
+ *
+ *  Host test of adaptive timeouts: empty histogram gives
+ *  maximum, timeout covers percentile of observed times
+ *  plus margin and stays within bounds, times past maximum
+ *  grow window back, and old rounds fade out.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "check.h"
+#include "window.h"
+
+/** Time covered by test histogram, 1000 ms per bucket.*/
+#define MAX_MS                  (WINDOW_BUCKETS * 1000)
+
+static void test_bounds(void)
+{
+    window_s window;
+
+    memset(&window, 0, sizeof(window));
+    CHECK(window_count(&window) == 0);
+    CHECK(window_timeout(&window, 500, MAX_MS, 200) == MAX_MS);
+
+    // all arrivals in first bucket, timeout is its upper edge plus margin.
+    for (int i = 0; i < 10; i++) {
+        window_add(&window, 300, MAX_MS);
+    }
+    CHECK(window_timeout(&window, 500, MAX_MS, 200) == 1200);
+
+    // kept above minimum, and below maximum whatever margin is.
+    CHECK(window_timeout(&window, 5000, MAX_MS, 200) == 5000);
+    CHECK(window_timeout(&window, 500, MAX_MS, 2 * MAX_MS) == MAX_MS);
+
+    // time past maximum goes to last bucket.
+    memset(&window, 0, sizeof(window));
+    window_add(&window, 10 * MAX_MS, MAX_MS);
+    CHECK(window.counts[WINDOW_BUCKETS - 1] == 1);
+    CHECK(window_timeout(&window, 500, MAX_MS, 0) == MAX_MS);
+}
+
+static void test_percentile(void)
+{
+    window_s window;
+
+    // 63 quick arrivals and one slow, 99th percentile of 64 still covers slow one.
+    memset(&window, 0, sizeof(window));
+    for (int i = 0; i < 63; i++) {
+        window_add(&window, 1500, MAX_MS);
+    }
+    window_add(&window, 7500, MAX_MS);
+
+#if WINDOW_PERCENTILE == 99
+    CHECK(window_timeout(&window, 0, MAX_MS, 0) == 8000);
+#endif
+
+    // station which associated and never reported grows window to maximum.
+    window_add(&window, MAX_MS, MAX_MS);
+    window_add(&window, MAX_MS, MAX_MS);
+    CHECK(window_timeout(&window, 0, MAX_MS, 0) == MAX_MS);
+}
+
+static void test_history(void)
+{
+    window_s window;
+
+    memset(&window, 0, sizeof(window));
+    for (int i = 0; i < WINDOW_HISTORY; i++) {
+        window_add(&window, MAX_MS - 1, MAX_MS);
+    }
+    CHECK(window_count(&window) == WINDOW_HISTORY);
+    CHECK(window_timeout(&window, 0, MAX_MS, 0) == MAX_MS);
+
+    // network became quick, old slow rounds fade out and window shrinks.
+    for (int i = 0; i < 20 * WINDOW_HISTORY; i++) {
+        window_add(&window, 200, MAX_MS);
+        CHECK(window_count(&window) <= WINDOW_HISTORY);
+    }
+    CHECK(window.counts[WINDOW_BUCKETS - 1] == 0);
+    CHECK(window_timeout(&window, 0, MAX_MS, 0) == 1000);
+}
+
+int main(void)
+{
+    test_bounds();
+    test_percentile();
+    test_history();
+
+    return CHECK_RESULT();
+}
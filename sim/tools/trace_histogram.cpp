@@ -0,0 +1,210 @@
+/** @file trace_histogram.cpp
+ *  @brief
+ *
+ *  Host tool which reads trace lines of many nodes
+ *  (serial captures or --trace-log of simulator) and
+ *  prints latency of every phase across the fleet,
+ *  separately for cluster heads and stations.
+ *
+ *  Lines which do not contain trace are skipped, so
+ *  serial output with debug messages can be given as is.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "trace.h"
+
+/** Number of histogram buckets, bucket i holds durations in [2^(i-1), 2^i) us.*/
+#define BUCKETS                 32
+
+/** Width of longest histogram bar.*/
+#define BAR_WIDTH               40
+
+/** Roles of node, index of samples.*/
+#define ROLE_CH                 0
+#define ROLE_STATION            1
+#define ROLES                   2
+
+/**
+ * Durations of one phase, in us.
+*/
+typedef struct
+{
+    std::vector<uint32_t> samples;      /**< Duration of every occurrence.*/
+} phase_samples_s;
+
+static phase_samples_s Samples[ROLES][TRACE_PHASES + 1];
+
+static void usage(const char* name)
+{
+    printf("Usage: %s [FILE...]\n"
+           "Reads trace lines from files (or standard input) and prints\n"
+           "per-phase latency histograms. Last phase, total, is sum of all\n"
+           "phases of one wake up.\n", name);
+}
+
+static bool parse_line(const char* line)
+{
+    const char* p = strstr(line, TRACE_PREFIX " ");
+    char mac[13];
+    unsigned round;
+    char role;
+    int n = 0;
+    uint32_t total = 0;
+    int r;
+
+    if (p == NULL || sscanf(p, TRACE_PREFIX " %12s %u %c%n", mac, &round, &role, &n) != 3) {
+        return false;
+    }
+    if (role != 'C' && role != 'S') {
+        return false;
+    }
+    r = role == 'C' ? ROLE_CH : ROLE_STATION;
+    p += n;
+
+    while (*p == ' ') {
+        const char* name = p + 1;
+        const char* eq = strchr(name, '=');
+        char* end;
+        unsigned long us;
+        uint8_t phase;
+
+        if (eq == NULL) {
+            break;
+        }
+        us = strtoul(eq + 1, &end, 10);
+        if (end == eq + 1) {
+            break;
+        }
+        phase = trace_phase_by_name(name, eq - name);
+        if (phase < TRACE_PHASES) {
+            Samples[r][phase].samples.push_back(us);
+            total += us;
+        }
+        p = end;
+    }
+
+    Samples[r][TRACE_PHASES].samples.push_back(total);
+
+    return true;
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, uint32_t percent)
+{
+    size_t index = (sorted.size() - 1) * percent / 100;
+
+    return sorted[index];
+}
+
+static uint8_t bucket(uint32_t us)
+{
+    uint8_t b = 0;
+
+    while (us != 0 && b < BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+
+    return b;
+}
+
+static void print_phase(const char* name, std::vector<uint32_t>* samples)
+{
+    uint32_t counts[BUCKETS] = {0};
+    uint32_t most = 0;
+    uint64_t sum = 0;
+    uint8_t lowest = BUCKETS;
+    uint8_t highest = 0;
+
+    if (samples->empty()) {
+        return;
+    }
+
+    std::sort(samples->begin(), samples->end());
+
+    for (size_t i = 0; i < samples->size(); i++) {
+        uint8_t b = bucket((*samples)[i]);
+
+        counts[b]++;
+        sum += (*samples)[i];
+        lowest = std::min(lowest, b);
+        highest = std::max(highest, b);
+    }
+    for (uint8_t b = lowest; b <= highest; b++) {
+        most = std::max(most, counts[b]);
+    }
+
+    printf("  %-10s n = %zu, mean = %.1f ms, p50 = %.1f ms, p90 = %.1f ms, p99 = %.1f ms, max = %.1f ms\n",
+           name, samples->size(), (double)sum / samples->size() / 1000,
+           percentile(*samples, 50) / 1000.0, percentile(*samples, 90) / 1000.0,
+           percentile(*samples, 99) / 1000.0, samples->back() / 1000.0);
+
+    for (uint8_t b = lowest; b <= highest; b++) {
+        uint32_t from = b == 0 ? 0 : 1u << (b - 1);
+        int width = (uint64_t)counts[b] * BAR_WIDTH / most;
+
+        if (counts[b] == 0) {
+            continue;
+        }
+
+        printf("    %9.3f ms %8u %.*s\n", from / 1000.0, counts[b], width,
+               "########################################");
+    }
+}
+
+static void read_file(FILE* fp, uint32_t* lines)
+{
+    char line[TRACE_LINE_SIZE * 2];
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (parse_line(line)) {
+            (*lines)++;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* roles[ROLES] = {"cluster heads", "stations"};
+    uint32_t lines = 0;
+
+    if (argc > 1 && strcmp(argv[1], "--help") == 0) {
+        usage(argv[0]);
+        return 0;
+    }
+
+    if (argc == 1) {
+        read_file(stdin, &lines);
+    }
+    for (int i = 1; i < argc; i++) {
+        FILE* fp = fopen(argv[i], "r");
+
+        if (fp == NULL) {
+            fprintf(stderr, "Could not open %s to read!\n", argv[i]);
+            return 1;
+        }
+        read_file(fp, &lines);
+        fclose(fp);
+    }
+
+    printf("traces                %u\n", lines);
+
+    for (int r = 0; r < ROLES; r++) {
+        if (Samples[r][TRACE_PHASES].samples.empty()) {
+            continue;
+        }
+        printf("\n%s\n", roles[r]);
+        for (uint8_t phase = 0; phase < TRACE_PHASES; phase++) {
+            print_phase(trace_phase_name(phase), &Samples[r][phase].samples);
+        }
+        print_phase("total", &Samples[r][TRACE_PHASES].samples);
+    }
+
+    return 0;
+}
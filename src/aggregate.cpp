@@ -0,0 +1,147 @@
+/** @file aggregate.cpp
+ *  @brief
+ *
+ *  This file contains aggregation of station readings
+ *  at cluster head, and encoder and decoder of summary
+ *  record sent to base.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "aggregate.h"
+
+static void write_u16(uint8_t* buf, uint16_t value)
+{
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+}
+
+static uint16_t read_u16(const uint8_t* buf)
+{
+    return buf[0] | (buf[1] << 8);
+}
+
+void aggregate_init(aggregate_s* aggregate)
+{
+    memset(aggregate, 0, sizeof(*aggregate));
+    aggregate->min = 0xFFFF;
+}
+
+void aggregate_add(aggregate_s* aggregate, const uint8_t* frame)
+{
+    uint16_t value = frame_adc_value(frame);
+
+    aggregate->count++;
+    aggregate->sum += value;
+
+    if (value < aggregate->min) {
+        aggregate->min = value;
+    }
+    if (value > aggregate->max) {
+        aggregate->max = value;
+    }
+
+#if AGGREGATION == AGGREGATE_HISTOGRAM
+    uint32_t bin = (uint32_t)value * AGGREGATE_BINS / ADC_RANGE;
+
+    if (bin >= AGGREGATE_BINS) {
+        bin = AGGREGATE_BINS - 1;
+    }
+    aggregate->bins[bin]++;
+#endif
+}
+
+void aggregate_merge(aggregate_s* aggregate, const uint8_t* record)
+{
+    if (summary_count(record) == 0) {
+        return;
+    }
+
+    aggregate->count += summary_count(record);
+    aggregate->sum += summary_sum(record);
+
+    if (summary_min(record) < aggregate->min) {
+        aggregate->min = summary_min(record);
+    }
+    if (summary_max(record) > aggregate->max) {
+        aggregate->max = summary_max(record);
+    }
+
+#if AGGREGATION == AGGREGATE_HISTOGRAM
+    for (uint8_t i = 0; i < AGGREGATE_BINS; i++) {
+        aggregate->bins[i] += summary_bin(record, i);
+    }
+#endif
+}
+
+size_t aggregate_encode(uint8_t* buf, const aggregate_s* aggregate, const uint8_t* mac, uint8_t round)
+{
+    size_t len = SUMMARY_BINS_OFFSET;
+
+    memcpy(buf, mac, FRAME_MAC_SIZE);
+    buf[SUMMARY_ROUND_OFFSET] = round;
+    write_u16(buf + SUMMARY_COUNT_OFFSET, aggregate->count);
+    write_u16(buf + SUMMARY_MIN_OFFSET, aggregate->count ? aggregate->min : 0);
+    write_u16(buf + SUMMARY_MAX_OFFSET, aggregate->max);
+    write_u16(buf + SUMMARY_SUM_OFFSET, aggregate->sum & 0xFFFF);
+    write_u16(buf + SUMMARY_SUM_OFFSET + 2, aggregate->sum >> 16);
+
+#if AGGREGATION == AGGREGATE_HISTOGRAM
+    for (int i = 0; i < AGGREGATE_BINS; i++) {
+        write_u16(buf + len, aggregate->bins[i]);
+        len += 2;
+    }
+#endif
+
+    buf[len] = frame_crc8(buf, len);
+
+    return len + 1;
+}
+
+bool summary_is_valid(const uint8_t* buf, size_t len, uint8_t type)
+{
+    size_t size;
+
+    if (type == UPLINK_SUMMARY) {
+        size = SUMMARY_SIZE;
+    }
+    else if (type == UPLINK_HISTOGRAM) {
+        size = HISTOGRAM_SIZE;
+    }
+    else {
+        return false;
+    }
+
+    if (len < size) {
+        return false;
+    }
+
+    return frame_crc8(buf, size - 1) == buf[size - 1];
+}
+
+uint16_t summary_count(const uint8_t* record)
+{
+    return read_u16(record + SUMMARY_COUNT_OFFSET);
+}
+
+uint16_t summary_min(const uint8_t* record)
+{
+    return read_u16(record + SUMMARY_MIN_OFFSET);
+}
+
+uint16_t summary_max(const uint8_t* record)
+{
+    return read_u16(record + SUMMARY_MAX_OFFSET);
+}
+
+uint32_t summary_sum(const uint8_t* record)
+{
+    return read_u16(record + SUMMARY_SUM_OFFSET) | ((uint32_t)read_u16(record + SUMMARY_SUM_OFFSET + 2) << 16);
+}
+
+uint16_t summary_bin(const uint8_t* record, uint8_t bin)
+{
+    return read_u16(record + SUMMARY_BINS_OFFSET + 2*bin);
+}
@@ -0,0 +1,81 @@
+/** @file batch.cpp
+ *  @brief
+ *
+ *  This file contains ring buffer of readings held by
+ *  station, and frames they are sent in.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "batch.h"
+
+void batch_init(batch_s* batch)
+{
+    memset(batch, 0, sizeof(*batch));
+}
+
+void batch_add(batch_s* batch, uint16_t adc, uint8_t round, uint8_t seq)
+{
+    uint8_t tail = (batch->head + batch->count) % BATCH_CAPACITY;
+
+    batch->adc[tail] = adc;
+    batch->round[tail] = round;
+    batch->seq[tail] = seq;
+
+    if (batch->count < BATCH_CAPACITY) {
+        batch->count++;
+    }
+    else {
+        batch->head = (batch->head + 1) % BATCH_CAPACITY;
+        if (batch->overwritten < UINT8_MAX) {
+            batch->overwritten++;
+        }
+    }
+}
+
+bool batch_due(const batch_s* batch, uint16_t adc)
+{
+    uint16_t change = adc > batch->sent_adc ? adc - batch->sent_adc : batch->sent_adc - adc;
+
+    return batch->sent == 0 || batch->count >= BATCH_ROUNDS || change > BATCH_THRESHOLD;
+}
+
+size_t batch_encode(uint8_t* buf, const batch_s* batch, const uint8_t* mac)
+{
+    size_t len = 0;
+
+    for (uint8_t i = 0; i < batch->count; i++) {
+        uint8_t slot = (batch->head + i) % BATCH_CAPACITY;
+
+        len += frame_encode(buf + len, mac, batch->adc[slot], batch->round[slot], batch->seq[slot]);
+    }
+
+    return len;
+}
+
+void batch_sent(batch_s* batch, uint16_t adc)
+{
+    batch->head = 0;
+    batch->count = 0;
+    batch->sent_adc = adc;
+    batch->sent = 1;
+}
+
+size_t batch_frames(const uint8_t* buf, size_t len)
+{
+    size_t n = len / FRAME_SIZE;
+
+    if (n == 0 || n > BATCH_CAPACITY || len % FRAME_SIZE != 0 || frame_count(buf, len) != n) {
+        return 0;
+    }
+
+    for (size_t i = 1; i < n; i++) {
+        if (memcmp(frame_mac(buf + i * FRAME_SIZE), frame_mac(buf), FRAME_MAC_SIZE) != 0) {
+            return 0;
+        }
+    }
+
+    return n;
+}
@@ -0,0 +1,40 @@
+/** @file channel.cpp
+ *  @brief
+ *
+ *  This file contains channel selection of cluster
+ *  head soft AP.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "channel.h"
+
+uint32_t channel_hash(const uint8_t* mac, uint8_t round)
+{
+    uint32_t hash = 2166136261u;
+
+    // FNV-1a of MAC and round.
+    for (int i = 0; i < 6; i++) {
+        hash = (hash ^ mac[i]) * 16777619u;
+    }
+    hash = (hash ^ round) * 16777619u;
+
+    return hash;
+}
+
+uint8_t channel_select(const uint8_t* mac, uint8_t round)
+{
+    uint8_t pick = (channel_hash(mac, round) >> 16) % channel_count(CLUSTER_CHANNELS);
+
+    for (uint8_t channel = 1; channel <= 13; channel++) {
+        if ((CLUSTER_CHANNELS & (1u << channel)) != 0) {
+            if (pick == 0) {
+                return channel;
+            }
+            pick--;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,141 @@
+/** @file dedup.cpp
+ *  @brief
+ *
+ *  This file contains open addressing table which drops
+ *  frames already received from the same station.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "dedup.h"
+
+static uint32_t slot_of(const dedup_s* table, const uint8_t* mac)
+{
+    // vendor part is shared by most nodes, low bytes tell them apart.
+    uint32_t key = ((uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5]) ^
+                   ((uint32_t)mac[0] << 8 | mac[1]);
+
+    // Fibonacci hashing, top bits of product are well mixed.
+    return (key * 0x9E3779B1u) >> table->shift;
+}
+
+static uint32_t dedup_limit(const dedup_s* table)
+{
+    uint32_t capacity = table->mask + 1;
+
+    return capacity - capacity / 4;
+}
+
+uint32_t dedup_capacity(uint32_t stations)
+{
+    uint32_t capacity = 2;
+
+    while (capacity < 2 * stations && capacity < 0x80000000u) {
+        capacity <<= 1;
+    }
+
+    return capacity;
+}
+
+void dedup_init(dedup_s* table, dedup_entry_s* slots, uint32_t capacity)
+{
+    uint8_t bits = 0;
+
+    while ((1u << bits) < capacity) {
+        bits++;
+    }
+
+    table->slots = slots;
+    table->mask = capacity - 1;
+    table->shift = 32 - bits;
+    dedup_clear(table);
+}
+
+void dedup_clear(dedup_s* table)
+{
+    memset(table->slots, 0, (table->mask + 1) * sizeof(dedup_entry_s));
+    table->count = 0;
+    table->received = 0;
+    table->duplicated = 0;
+    table->late = 0;
+    table->overflow = 0;
+}
+
+dedup_result_e dedup_check(dedup_s* table, const uint8_t* frame)
+{
+    const uint8_t* mac = frame_mac(frame);
+    uint8_t round = frame_round(frame);
+    uint8_t seq = frame_seq(frame);
+    uint32_t i = slot_of(table, mac);
+    dedup_entry_s* entry = NULL;
+
+    table->received++;
+
+    for (uint32_t probes = 0; probes <= table->mask; probes++) {
+        dedup_entry_s* slot = &table->slots[i];
+
+        if (slot->used == 0 || memcmp(slot->mac, mac, FRAME_MAC_SIZE) == 0) {
+            entry = slot;
+            break;
+        }
+        i = (i + 1) & table->mask;
+    }
+
+    // probes for unknown MAC stay short only while some slots are free.
+    if (entry == NULL || (entry->used == 0 && table->count >= dedup_limit(table))) {
+        table->overflow++;
+        return DEDUP_NEW;
+    }
+
+    if (entry->used == 0) {
+        memcpy(entry->mac, mac, FRAME_MAC_SIZE);
+        entry->round = round;
+        entry->seq = seq;
+        entry->used = 1;
+        entry->received = 1;
+        table->count++;
+        return DEDUP_NEW;
+    }
+
+    entry->received++;
+
+    int8_t seqs = (int8_t)(seq - entry->seq);
+
+    if (seqs == 0 && round == entry->round) {
+        entry->duplicated++;
+        table->duplicated++;
+        return DEDUP_DUPLICATE;
+    }
+
+    if (seqs < 0 && seqs >= -DEDUP_LATE_WINDOW) {
+        entry->late++;
+        table->late++;
+        return DEDUP_LATE;
+    }
+
+    entry->round = round;
+    entry->seq = seq;
+
+    return DEDUP_NEW;
+}
+
+const dedup_entry_s* dedup_find(const dedup_s* table, const uint8_t* mac)
+{
+    uint32_t i = slot_of(table, mac);
+
+    for (uint32_t probes = 0; probes <= table->mask; probes++) {
+        const dedup_entry_s* slot = &table->slots[i];
+
+        if (slot->used == 0) {
+            break;
+        }
+        if (memcmp(slot->mac, mac, FRAME_MAC_SIZE) == 0) {
+            return slot;
+        }
+        i = (i + 1) & table->mask;
+    }
+
+    return NULL;
+}
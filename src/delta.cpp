@@ -0,0 +1,200 @@
+/** @file delta.cpp
+ *  @brief
+ *
+ *  This file contains sorting and delta/varint encoder
+ *  of frames which cluster head sends to base, and
+ *  decoder which rebuilds frames out of uplink.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "delta.h"
+
+static uint64_t mac_value(const uint8_t* mac)
+{
+    uint64_t value = 0;
+
+    for (int i = 0; i < FRAME_MAC_SIZE; i++) {
+        value = (value << 8) | mac[i];
+    }
+
+    return value;
+}
+
+static void mac_bytes(uint8_t* mac, uint64_t value)
+{
+    for (int i = FRAME_MAC_SIZE - 1; i >= 0; i--) {
+        mac[i] = value & 0xFF;
+        value >>= 8;
+    }
+}
+
+static uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static size_t write_varint(uint8_t* buf, uint64_t value)
+{
+    size_t len = 0;
+
+    while (value >= 0x80) {
+        buf[len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buf[len++] = value;
+
+    return len;
+}
+
+static bool read_varint(const uint8_t* buf, size_t len, size_t* pos, uint64_t* value)
+{
+    uint8_t shift = 0;
+
+    *value = 0;
+
+    while (*pos < len && shift < 64) {
+        uint8_t byte = buf[(*pos)++];
+
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+        shift += 7;
+    }
+
+    return false;
+}
+
+static int compare_frames(const uint8_t* a, const uint8_t* b)
+{
+    int ret = memcmp(a, b, FRAME_MAC_SIZE);
+
+    // sequence numbers of one node wrap, held readings stay in order across it.
+    if (ret == 0) {
+        ret = (int8_t)(frame_seq(a) - frame_seq(b));
+    }
+
+    return ret;
+}
+
+void delta_sort(uint8_t* frames, uint16_t count)
+{
+    uint8_t frame[FRAME_SIZE];
+
+    // few dozen frames, mostly in order of arrival, insertion sort is enough.
+    for (uint16_t i = 1; i < count; i++) {
+        uint16_t j = i;
+
+        memcpy(frame, frames + i*FRAME_SIZE, FRAME_SIZE);
+        while (j > 0 && compare_frames(frames + (j - 1)*FRAME_SIZE, frame) > 0) {
+            memcpy(frames + j*FRAME_SIZE, frames + (j - 1)*FRAME_SIZE, FRAME_SIZE);
+            j--;
+        }
+        memcpy(frames + j*FRAME_SIZE, frame, FRAME_SIZE);
+    }
+}
+
+size_t delta_encode(uint8_t* buf, const uint8_t* frames, uint16_t count, uint8_t round, uint16_t* used)
+{
+    const size_t size = UPLINK_DATAGRAM_SIZE - UPLINK_HEADER_SIZE;
+    size_t len = 0;
+    uint64_t prev_mac = 0;
+    uint16_t prev_value = 0;
+    uint16_t n = 0;
+
+    buf[len++] = round;
+
+    while (n < count && n < DELTA_RECORDS_MAX && len + DELTA_RECORD_MAX + 1 <= size) {
+        const uint8_t* frame = frames + n*FRAME_SIZE;
+        uint64_t mac = mac_value(frame_mac(frame));
+        uint16_t value = frame_adc_value(frame);
+        uint32_t meta = zigzag((int8_t)(frame_round(frame) - round)) << 8 | frame_seq(frame);
+
+        if (n % DELTA_KEYFRAME == 0) {
+            prev_mac = 0;
+            prev_value = 0;
+        }
+
+        len += write_varint(buf + len, mac - prev_mac);
+        len += write_varint(buf + len, zigzag((int32_t)value - prev_value));
+        len += write_varint(buf + len, meta);
+
+        prev_mac = mac;
+        prev_value = value;
+        n++;
+    }
+
+    buf[len] = frame_crc8(buf, len);
+    *used = n;
+
+    return len + 1;
+}
+
+uint8_t delta_fragments(const uint8_t* frames, uint16_t count, uint8_t round)
+{
+    uint8_t buf[UPLINK_DATAGRAM_SIZE - UPLINK_HEADER_SIZE];
+    uint8_t fragments = 0;
+    uint16_t used;
+
+    while (count > 0) {
+        delta_encode(buf, frames, count, round, &used);
+        frames += used*FRAME_SIZE;
+        count -= used;
+        fragments++;
+    }
+
+    return fragments;
+}
+
+size_t delta_decode(const uint8_t* buf, size_t len, uint8_t* frames, size_t capacity)
+{
+    const uint8_t* body = buf + UPLINK_HEADER_SIZE;
+    size_t body_len;
+    size_t pos = 1;
+    uint64_t mac = 0;
+    uint16_t value = 0;
+    size_t n = 0;
+
+    if (len < UPLINK_HEADER_SIZE + DELTA_OVERHEAD || buf[0] >= buf[1] ||
+        uplink_type(buf) != UPLINK_DELTA) {
+        return 0;
+    }
+
+    body_len = len - UPLINK_HEADER_SIZE - 1;
+    if (frame_crc8(body, body_len) != body[body_len]) {
+        return 0;
+    }
+
+    while (n < buf[2] && n < capacity) {
+        uint64_t mac_delta, value_delta, meta;
+        uint8_t mac_buf[FRAME_MAC_SIZE];
+
+        if (!read_varint(body, body_len, &pos, &mac_delta) ||
+            !read_varint(body, body_len, &pos, &value_delta) ||
+            !read_varint(body, body_len, &pos, &meta)) {
+            return 0;
+        }
+
+        if (n % DELTA_KEYFRAME == 0) {
+            mac = 0;
+            value = 0;
+        }
+        mac += mac_delta;
+        value += unzigzag(value_delta);
+
+        mac_bytes(mac_buf, mac);
+        frame_encode(frames + n*FRAME_SIZE, mac_buf, value,
+                     body[0] + unzigzag(meta >> 8), meta & 0xFF);
+        n++;
+    }
+
+    return pos == body_len || n == capacity ? n : 0;
+}
@@ -0,0 +1,36 @@
+/** @file election.cpp
+ *  @brief
+ *
+ *  This file contains threshold table of cluster head
+ *  election and random generator it is compared with.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "election.h"
+
+constexpr election_table_s election_table = election_make_table();
+
+uint32_t election_round_threshold(uint16_t round)
+{
+    return election_table.threshold[round % NUMBER_OF_ROUNDS];
+}
+
+uint32_t election_seed(uint32_t seed)
+{
+    return seed != 0 ? seed : ELECTION_DEFAULT_SEED;
+}
+
+uint32_t election_random(uint32_t* state)
+{
+    uint32_t x = *state;
+
+    // xorshift32, Marsaglia.
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+
+    return x >> 16;
+}
@@ -0,0 +1,63 @@
+/** @file energy.cpp
+ *  @brief
+ *
+ *  This file contains accounting of charge node takes
+ *  from its battery in every state.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "energy.h"
+
+static const uint32_t Currents[ENERGY_STATES] = {
+    CURRENT_CPU_UA, CURRENT_SCAN_UA, CURRENT_ASSOC_UA, CURRENT_AP_UA,
+    CURRENT_TX_UA, CURRENT_RX_UA, CURRENT_SLEEP_UA
+};
+
+void energy_init(energy_s* energy, uint64_t used_uas)
+{
+    energy->used_uas = used_uas;
+    energy->since_us = 0;
+    energy->state = ENERGY_CPU;
+}
+
+void energy_enter(energy_s* energy, uint8_t state, uint32_t now_us)
+{
+    energy_charge(energy, energy->state, now_us - energy->since_us);
+    energy->since_us = now_us;
+    energy->state = state;
+}
+
+void energy_charge(energy_s* energy, uint8_t state, uint64_t duration_us)
+{
+    energy->used_uas += (energy_current(state) * duration_us + 500000) / 1000000;
+}
+
+uint32_t energy_current(uint8_t state)
+{
+    return state < ENERGY_STATES ? Currents[state] : 0;
+}
+
+uint64_t energy_left(const energy_s* energy, uint32_t capacity_mah)
+{
+    uint64_t capacity = capacity_mah * UAS_PER_MAH;
+
+    return energy->used_uas < capacity ? capacity - energy->used_uas : 0;
+}
+
+uint8_t energy_level(const energy_s* energy, uint32_t capacity_mah)
+{
+    uint64_t capacity = capacity_mah * UAS_PER_MAH;
+
+    return capacity ? energy_left(energy, capacity_mah) * 255 / capacity : 0;
+}
+
+uint8_t energy_average_update(uint8_t average, uint8_t level)
+{
+    if (average == 0) {
+        return level;
+    }
+
+    return (3 * average + level + 2) / 4;
+}
@@ -10,19 +10,135 @@
 
 #include "includes.h"
 
-char accumulateBuffer[255] = {0};
+void init_round(Node_s* node)
+{
+    uint16_t round = 0;
+    uint8_t ch_enable = 1;
+
+    TRACE_MARK(node, TRACE_BOOT);
+
+    timer1_enable(TIM_DIV256, TIM_EDGE, TIM_SINGLE);
+    timer1_write(ROUND_TIMER_TICKS);
+
+    WiFi.disconnect();
+    WiFi.forceSleepBegin(); // turn off WiFi by default.
+    WiFi.persistent(false);
+
+    pinMode(LED_BUILTIN, OUTPUT);
+    // by default LED will be ON
+    digitalWrite(LED_BUILTIN, LOW);
+
+#if DEBUG || PHASE_TRACE
+    Serial.begin(115200);
+#endif
+
+#if DEBUG
+    delay(10);
+    Serial.println();
+#endif
+
+#if ROUNDS_RESET
+    write_state(node, 0, 1);
+#endif
+
+    read_state(node, &round, &ch_enable);
+    energy_init(&node->energy, state_energy(&node->state));
+    state_clock(&node->state, &node->clock);
+    node->rng = state_rng(&node->state);
+    node->seq = state_seq(&node->state) + 1;
+
+    // radio is sampled for randomness only after cold boot.
+    if (node->rng == 0) {
+        node->rng = election_seed(ESP8266TrueRandom.random());
+        // readings of restarted node are numbered from anywhere, so base station
+        // does not take them as late ones of the previous run.
+        node->seq = election_random(&node->rng);
+    }
+    TRACE_MARK(node, TRACE_STATE);
+
+    get_adc_value(node);
+    TRACE_MARK(node, TRACE_SAMPLE);
+
+    node->round = round;
+    node->ch_enable = ch_enable;
+    init_node_name(node);
+    read_scan_cache(&node->scan_cache);
+#if STATION_BATCH
+    read_batch(&node->batch);
+    node->holding = false;
+#endif
+}
+
+void finish_round(Node_s* node)
+{
+    prepare_next_round(node);
+    write_scan_cache(&node->scan_cache);
+#if STATION_BATCH
+    write_batch(&node->batch);
+
+    // radio stayed off, there is nothing to wait for.
+    if (node->holding == false) {
+        delay(200); // wait for UDP to be sent.
+    }
+#else
+    delay(200); // wait for UDP to be sent.
+#endif
+    TRACE_MARK(node, TRACE_SLEEP);
+    print_trace(node);
+    sleeping_time(node);
+}
+
+void energy_phase(Node_s* node, uint8_t state)
+{
+    energy_enter(&node->energy, state, micros());
+}
+
+void save_energy(Node_s* node, uint64_t sleep_us)
+{
+    energy_phase(node, ENERGY_SLEEP);
+    energy_charge(&node->energy, ENERGY_SLEEP, sleep_us);
+
+    if (state_set_energy(&node->state, node->energy.used_uas) == true) {
+        ESP.rtcUserMemoryWrite(RTC_STATE_BLOCK, (uint32_t*)&node->state, sizeof(node->state));
+    }
+}
+
+void print_trace(Node_s* node)
+{
+#if PHASE_TRACE
+    char line[TRACE_LINE_SIZE];
+
+    trace_format(line, &node->trace, node->nodeName, node->round, node->cluster_head, CYCLES_PER_US);
+    Serial.println(line);
+    Serial.flush();
+#endif
+}
 
 void sleeping_time(Node_s* node)
 {
     unsigned long sleepTime = timer1_read()*(3.2);
 
+#if CLOCK_SYNC
+    // wake up with rest of network, RTC drift taken out.
+    sleepTime = sync_sleep(&node->clock, sleepTime);
+    state_set_clock(&node->state, &node->clock);
+#else
     if (node->cluster_head == true) {
         sleepTime -= 500000;
     }
+#endif
+    state_set_rng(&node->state, node->rng);
+    state_set_seq(&node->state, node->seq);
+
+    save_energy(node, sleepTime);
 
 #if DEBUG
     Serial.print("Time to sleep in ms = ");
     Serial.println(sleepTime/1000);
+#if CLOCK_SYNC
+    Serial.printf("RTC skew estimate = %d ppm\n", node->clock.skew_ppb / 1000);
+#endif
+    Serial.printf("Used charge = %u uAh\n", (uint32_t)(node->energy.used_uas / 3600));
 #endif
 
     ESP.deepSleep(sleepTime);
@@ -44,16 +160,67 @@ void prepare_next_round(Node_s* node)
         next_round = 0;
         ch_enable = 1;
     }
-    write_fs(next_round, ch_enable);
+    write_state(node, next_round, ch_enable);
+}
+
+void arena_clear(record_arena_s* arena)
+{
+    arena->count = 0;
+    arena->dropped = 0;
+}
+
+bool arena_add(record_arena_s* arena, const uint8_t* frame)
+{
+    if (arena->count >= ACCUMULATE_CAPACITY) {
+        arena->dropped++;
+        return false;
+    }
+
+    memcpy(arena->frames[arena->count++], frame, FRAME_SIZE);
+
+    return true;
+}
+
+void clear_accumulated(Node_s* node)
+{
+#if AGGREGATION == AGGREGATE_NONE
+    arena_clear(&node->records);
+#else
+    aggregate_init(&node->aggregate);
+#endif
+}
+
+bool accumulate_frame(Node_s* node, const uint8_t* frame)
+{
+#if AGGREGATION == AGGREGATE_NONE
+    return arena_add(&node->records, frame);
+#else
+    aggregate_add(&node->aggregate, frame);
+    return true;
+#endif
 }
 
 void send_to_base(Node_s* node)
 {
-    WiFiUDP Udp;
     IPAddress broadcast, dnsAddress;
     int connected = FAILED_TO_CONNECT;
 
+#if MULTI_HOP
+    // base station was out of range, next cluster head listens only a while longer.
+    if (node->level != 0 && relay_to_cluster_head(node) == true) {
+        TRACE_MARK(node, TRACE_UPLINK);
+        energy_phase(node, ENERGY_RX);
+#if STATION_BATCH
+        batch_sent(&node->batch, node->adc_value);
+#endif
+        return;
+    }
+#endif
+
+    energy_phase(node, ENERGY_ASSOC);
     connected = connect_to_strongest_ssid(node);
+    energy_phase(node, ENERGY_TX);
+    TRACE_MARK(node, TRACE_CONNECT);
 
     if (connected == CONNECTED) {
 
@@ -63,29 +230,214 @@ void send_to_base(Node_s* node)
 #endif
 
         broadcast = create_broadcast_address(dnsAddress);
-        Udp.beginPacket(broadcast, UDP_BROADCAST_PORT);
-        Udp.write(accumulateBuffer);
-        Udp.endPacket();
+        if (send_uplink(node, broadcast, 0) == true) {
+#if STATION_BATCH
+            // held readings went out with uplink, otherwise they are sent again.
+            batch_sent(&node->batch, node->adc_value);
+#endif
+        }
+        TRACE_MARK(node, TRACE_UPLINK);
     }
+
+    energy_phase(node, ENERGY_RX);
 }
 
-bool check_if_message_is_valid(char *txt, unsigned char l)
+static void begin_uplink(WiFiUDP* udp, Node_s* node, IPAddress address, uint8_t hops)
 {
-    bool correct = false;
+    udp->beginPacket(address, UDP_BROADCAST_PORT);
+
+#if MULTI_HOP
+    if (hops != 0) {
+        uint8_t relay[RELAY_HEADER_SIZE];
+
+        relay_encode_header(relay, hops, node->nodeName);
+        udp->write(relay, RELAY_HEADER_SIZE);
+    }
+#endif
+}
+
+bool send_uplink(Node_s* node, IPAddress address, uint8_t hops)
+{
+    WiFiUDP Udp;
+    uint8_t header[UPLINK_HEADER_SIZE];
+    bool sent = true;
+
+#if AGGREGATION == AGGREGATE_NONE && UPLINK_COMPRESSION
+    record_arena_s* arena = &node->records;
+    uint8_t body[UPLINK_DATAGRAM_SIZE - UPLINK_HEADER_SIZE];
+    uint8_t fragments;
+    uint16_t first = 0;
+
+    delta_sort(arena->frames[0], arena->count);
+    fragments = delta_fragments(arena->frames[0], arena->count, node->round);
+
+    for (uint8_t i = 0; i < fragments; i++) {
+        uint16_t count;
+        size_t len = delta_encode(body, arena->frames[first], arena->count - first, node->round, &count);
+
+        uplink_encode_header(header, i, fragments, count, UPLINK_DELTA);
+        begin_uplink(&Udp, node, address, hops);
+        Udp.write(header, UPLINK_HEADER_SIZE);
+        Udp.write(body, len);
+        sent = Udp.endPacket() == 1 && sent;
+        first += count;
+    }
+#elif AGGREGATION == AGGREGATE_NONE
+    record_arena_s* arena = &node->records;
+    uint8_t fragments = uplink_fragments(arena->count);
+
+    for (uint8_t i = 0; i < fragments; i++) {
+        uint16_t first = i * UPLINK_FRAMES;
+        uint8_t count = arena->count - first < UPLINK_FRAMES ? arena->count - first : UPLINK_FRAMES;
+
+        uplink_encode_header(header, i, fragments, count, UPLINK_FRAMES_RAW);
+        begin_uplink(&Udp, node, address, hops);
+        Udp.write(header, UPLINK_HEADER_SIZE);
+        Udp.write(arena->frames[first], count * FRAME_SIZE);
+        sent = Udp.endPacket() == 1 && sent;
+    }
+#else
+    uint8_t summary[HISTOGRAM_SIZE];
+    size_t len = aggregate_encode(summary, &node->aggregate, node->nodeName, node->round);
+
+    uplink_encode_header(header, 0, 1, 1,
+        AGGREGATION == AGGREGATE_HISTOGRAM ? UPLINK_HISTOGRAM : UPLINK_SUMMARY);
+    begin_uplink(&Udp, node, address, hops);
+    Udp.write(header, UPLINK_HEADER_SIZE);
+    Udp.write(summary, len);
+    sent = Udp.endPacket() == 1;
+#endif
+
+    return sent;
+}
+
+#if MULTI_HOP
+bool relay_to_cluster_head(Node_s* node)
+{
+    IPAddress address;
+    int ssid_status;
+    int connection_status = FAILED_TO_CONNECT;
+    uint8_t hops = node->relay.hops + 1;
+
+    if (hops > MULTI_HOP_MAX_HOPS) {
+
+#if DEBUG
+        Serial.println("Uplink made too many hops, not relayed!");
+#endif
+
+        return false;
+    }
+
+    // soft AP is already down, nobody can relay to this node any more.
+    node->relaying = true;
+    energy_phase(node, ENERGY_SCAN);
+    ssid_status = find_strongest_connection(node);
+    energy_phase(node, ENERGY_ASSOC);
+
+    while (ssid_status == VALID_SSID_FOUND) {
+        connection_status = connect_to_strongest_ssid(node);
+
+        if (connection_status == CONNECTED) {
+            break;
+        }
+        ssid_status = find_next_connection(node);
+    }
+    node->relaying = false;
+    energy_phase(node, ENERGY_TX);
+
+    if (connection_status != CONNECTED) {
+
+#if DEBUG
+        Serial.println("No cluster head to relay to!");
+#endif
+
+        return false;
+    }
+
+#if STATIC_IP
+    address = AP_ADDRESS;
+#else
+    address = create_broadcast_address(WiFi.dnsIP());
+#endif
+
+#if DEBUG
+    Serial.printf("Relaying uplink to %s, hop %u.\n", node->strongest_ssid, hops);
+#endif
+
+    return send_uplink(node, address, hops);
+}
 
-    if (l <= MAX_MESSAGE_SIZE) {
-        if (    
-            (txt[0] == ';') && isxdigit(txt[1]) && isxdigit(txt[2]) &&
-            isxdigit(txt[3]) && isxdigit(txt[4]) && isxdigit(txt[5]) &&
-            isxdigit(txt[6]) && isxdigit(txt[7]) && isxdigit(txt[8]) &&
-            isxdigit(txt[9]) && isxdigit(txt[10]) && isxdigit(txt[11]) &&
-            isxdigit(txt[12]) && (txt[13] == ':') 
-            ) 
-        {
-            correct = true;
+void merge_relay(Node_s* node, const uint8_t* buf, size_t len)
+{
+    const uint8_t* uplink = buf + RELAY_HEADER_SIZE;
+    size_t uplink_len = len - RELAY_HEADER_SIZE;
+
+    if (relay_accept(&node->relay, buf, node->nodeName) == false) {
+
+#if DEBUG
+        Serial.println("Relay over hop limit dropped!");
+#endif
+
+        return;
+    }
+
+#if AGGREGATION == AGGREGATE_NONE
+    record_arena_s* arena = &node->records;
+    size_t count = 0;
+
+    if (uplink_type(uplink) == UPLINK_DELTA) {
+        // frames are rebuilt straight into free part of arena.
+        count = delta_decode(uplink, uplink_len, arena->frames[arena->count],
+                             ACCUMULATE_CAPACITY - arena->count);
+        arena->count += count;
+    }
+    else {
+        const uint8_t* frames = uplink_frames(uplink, uplink_len, &count);
+
+        for (size_t i = 0; frames != NULL && i < count; i++) {
+            arena_add(arena, frames + i * FRAME_SIZE);
         }
     }
+    // third header byte is number of frames forwarding node sent.
+    if (count < uplink[2]) {
+        arena->dropped += uplink[2] - count;
+    }
+#else
+    if (summary_is_valid(uplink + UPLINK_HEADER_SIZE, uplink_len - UPLINK_HEADER_SIZE, uplink_type(uplink)) == true) {
+        aggregate_merge(&node->aggregate, uplink + UPLINK_HEADER_SIZE);
+    }
+#endif
+
+#if DEBUG
+    const uint8_t* mac = relay_mac(buf);
+
+    Serial.printf("Relay from %02X%02X%02X%02X%02X%02X merged, hop %u.\n",
+        mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], relay_hops(buf));
+#endif
+}
+#endif
 
+uint32_t reported_stations(Node_s* node)
+{
+#if MULTI_HOP
+    return node->dedup.count + node->relay.count;
+#else
+    return node->dedup.count;
+#endif
+}
+
+bool check_if_message_is_valid(const uint8_t *msg, size_t l)
+{
+    bool correct = false;
+
+    if (l == FRAME_SIZE) {
+        correct = frame_is_valid(msg, l);
+    }
+#if STATION_BATCH
+    else {
+        correct = batch_frames(msg, l) > 0;
+    }
+#endif
 
     return correct;
 }
@@ -94,18 +446,53 @@ void parse_packets(Node_s* node)
 {
     WiFiUDP Udp;
     uint32_t timeout_start = timer1_read();
-    char packetBuffer[255] = {0};
+    uint32_t elapsed = 0;
+#if MULTI_HOP
+    uint8_t packetBuffer[RELAY_DATAGRAM_SIZE + 1] = {0};
+#elif STATION_BATCH
+    uint8_t packetBuffer[BATCH_DATAGRAM_SIZE + 1] = {0};
+#else
+    uint8_t packetBuffer[FRAME_SIZE + 1] = {0};
+#endif
+    uint32_t window = receive_window(node);
+    uint32_t quiet = station_quiet(node);
+    uint32_t min_wait = 0;
+    uint32_t changed = 0;
+    uint8_t stations = 0;
+
+#if TDMA_SCHEDULE
+    // stations send in their slots, after last one only those refused by other soft AP come.
+    min_wait = MS_TO_TICKS(tdma_window_ms(round_elapsed_us() / 1000, 0));
+    window = MS_TO_TICKS(tdma_window_ms(round_elapsed_us() / 1000, TDMA_TAIL_MS));
+#endif
 
-    Udp.begin(UDP_BROADCAST_PORT);
+#if MULTI_HOP
+    // cluster head which will relay has to reach next one while it still listens.
+    node->level = route_level(node);
+    uint32_t lead = MS_TO_TICKS(MULTI_HOP_LEAD_MS) * (node->level < MULTI_HOP_MAX_HOPS ? node->level : MULTI_HOP_MAX_HOPS);
 
-    
+    window = window > lead ? window - lead : 0;
+    min_wait = min_wait > lead ? min_wait - lead : 0;
+#endif
 
-    while ((timeout_start - timer1_read()) < 3125000) {
-        yield();
+#if DEBUG
+    Serial.printf("Receive window = %u ms\n", TICKS_TO_MS(window));
+#endif
 
+    dedup_init(&node->dedup, node->dedup_slots, DEDUP_CAPACITY);
+#if MULTI_HOP
+    relay_init(&node->relay);
+#endif
+    Udp.begin(UDP_BROADCAST_PORT);
+
+    while (elapsed < MS_TO_TICKS(WAIT_FOR_PACKETS)) {
         int packetSize = Udp.parsePacket();
 
-        if (packetSize) {
+        if (packetSize == 0) {
+            // nothing received, let SDK run until next check instead of spinning.
+            delay(RECEIVE_POLL_PERIOD);
+        }
+        else {
 #if DEBUG
                 Serial.printf("Received packet of size %d from %s:%d\n    (to %s:%d, free heap = %d B)\n",
                     packetSize,
@@ -114,19 +501,63 @@ void parse_packets(Node_s* node)
                     ESP.getFreeHeap());
 #endif
 
-                int n = Udp.read(packetBuffer, UDP_TX_PACKET_MAX_SIZE);
-                packetBuffer[n] = '\0';
+                // longer datagram fills whole buffer, and is rejected by length.
+                int n = Udp.read(packetBuffer, sizeof(packetBuffer));
+
+                bool valid_message = check_if_message_is_valid(packetBuffer, n);
+
+                if (valid_message == true) {
+                    // station sends one frame, or readings it held back to back (STATION_BATCH),
+                    // whose rounds wrap at NUMBER_OF_ROUNDS. Repeated datagram is dropped whole.
+                    size_t frames = n / FRAME_SIZE;
+                    dedup_result_e seen = dedup_check(&node->dedup, packetBuffer + (frames - 1) * FRAME_SIZE);
+
+#if CLOCK_SYNC
+                    // repeated frame is retry of station whose reply was lost, it is answered as well.
+                    send_sync(&Udp, frame_mac(packetBuffer));
+#endif
 
+                    if (seen == DEDUP_DUPLICATE) {
+#if DEBUG
+                        Serial.println("Frame already received!");
+#endif
+                    }
+                    else if (seen == DEDUP_LATE) {
 #if DEBUG
-                Serial.println("Contents of packet buffer:");
-                Serial.println(packetBuffer);
+                        Serial.println("Frame older than last one of station!");
 #endif
-                bool valid_message = false;
-                valid_message = check_if_message_is_valid(packetBuffer, n);
+                    }
+                    else {
+                        window_add(&node->scan_cache.arrivals, TICKS_TO_MS(timeout_start - timer1_read()),
+                                   WAIT_FOR_PACKETS);
 
-                if (valid_message == true) {
-                    strcat(accumulateBuffer, packetBuffer);
+                        for (size_t f = 0; f < frames; f++) {
+                            const uint8_t* frame = packetBuffer + f * FRAME_SIZE;
+
+#if DEBUG
+                            const uint8_t* mac = frame_mac(frame);
+
+                            Serial.printf("Frame from %02X%02X%02X%02X%02X%02X: adc = %u, round = %u, seq = %u\n",
+                                mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+                                frame_adc_value(frame), frame_round(frame), frame_seq(frame));
+#endif
+
+                            if (accumulate_frame(node, frame) == false) {
+#if DEBUG
+                                Serial.println("Record arena full, frame dropped!");
+#endif
+                            }
+                        }
+                    }
                 }
+#if MULTI_HOP
+                else if (relay_is_valid(packetBuffer, n) == true) {
+                    // relays come late, window which missed them grows.
+                    window_add(&node->scan_cache.arrivals, TICKS_TO_MS(timeout_start - timer1_read()),
+                               WAIT_FOR_PACKETS);
+                    merge_relay(node, packetBuffer, n);
+                }
+#endif
                 else {
 #if DEBUG
                     Serial.println("Message invalid!");
@@ -134,11 +565,53 @@ void parse_packets(Node_s* node)
                 }
         }
 
+        elapsed = timeout_start - timer1_read();
+
+        // station associated or left, others may still be on their way.
+        if (wifi_softap_get_station_num() != stations) {
+            if (wifi_softap_get_station_num() > stations) {
+                window_add(&node->scan_cache.gaps, TICKS_TO_MS(elapsed - changed), MAX_STATION_QUIET);
+            }
+            stations = wifi_softap_get_station_num();
+            changed = elapsed;
+        }
+
+        // every associated station reported and no other came for a while, there is nothing more to wait for.
+        if (reported_stations(node) > 0 && reported_stations(node) >= stations &&
+            elapsed >= min_wait && elapsed - changed >= quiet) {
+
+#if DEBUG
+            Serial.printf("All %u stations reported after %u ms.\n", reported_stations(node), TICKS_TO_MS(elapsed));
+#endif
+
+            break;
+        }
+
+        // station which associated and did not report yet keeps window open.
+        if (elapsed >= window && reported_stations(node) >= wifi_softap_get_station_num()) {
+            break;
+        }
+    }
+
+    // associated stations which did not report needed longer window.
+    for (uint32_t i = reported_stations(node); i < wifi_softap_get_station_num(); i++) {
+        window_add(&node->scan_cache.arrivals, WAIT_FOR_PACKETS, WAIT_FOR_PACKETS);
     }
 
 #if DEBUG
-    Serial.println("Done waiting for stations! Accumulated buffer = ");
-    Serial.println(accumulateBuffer);
+    Serial.printf("Frames from %u stations: received %u, duplicated %u, late %u.\n",
+        node->dedup.count, node->dedup.received, node->dedup.duplicated, node->dedup.late);
+#if MULTI_HOP
+    Serial.printf("Relays from %u cluster heads: merged %u, dropped %u, most hops %u.\n",
+        node->relay.count, node->relay.datagrams, node->relay.dropped, node->relay.hops);
+#endif
+#if AGGREGATION == AGGREGATE_NONE
+    Serial.printf("Done waiting for stations! Accumulated %u frames, dropped %u.\n",
+        node->records.count, node->records.dropped);
+#else
+    Serial.printf("Done waiting for stations! Aggregated %u readings, min = %u, max = %u, sum = %u.\n",
+        node->aggregate.count, node->aggregate.min, node->aggregate.max, node->aggregate.sum);
+#endif
 #endif
     
 }
@@ -146,43 +619,95 @@ void parse_packets(Node_s* node)
 bool set_access_point(Node_s* node)
 {    
     char node_name[40] = {0};
-    char adc_value_string[20] = {0};
+    bool success =  false;
+    uint8_t frame[FRAME_SIZE];
+
+    access_point_name(node, node_name);
+
+    frame_encode(frame, node->nodeName, node->adc_value, node->round, node->seq);
+    clear_accumulated(node);
+
+#if STATION_BATCH
+    // readings held as station go out with uplink of this round, older
+    // rounds first, or base station would take them as late. They are
+    // kept until uplink is sent (see send_to_base()).
+    uint8_t held[BATCH_DATAGRAM_SIZE];
+    size_t len = batch_encode(held, &node->batch, node->nodeName);
+
+    for (size_t i = 0; i < len; i += FRAME_SIZE) {
+        accumulate_frame(node, held + i);
+    }
+#endif
+
+    accumulate_frame(node, frame);
+
+    WiFi.mode(WIFI_AP);
+
+#if STATIC_IP
+    // stations send to this address without asking for it.
+    WiFi.softAPConfig(AP_ADDRESS, AP_ADDRESS, AP_NETMASK);
+#endif
+
+    if(WiFi.softAP(node_name, NODE_PASS, channel_select(node->nodeName, node->round), false, MAX_CONNECTED) == true) {
+
+        success = true;
+   }
+
+    return success;
+}
+
+void access_point_name(Node_s* node, char* name)
+{
     char upper_nibla;
     char lower_nibla;
     char upper_nibla_string[2];
     char lower_nibla_string[2];
-    bool success =  false;
-    char buffer_string [50] = {0};
 
-    node_name[39] = '\0';
-    adc_value_string [19] = '\0';
-    buffer_string[49] = '\0';
-    accumulateBuffer[254] = '\0';
+    name[0] = '\0';
 
     for (int i = 0; i < 6; i++) {
         lower_nibla = node->nodeName[i] & 0x0F;
         upper_nibla = (node->nodeName[i] & 0xF0) >> 4;
         sprintf(upper_nibla_string, "%X", upper_nibla);
         sprintf(lower_nibla_string, "%X", lower_nibla);
-        strcat(node_name, upper_nibla_string);
-        strcat(node_name, lower_nibla_string);
+        strcat(name, upper_nibla_string);
+        strcat(name, lower_nibla_string);
     }
 
-    strcat(buffer_string, ";");
-    strcat(buffer_string, node_name);
-    strcat(buffer_string, ":");
-    sprintf(adc_value_string, "%u", node->adc_value);
-    strcat(buffer_string, adc_value_string);
-    strcat(accumulateBuffer, buffer_string);
+#if MULTI_HOP
+    sprintf(name + strlen(name), "%X", route_level(node));
+#endif
+#if ELECTION == ELECTION_ENERGY
+    sprintf(name + strlen(name), "%02X", beacon_energy_level(node));
+#endif
+}
 
-    WiFi.mode(WIFI_AP);
+#if MULTI_HOP
+uint8_t route_level(Node_s* node)
+{
+    if (node->scan_cache.base.channel != 0) {
+        return 0;
+    }
+    if (node->scan_cache.level == 0) {
+        return RELAY_NO_ROUTE;
+    }
 
-    if(WiFi.softAP(node_name, NODE_PASS, WIFI_CHANNEL, false, MAX_CONNECTED) == true) {
+    return node->scan_cache.level;
+}
+#endif
 
-        success = true;
-   }
+uint8_t beacon_energy_level(Node_s* node)
+{
+    if (node->scan_cache.energy_average == 0) {
+        return energy_level(&node->energy, BATTERY_CAPACITY_MAH);
+    }
 
-    return success;
+    return node->scan_cache.energy_average;
+}
+
+uint8_t ssid_energy_level(const char* ssid)
+{
+    return strtoul(ssid + NODE_SSID_LENGTH - 2, NULL, 16);
 }
 
 IPAddress create_broadcast_address(IPAddress dns)
@@ -192,64 +717,62 @@ IPAddress create_broadcast_address(IPAddress dns)
     return broadcast;
 }
 
-void send_packet_to_ap(Node_s* node)
+IPAddress station_address(const uint8_t* mac)
+{
+    uint16_t host = ((mac[4] << 8) | mac[5]) % 253 + 2;
+
+    return IPAddress(192, 168, 4, host);
+}
+
+bool send_packet_to_ap(Node_s* node)
 {
     WiFiUDP Udp;
     IPAddress dnsAddress;
     IPAddress broadcastAddress;
-    dnsAddress = WiFi.dnsIP();
+    bool sent = false;
 
 #if DEBUG
     Serial.print("Local IP address = ");
     Serial.println(WiFi.localIP());
-    Serial.print("DNS address = ");
-    Serial.println(dnsAddress);
 #endif
 
-    char node_name[40] = {0};
-    char adc_value_string[20] = {0};
-    char upper_nibla;
-    char lower_nibla;
-    char upper_nibla_string[2];
-    char lower_nibla_string[2];
-
-    node_name[39] = '\0';
-    adc_value_string [19] = '\0';
-
-    for (int i = 0; i < 6; i++) {
-        lower_nibla = node->nodeName[i] & 0x0F;
-        upper_nibla = (node->nodeName[i] & 0xF0) >> 4;
-        sprintf(upper_nibla_string, "%X", upper_nibla);
-        sprintf(lower_nibla_string, "%X", lower_nibla);
-        strcat(node_name, upper_nibla_string);
-        strcat(node_name, lower_nibla_string);
-    }
+#if STATION_BATCH
+    uint8_t frame[BATCH_DATAGRAM_SIZE];
+    size_t len = batch_encode(frame, &node->batch, node->nodeName);
+#else
+    uint8_t frame[FRAME_SIZE];
+    size_t len = frame_encode(frame, node->nodeName, node->adc_value, node->round, node->seq);
+#endif
 
-    sprintf(adc_value_string, "%u", node->adc_value);
+#if STATIC_IP
+    broadcastAddress = AP_ADDRESS;
+#else
+    dnsAddress = WiFi.dnsIP();
+    broadcastAddress = create_broadcast_address(dnsAddress);
 
 #if DEBUG
-    Serial.print("NODE NAME = ");
-    Serial.println(node_name);
-    Serial.println(strlen(node_name));
+    Serial.print("DNS address = ");
+    Serial.println(dnsAddress);
+#endif
 #endif
-
-    broadcastAddress = create_broadcast_address(dnsAddress);
 
 #if DEBUG
-    Serial.print("Broadcast address = ");
+    Serial.print("Destination address = ");
     Serial.println(broadcastAddress);
 #endif
 
+#if CLOCK_SYNC
+    // cluster head broadcasts its answer to this port.
+    Udp.begin(UDP_BROADCAST_PORT);
+#endif
+
     if (Udp.beginPacket(broadcastAddress, UDP_BROADCAST_PORT) == 1) {
 
 #if DEBUG
     Serial.println("Sending packet!");
 #endif
 
-    Udp.write(";");
-    Udp.write(node_name);
-    Udp.write(":");
-    Udp.write(adc_value_string);
+    Udp.write(frame, len);
 
     }
 
@@ -259,27 +782,141 @@ void send_packet_to_ap(Node_s* node)
     Serial.println("Packet sent!");
 #endif
 
+        sent = true;
     }
-    
+
+#if CLOCK_SYNC
+    // cluster head answers only frames it took.
+    if (receive_sync(node, &Udp) == false) {
+        sent = false;
+    }
+#endif
+
+#if STATION_BATCH
+    if (sent == true) {
+        batch_sent(&node->batch, node->adc_value);
+    }
+#endif
+
+    return sent;
+}
+
+#if TDMA_SCHEDULE
+void wait_for_slot(Node_s* node, uint32_t lead_ms, bool radio_off)
+{
+    uint32_t wait = tdma_wait_ms(node->slot, round_elapsed_us() / 1000, lead_ms);
+
+#if DEBUG
+    Serial.printf("Slot %u, waiting %u ms\n", node->slot, wait);
+#endif
+
+    if (radio_off == true && wait > 0) {
+        // modem sleep, CPU keeps timer1 and round time running.
+        WiFi.forceSleepBegin();
+        energy_phase(node, ENERGY_CPU);
+        delay(wait);
+        WiFi.forceSleepWake();
+    }
+    else {
+        delay(wait);
+    }
+}
+#endif
+
+uint32_t round_elapsed_us(void)
+{
+    return (ROUND_TIMER_TICKS - timer1_read()) * 16 / 5;
+}
+
+void send_sync(WiFiUDP* udp, const uint8_t* mac)
+{
+    uint8_t reply[SYNC_SIZE];
+
+    // stations may share address, broadcast reaches the one which sent frame.
+    sync_encode(reply, mac, round_elapsed_us());
+    udp->beginPacket(create_broadcast_address(WiFi.softAPIP()), UDP_BROADCAST_PORT);
+    udp->write(reply, SYNC_SIZE);
+    udp->endPacket();
+}
+
+bool receive_sync(Node_s* node, WiFiUDP* udp)
+{
+    uint32_t start = timer1_read();
+    uint8_t reply[SYNC_SIZE + 1];
+
+    while (start - timer1_read() < MS_TO_TICKS(SYNC_WAIT_MS)) {
+        if (udp->parsePacket() > 0) {
+            uint32_t elapsed = round_elapsed_us();
+            int n = udp->read(reply, sizeof(reply));
+
+            // reply to other station of same cluster head is skipped.
+            if (sync_is_valid(reply, n) == true && memcmp(sync_mac(reply), node->nodeName, FRAME_MAC_SIZE) == 0) {
+                int32_t offset = (int32_t)(elapsed - sync_elapsed(reply));
+
+                sync_update(&node->clock, offset);
+
+#if DEBUG
+                Serial.printf("Offset to cluster head = %d us\n", offset);
+#endif
+
+                return true;
+            }
+        }
+        yield();
+    }
+
+#if DEBUG
+    Serial.println("No sync reply!");
+#endif
+
+    return false;
 }
 
 void get_adc_value(Node_s* node)
 {
-    node->adc_value = analogRead(ADC_PIN);
+    sample_clear(&node->samples);
+
+    for (uint8_t i = 0; i < SAMPLE_COUNT; i++) {
+        if (i != 0) {
+            delayMicroseconds(SAMPLE_INTERVAL_US);
+        }
+        sample_push(&node->samples, analogRead(ADC_PIN));
+    }
+
+    node->adc_value = sample_reading(&node->samples);
+
+#if DEBUG
+    Serial.print("Reading = ");
+    Serial.println(node->adc_value);
+#endif
 }
 
 int connect_to_strongest_ssid(Node_s* node)
 {
     int ret = FAILED_TO_CONNECT;
     unsigned long start;
+    uint32_t timeout;
+    bool to_cluster_head = node->cluster_head == false;
+
+    scan_entry_s* base = &node->scan_cache.base;
+
+#if MULTI_HOP
+    to_cluster_head = to_cluster_head || node->relaying == true;
+#endif
 
     WiFi.mode(WIFI_STA);
 
-    if (node->cluster_head == false) {
-        WiFi.begin(String(node->strongest_ssid), NODE_PASS);
+    if (to_cluster_head == true) {
+#if STATIC_IP
+        WiFi.config(station_address(node->nodeName), AP_ADDRESS, AP_NETMASK);
+#endif
+        WiFi.begin(node->strongest_ssid, NODE_PASS, node->strongest_channel, node->strongest_bssid);
+    }
+    else if (base->channel != 0) {
+        WiFi.begin(BASE_SSID, NODE_PASS, base->channel, base->bssid);
     }
     else {
-        WiFi.begin(BASE_SSID, NODE_PASS);
+        WiFi.begin(BASE_SSID, NODE_PASS, WIFI_CHANNEL);
     }
 
 #if DEBUG
@@ -288,51 +925,193 @@ int connect_to_strongest_ssid(Node_s* node)
     Serial.println("...");
 #endif
 
+    timeout = connect_timeout(node);
     start = timer1_read();
 
-    while (WiFi.status() != WL_CONNECTED && (start - (timer1_read()) < 4687500)) {
+    while (WiFi.status() != WL_CONNECTED && WiFi.status() != WL_CONNECT_FAILED &&
+           WiFi.status() != WL_NO_SSID_AVAIL && (start - (timer1_read()) < timeout)) {
         //delay(20);
         yield();
     }
 
-    if (start - timer1_read() > 4687500) {
-        ret = CONNECTION_TIMEOUT;
-    } 
-
     if (WiFi.status() == WL_CONNECTED) {
         ret = CONNECTED;
     }
 
+    if (node->cluster_head == false) {
+        // full soft AP refuses at once, only connects and timeouts tell how long it takes.
+        if (ret == CONNECTED) {
+            window_add(&node->scan_cache.connects, TICKS_TO_MS(start - timer1_read()), CONNECTION_TIMEOUT);
+        }
+        else if (start - timer1_read() >= timeout) {
+            window_add(&node->scan_cache.connects, CONNECTION_TIMEOUT, CONNECTION_TIMEOUT);
+        }
+    }
+
+    if (to_cluster_head == false) {
+        if (ret == CONNECTED) {
+            cache_network(base, BASE_SSID, WiFi.BSSID(), WIFI_CHANNEL, WiFi.RSSI(), node->round);
+        }
+        else {
+            // cached base station might have moved, scan for it next time.
+            base->channel = 0;
+        }
+    }
+
     return ret;
 }
 
+uint32_t receive_window(Node_s* node)
+{
+#if ADAPTIVE_WINDOW
+    return MS_TO_TICKS(window_timeout(&node->scan_cache.arrivals, MIN_RECEIVE_WINDOW, WAIT_FOR_PACKETS,
+                                      RECEIVE_WINDOW_MARGIN));
+#else
+    return MS_TO_TICKS(WAIT_FOR_PACKETS);
+#endif
+}
+
+uint32_t station_quiet(Node_s* node)
+{
+#if ADAPTIVE_WINDOW
+    return MS_TO_TICKS(window_timeout(&node->scan_cache.gaps, MIN_STATION_QUIET, MAX_STATION_QUIET,
+                                      STATION_QUIET_MARGIN));
+#else
+    return MS_TO_TICKS(MAX_STATION_QUIET);
+#endif
+}
+
+uint32_t connect_timeout(Node_s* node)
+{
+#if ADAPTIVE_WINDOW
+    // base station is reached once in many rounds, there are no times to go by.
+    if (node->cluster_head == false) {
+        return MS_TO_TICKS(window_timeout(&node->scan_cache.connects, MIN_CONNECT_TIMEOUT, CONNECTION_TIMEOUT,
+                                          CONNECT_TIMEOUT_MARGIN));
+    }
+#endif
+
+    return MS_TO_TICKS(CONNECTION_TIMEOUT);
+}
+
+void read_scan_cache(scan_cache_s* cache)
+{
+    if (!ESP.rtcUserMemoryRead(RTC_SCAN_CACHE_BLOCK, (uint32_t*)cache, sizeof(*cache)) ||
+        cache->crc != frame_crc8((uint8_t*)cache + sizeof(cache->crc), sizeof(*cache) - sizeof(cache->crc))) {
+
+#if DEBUG
+        Serial.println("Scan cache empty!");
+#endif
+
+        memset(cache, 0, sizeof(*cache));
+    }
+}
+
+void write_scan_cache(scan_cache_s* cache)
+{
+    cache->crc = frame_crc8((uint8_t*)cache + sizeof(cache->crc), sizeof(*cache) - sizeof(cache->crc));
+    ESP.rtcUserMemoryWrite(RTC_SCAN_CACHE_BLOCK, (uint32_t*)cache, sizeof(*cache));
+}
+
+void read_batch(batch_s* batch)
+{
+    if (!ESP.rtcUserMemoryRead(RTC_BATCH_BLOCK, (uint32_t*)batch, sizeof(*batch)) ||
+        batch->crc != frame_crc8((uint8_t*)batch + sizeof(batch->crc), sizeof(*batch) - sizeof(batch->crc))) {
+
+#if DEBUG
+        Serial.println("No held readings!");
+#endif
+
+        batch_init(batch);
+    }
+}
+
+void write_batch(batch_s* batch)
+{
+    batch->crc = frame_crc8((uint8_t*)batch + sizeof(batch->crc), sizeof(*batch) - sizeof(batch->crc));
+    ESP.rtcUserMemoryWrite(RTC_BATCH_BLOCK, (uint32_t*)batch, sizeof(*batch));
+}
+
+void cache_network(scan_entry_s* entry, const char* ssid, const uint8_t* bssid, uint8_t channel,
+                   int8_t rssi, uint8_t round)
+{
+    // longer SSID is not valid one, it is cut to fit.
+    snprintf(entry->ssid, sizeof(entry->ssid), "%s", ssid);
+    memcpy(entry->bssid, bssid, sizeof(entry->bssid));
+    entry->channel = channel;
+    entry->rssi = rssi;
+    entry->round = round;
+}
+
 bool ssid_is_valid(const char* txt)
 {
     bool ret = false;
 
-    if (strlen(txt) == 12) {
-        if ((isxdigit(txt[0]) && isxdigit(txt[1]) && isxdigit(txt[2]) &&
-            isxdigit(txt[3]) && isxdigit(txt[4]) && isxdigit(txt[5]) &&
-            isxdigit(txt[6]) && isxdigit(txt[7]) && isxdigit(txt[8]) &&
-            isxdigit(txt[9]) && isxdigit(txt[10]) && isxdigit(txt[11]))
-            || (strcmp(txt, BASE_SSID) == 0)) {
-                ret = true;
+    // most networks in scan are cluster heads, check them first.
+    if (strnlen(txt, NODE_SSID_LENGTH + 1) == NODE_SSID_LENGTH) {
+        ret = true;
+
+        // isxdigit() is table lookup as well, 64-bit SWAR (hex.h) is emulated on ESP8266.
+        for (int i = 0; i < NODE_SSID_LENGTH; i++) {
+            if (!isxdigit(txt[i])) {
+                ret = false;
             }
+        }
+    }
+
+    if (ret == false && strcmp(txt, BASE_SSID) == 0) {
+        ret = true;
     }
 
     return ret;
 }
 
+static void keep_network(Node_s* node, int i)
+{
+    scan_entry_s* entry = &node->found[node->networks];
+    int8_t rssi = WiFi.RSSI(i);
+
+    // full list keeps strongest networks, weakest one makes room.
+    if (node->networks == SCAN_RESULTS) {
+        entry = &node->found[0];
+        for (uint8_t j = 1; j < SCAN_RESULTS; j++) {
+            if (node->found[j].rssi < entry->rssi) {
+                entry = &node->found[j];
+            }
+        }
+        if (rssi <= entry->rssi) {
+            return;
+        }
+    }
+    else {
+        node->networks++;
+    }
+
+    cache_network(entry, WiFi.SSID(i).c_str(), WiFi.BSSID(i), WiFi.channel(i), rssi, node->round);
+}
+
 int find_strongest_connection(Node_s* node)
 {
-    int ret;
     int n = 0;
-    int power = -100;
-    char cmp_ssid[20] = "Not valid";
 
-    strncpy(node->strongest_ssid, cmp_ssid, strlen(cmp_ssid));
     WiFi.forceSleepWake();
-    n = WiFi.scanNetworks();
+    node->networks = 0;
+    node->strongest_index = -1;
+
+    // one channel at a time, channels no cluster head uses cost nothing.
+    for (uint8_t channel = 1; channel <= 13; channel++) {
+        if ((SCAN_CHANNELS & (1u << channel)) == 0) {
+            continue;
+        }
+        n = WiFi.scanNetworks(false, false, channel);
+
+        for (int i = 0; i < n; i++) {
+            if (ssid_is_valid(WiFi.SSID(i).c_str())) {
+                keep_network(node, i);
+            }
+        }
+    }
+    n = node->networks;
 
     if (n == 0) {
 
@@ -340,24 +1119,83 @@ int find_strongest_connection(Node_s* node)
     Serial.println("No networks found!");
 #endif
 
-    ret = NO_NETWORKS_FOUND;
+    return NO_NETWORKS_FOUND;
     }
-    else {
-        for (int i = 0; i < n; i++) {
-            if (ssid_is_valid(WiFi.SSID(i).c_str())) {
-                if (WiFi.RSSI(i) > power) {
-                    power = WiFi.RSSI(i);
-                    strncpy(node->strongest_ssid, WiFi.SSID(i).c_str(), strlen(WiFi.SSID(i).c_str()));
-                    ret = VALID_SSID_FOUND;
-                }
+
+#if ELECTION == ELECTION_ENERGY
+    uint32_t level_sum = 0;
+    uint8_t levels = 0;
+#endif
+#if MULTI_HOP
+    uint8_t lowest = RELAY_NO_ROUTE;
+#endif
+
+    for (int i = 0; i < n; i++) {
+        if (strcmp(node->found[i].ssid, BASE_SSID) == 0) {
+            node->scan_cache.base = node->found[i];
+        }
+#if ELECTION == ELECTION_ENERGY || MULTI_HOP
+        else {
+#if ELECTION == ELECTION_ENERGY
+            level_sum += ssid_energy_level(node->found[i].ssid);
+            levels++;
+#endif
+#if MULTI_HOP
+            if (relay_level(node->found[i].ssid) < lowest) {
+                lowest = relay_level(node->found[i].ssid);
             }
-            //delay(20);
-            yield();
+#endif
         }
+#endif
     }
 
-    if (strcmp(node->strongest_ssid, cmp_ssid) == 0) {
-        ret = NOT_VALID_SSID;
+#if MULTI_HOP
+    node->scan_cache.level = relay_next_level(lowest);
+#endif
+
+#if ELECTION == ELECTION_ENERGY
+    // every cluster head in range carries its estimate of network average.
+    if (levels > 0) {
+        node->scan_cache.energy_average = energy_average_update(node->scan_cache.energy_average,
+                                                                level_sum / levels);
+    }
+#endif
+
+    return find_next_connection(node);
+}
+
+int find_next_connection(Node_s* node)
+{
+    int ret = NOT_VALID_SSID;
+    int power = -100;
+    int best = -1;
+    int32_t last_power = node->strongest_rssi;
+    int last = node->strongest_index;
+    char cmp_ssid[20] = "Not valid";
+
+    snprintf(node->strongest_ssid, sizeof(node->strongest_ssid), "%s", cmp_ssid);
+
+    for (int i = 0; i < node->networks; i++) {
+        int32_t rssi = node->found[i].rssi;
+
+        // networks are tried from strongest, skip those tried before.
+        if (last >= 0 && (rssi > last_power || (rssi == last_power && i <= last))) {
+            continue;
+        }
+        if (rssi > power && relay_candidate(node, node->found[i].ssid)) {
+            power = rssi;
+            best = i;
+        }
+        yield();
+    }
+
+    if (best >= 0) {
+        snprintf(node->strongest_ssid, sizeof(node->strongest_ssid), "%s", node->found[best].ssid);
+        memcpy(node->strongest_bssid, node->found[best].bssid, sizeof(node->strongest_bssid));
+        node->strongest_channel = node->found[best].channel;
+        node->strongest_rssi = power;
+        node->strongest_index = best;
+        ret = VALID_SSID_FOUND;
     }
 
 #if DEBUG
@@ -370,6 +1208,19 @@ int find_strongest_connection(Node_s* node)
     return ret;
 }
 
+bool relay_candidate(Node_s* node, const char* ssid)
+{
+#if MULTI_HOP
+    if (node->relaying == true) {
+        // only cluster heads closer to base station, levels go down on every hop.
+        return strcmp(ssid, BASE_SSID) != 0 && relay_level(ssid) < node->level &&
+               relay_is_source(&node->relay, ssid, node->nodeName) == false;
+    }
+#endif
+
+    return true;
+}
+
 void handle_node(Node_s* node)
 {
     int ssid_status;
@@ -377,7 +1228,9 @@ void handle_node(Node_s* node)
     bool success = false;
 
     if (node->cluster_head == true) {
+       energy_phase(node, ENERGY_AP);
        success =  set_access_point(node);
+       TRACE_MARK(node, TRACE_AP_START);
 
         if (success == true) {
 
@@ -385,6 +1238,7 @@ void handle_node(Node_s* node)
         Serial.println("Successfully created Access Point!");
 #endif
         parse_packets(node);
+        TRACE_MARK(node, TRACE_RECEIVE);
 
         send_to_base(node);
 
@@ -398,23 +1252,71 @@ void handle_node(Node_s* node)
         }
     }
     else {
-        WiFi.forceSleepBegin();
-        delay(1000);
-        WiFi.forceSleepWake();
+#if STATION_BATCH
+        batch_add(&node->batch, node->adc_value, node->round, node->seq);
 
+        if (batch_due(&node->batch, node->adc_value) == false) {
+
+#if DEBUG
+            Serial.printf("Holding %u readings, radio stays off.\n", node->batch.count);
+#endif
+
+            node->holding = true;
+            return;
+        }
+#endif
+
+#if TDMA_SCHEDULE
+        // radio stays off until there is just enough time to connect before slot.
+        node->slot = tdma_slot(node->nodeName, node->round);
+        wait_for_slot(node, TDMA_LEAD_MS, true);
+#endif
+
+        energy_phase(node, ENERGY_SCAN);
         ssid_status = find_strongest_connection(node);
+        energy_phase(node, ENERGY_RX);
+        TRACE_MARK(node, TRACE_SCAN);
 
         if (ssid_status == VALID_SSID_FOUND) {
 
+#if TDMA_SCHEDULE
+            // scan came early, radio is off again until association has to start.
+            wait_for_slot(node, TDMA_CONNECT_MS, true);
+#endif
+            energy_phase(node, ENERGY_ASSOC);
             connection_status = connect_to_strongest_ssid(node);
 
+            // soft AP might be full, try next strongest network from same scan.
+            while (connection_status != CONNECTED && find_next_connection(node) == VALID_SSID_FOUND) {
+                connection_status = connect_to_strongest_ssid(node);
+            }
+            energy_phase(node, ENERGY_RX);
+            TRACE_MARK(node, TRACE_CONNECT);
+
             if (connection_status == CONNECTED) {
 
 #if DEBUG
                 Serial.println("Connection successful");
 #endif
-                get_adc_value(node);
+#if TDMA_SCHEDULE
+                wait_for_slot(node, 0, false);
+                energy_phase(node, ENERGY_TX);
+
+                // station of same slot may have sent over this frame, it goes once more in later
+                // slot. Association is kept, waiting for it costs less than associating again.
+                if (send_packet_to_ap(node) == false &&
+                    tdma_retry_slot(node->nodeName, node->round, &node->slot) == true) {
+                    energy_phase(node, ENERGY_RX);
+                    wait_for_slot(node, 0, false);
+                    energy_phase(node, ENERGY_TX);
+                    send_packet_to_ap(node);
+                }
+#else
+                energy_phase(node, ENERGY_TX);
                 send_packet_to_ap(node);
+#endif
+                energy_phase(node, ENERGY_RX);
+                TRACE_MARK(node, TRACE_SEND);
             }
             else {
 
@@ -437,15 +1339,20 @@ void handle_node(Node_s* node)
 
 void mode_decision(Node_s* node)
 {
-    float rnd_numb;
-    float T;
+    uint32_t rnd_numb;
+    uint32_t T;
 
-    rnd_numb = random_number();
+#if ELECTION == ELECTION_ENERGY
+    // own level goes into estimate of network average, not only levels of cluster heads.
+    node->scan_cache.energy_average = energy_average_update(node->scan_cache.energy_average,
+                                                            energy_level(&node->energy, BATTERY_CAPACITY_MAH));
+#endif
+
+    rnd_numb = random_number(node);
     T = calculate_threshold(node);
 
 #if DEBUG
-    Serial.print("Generated random number = ");
-    Serial.println(rnd_numb);
+    Serial.printf("Generated random number = %u/%u\n", rnd_numb, ELECTION_ONE);
 #endif
 
     if ((rnd_numb < T) && (node->ch_enable == 1)) {
@@ -455,6 +1362,7 @@ void mode_decision(Node_s* node)
         node->cluster_head = false;
     }
 
+    TRACE_MARK(node, TRACE_DECISION);
 }
 
 bool mount_fs(void)
@@ -514,38 +1422,80 @@ void read_fs(uint16_t* round, uint8_t* ch_enable)
     }
 }
 
-void init_node_name (Node_s* node)
+void read_state(Node_s* node, uint16_t* round, uint8_t* ch_enable)
 {
-    wifi_get_macaddr(STATION_IF, node->nodeName);
+    round_state_s* state = &node->state;
+
+    if (ESP.rtcUserMemoryRead(RTC_STATE_BLOCK, (uint32_t*)state, sizeof(*state)) &&
+        state_read(state, round, ch_enable)) {
+        return;
+    }
+
+#if DEBUG
+    Serial.println("Round state not in RTC memory, reading FS!");
+#endif
+
+    // cold boot, state is written to FS again at end of round.
+    memset(state, 0, sizeof(*state));
+
+    if (node->fs_mounted == false) {
+        node->fs_mounted = mount_fs();
+    }
+    if (node->fs_mounted == true) {
+        read_fs(round, ch_enable);
+    }
 }
 
-float random_number(void)
+void write_state(Node_s* node, uint16_t round, uint8_t ch_enable)
 {
-  float a;
+    if (state_write(&node->state, round, ch_enable) == true) {
+        if (node->fs_mounted == false) {
+            node->fs_mounted = mount_fs();
+        }
+        if (node->fs_mounted == true) {
+            write_fs(round, ch_enable);
+        }
+    }
 
-  a = ESP8266TrueRandom.random(10000);
-  a = a/10000;
+    ESP.rtcUserMemoryWrite(RTC_STATE_BLOCK, (uint32_t*)&node->state, sizeof(node->state));
+}
 
-#if DEBUG
-  Serial.print("random_number = ");
-  Serial.println(a, 3);
-#endif
+void init_node_name (Node_s* node)
+{
+    wifi_get_macaddr(STATION_IF, node->nodeName);
+}
 
-  return a;
+uint32_t random_number(Node_s* node)
+{
+    return election_random(&node->rng);
 }
 
-float calculate_threshold(Node_s* node)
+uint32_t calculate_threshold(Node_s* node)
 {
-    float T;
+    uint32_t T = election_round_threshold(node->round);
+
+#if ELECTION == ELECTION_ENERGY
+    uint8_t level = energy_level(&node->energy, BATTERY_CAPACITY_MAH);
+    uint8_t average = node->scan_cache.energy_average;
 
-    T = node->P/(1 - node->P * (node->round % ((unsigned char)round(1/node->P))));
+    // nodes with more energy than network average are cluster heads more often.
+    if (average != 0) {
+        T = T * level / average;
+    }
+    if (T > ELECTION_ONE) {
+        T = ELECTION_ONE;
+    }
+
+#if DEBUG
+    Serial.printf("Energy level = %u, network average = %u\n", level, average);
+#endif
+#endif
 
 #if DEBUG
     Serial.print("Current round in calculate_threshold = ");
     Serial.println(node->round);
-    Serial.print("T = ");
-    Serial.println(T, 3);
+    Serial.printf("T = %u/%u\n", T, ELECTION_ONE);
 #endif
-  
+
     return T;
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+/** @file hex.cpp
+ *  @brief
+ *
+ *  This file contains table and SWAR checks that string
+ *  is made of hex digits.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "hex.h"
+
+/** One in every byte of word.*/
+#define ONES                    0x0101010101010101ULL
+
+/** Top bit of every byte of word.*/
+#define HIGHS                   0x8080808080808080ULL
+
+/** Sets top bit of every byte which is at least c (bytes below 0x80).*/
+#define AT_LEAST(x, c)          (((x) + (0x80 - (c)) * ONES) & HIGHS)
+
+/** Sets top bit of every byte which is at most c (bytes below 0x80).*/
+#define AT_MOST(x, c)           (~((x) + (0x7F - (c)) * ONES) & HIGHS)
+
+/** Non-zero for '0'-'9', 'A'-'F' and 'a'-'f'.*/
+static const uint8_t Hex_table[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+    0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static bool word_is_hex(const char* txt)
+{
+    uint64_t x;
+    uint64_t lower;
+    uint64_t digit;
+    uint64_t letter;
+
+    memcpy(&x, txt, sizeof(x));
+
+    lower = x | 0x20 * ONES;
+    digit = AT_LEAST(x, '0') & AT_MOST(x, '9');
+    letter = AT_LEAST(lower, 'a') & AT_MOST(lower, 'f');
+
+    // byte above 0x7F fails in its own lane, carry it makes into next lane does not matter then.
+    return ((digit | letter) & ~x & HIGHS) == HIGHS;
+}
+
+bool hex_is_valid_table(const char* txt, size_t len)
+{
+    uint8_t valid = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        valid &= Hex_table[(uint8_t)txt[i]];
+    }
+
+    return valid != 0;
+}
+
+bool hex_is_valid(const char* txt, size_t len)
+{
+    bool valid = true;
+    size_t i;
+
+    if (len < sizeof(uint64_t)) {
+        return hex_is_valid_table(txt, len);
+    }
+
+    // no early exit, SSIDs are short and branch would cost more than word.
+    for (i = 0; i + sizeof(uint64_t) < len; i += sizeof(uint64_t)) {
+        valid &= word_is_hex(txt + i);
+    }
+
+    // last word overlaps previous one, checking byte twice changes nothing.
+    return valid & word_is_hex(txt + len - sizeof(uint64_t));
+}
@@ -14,38 +14,7 @@ Node_s Node;
 
 void setup() {
 
-    timer1_enable(TIM_DIV256, TIM_EDGE, TIM_SINGLE);
-    timer1_write(8388607);
-
-    WiFi.disconnect();
-    WiFi.forceSleepBegin(); // turn off WiFi by default.
-    WiFi.persistent(false);
-    uint16_t round;
-    uint8_t ch_enable;
-
-    pinMode(LED_BUILTIN, OUTPUT);
-    // by default LED will be ON
-    digitalWrite(LED_BUILTIN, LOW);
-
-#if DEBUG
-    Serial.begin(115200);
-    delay(10);
-    Serial.println();
-#endif
-
-    if (mount_fs()) {
-
-#if ROUNDS_RESET
-        write_fs(0, 1);
-#endif
-
-    read_fs(&round, &ch_enable);
-    }
-
-    Node.P = 1.0/NUMBER_OF_ROUNDS;
-    Node.round = round;
-    Node.ch_enable = ch_enable;
-    init_node_name(&Node);
+    init_round(&Node);
 
 #if DEBUG
     Serial.printf("Beggining of new round!\r\nround = %hu\r\nch_enable = %d\r\n", Node.round, Node.ch_enable);
@@ -72,9 +41,7 @@ void setup() {
 #endif
 
     handle_node(&Node);
-    prepare_next_round(&Node);
-    delay(200); // wait for UDP to be sent.
-    sleeping_time(&Node);
+    finish_round(&Node);
 }
 
 void loop() {
@@ -0,0 +1,127 @@
+/** @file relay.cpp
+ *  @brief
+ *
+ *  This file contains relay header of uplink forwarded
+ *  to other cluster head, and checks which keep relays
+ *  within hop limit and out of loops, and level of cluster
+ *  head carried in its SSID.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "relay.h"
+
+/** Length of MAC address written as hex, as in SSID of cluster head.*/
+#define RELAY_MAC_HEX           (2 * FRAME_MAC_SIZE)
+
+static bool ssid_names(const char* ssid, const uint8_t* mac)
+{
+    static const char digits[] = "0123456789ABCDEF";
+
+    for (uint8_t i = 0; i < FRAME_MAC_SIZE; i++) {
+        if (ssid[2*i] != digits[mac[i] >> 4] || ssid[2*i + 1] != digits[mac[i] & 0x0F]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void relay_init(relay_s* relay)
+{
+    memset(relay, 0, sizeof(*relay));
+}
+
+size_t relay_encode_header(uint8_t* buf, uint8_t hops, const uint8_t* mac)
+{
+    buf[0] = RELAY_MAGIC;
+    buf[1] = hops;
+    memcpy(buf + 2, mac, FRAME_MAC_SIZE);
+    buf[RELAY_HEADER_SIZE - 1] = frame_crc8(buf, RELAY_HEADER_SIZE - 1);
+
+    return RELAY_HEADER_SIZE;
+}
+
+bool relay_is_valid(const uint8_t* buf, size_t len)
+{
+    return len >= RELAY_HEADER_SIZE + UPLINK_HEADER_SIZE && len <= RELAY_DATAGRAM_SIZE &&
+           buf[0] == RELAY_MAGIC && buf[1] != 0 &&
+           frame_crc8(buf, RELAY_HEADER_SIZE - 1) == buf[RELAY_HEADER_SIZE - 1];
+}
+
+uint8_t relay_hops(const uint8_t* buf)
+{
+    return buf[1];
+}
+
+const uint8_t* relay_mac(const uint8_t* buf)
+{
+    return buf + 2;
+}
+
+bool relay_accept(relay_s* relay, const uint8_t* buf, const uint8_t* mac)
+{
+    const uint8_t* from = relay_mac(buf);
+    uint8_t i;
+
+    if (relay_hops(buf) > MULTI_HOP_MAX_HOPS || memcmp(from, mac, FRAME_MAC_SIZE) == 0) {
+        relay->dropped++;
+        return false;
+    }
+
+    // uplink of one forwarding node comes in several datagrams.
+    for (i = 0; i < relay->count; i++) {
+        if (memcmp(relay->sources[i], from, FRAME_MAC_SIZE) == 0) {
+            break;
+        }
+    }
+    if (i == relay->count && relay->count < RELAY_SOURCES) {
+        memcpy(relay->sources[relay->count++], from, FRAME_MAC_SIZE);
+    }
+
+    if (relay_hops(buf) > relay->hops) {
+        relay->hops = relay_hops(buf);
+    }
+    relay->datagrams++;
+
+    return true;
+}
+
+bool relay_is_source(const relay_s* relay, const char* ssid, const uint8_t* mac)
+{
+    if (strnlen(ssid, RELAY_MAC_HEX) < RELAY_MAC_HEX) {
+        return false;
+    }
+    if (ssid_names(ssid, mac) == true) {
+        return true;
+    }
+
+    for (uint8_t i = 0; i < relay->count; i++) {
+        if (ssid_names(ssid, relay->sources[i]) == true) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint8_t relay_level(const char* ssid)
+{
+    char digit = ssid[RELAY_MAC_HEX];
+
+    if (digit >= '0' && digit <= '9') {
+        return digit - '0';
+    }
+    if (digit >= 'A' && digit <= 'F') {
+        return digit - 'A' + 10;
+    }
+
+    return RELAY_NO_ROUTE;
+}
+
+uint8_t relay_next_level(uint8_t lowest)
+{
+    return lowest < MULTI_HOP_MAX_HOPS ? lowest + 1 : RELAY_NO_ROUTE;
+}
@@ -0,0 +1,78 @@
+/** @file sample.cpp
+ *  @brief
+ *
+ *  This file contains ring buffer of ADC samples and
+ *  integer filter and decimation which make reading
+ *  out of them.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "sample.h"
+
+#if SAMPLE_MEDIAN
+static uint16_t median3(uint16_t a, uint16_t b, uint16_t c)
+{
+    if (a > b) {
+        uint16_t t = a;
+        a = b;
+        b = t;
+    }
+    if (b > c) {
+        b = c;
+    }
+
+    return a > b ? a : b;
+}
+#endif
+
+void sample_clear(sample_ring_s* ring)
+{
+    ring->head = 0;
+    ring->count = 0;
+}
+
+void sample_push(sample_ring_s* ring, uint16_t value)
+{
+    ring->samples[ring->head] = value;
+    ring->head = (ring->head + 1) % SAMPLE_COUNT;
+
+    if (ring->count < SAMPLE_COUNT) {
+        ring->count++;
+    }
+}
+
+uint16_t sample_at(const sample_ring_s* ring, uint8_t index)
+{
+    return ring->samples[(ring->head + SAMPLE_COUNT - ring->count + index) % SAMPLE_COUNT];
+}
+
+uint16_t sample_reading(const sample_ring_s* ring)
+{
+    uint32_t sum = 0;
+
+    if (ring->count == 0) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < ring->count; i++) {
+#if SAMPLE_MEDIAN
+        // first and last sample have one neighbour, median is taken with it twice.
+        uint16_t prev = sample_at(ring, i == 0 ? i : i - 1);
+        uint16_t next = sample_at(ring, i + 1 == ring->count ? i : i + 1);
+
+        sum += median3(prev, sample_at(ring, i), next);
+#else
+        sum += sample_at(ring, i);
+#endif
+    }
+
+    if (ring->count < SAMPLE_COUNT) {
+        // rounded average of what was taken, scaled to full ring.
+        sum = (sum * SAMPLE_COUNT + ring->count / 2) / ring->count;
+    }
+
+    // sum has SAMPLE_ADC_BITS + SAMPLE_COUNT_BITS bits, keep SAMPLE_BITS of them rounded.
+    return (sum + ((1u << (SAMPLE_COUNT_BITS - SAMPLE_EXTRA_BITS)) >> 1)) >> (SAMPLE_COUNT_BITS - SAMPLE_EXTRA_BITS);
+}
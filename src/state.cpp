@@ -0,0 +1,119 @@
+/** @file state.cpp
+ *  @brief
+ *
+ *  This file contains round state kept in RTC memory,
+ *  and decision when it is backed up to flash.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "state.h"
+
+static uint8_t state_crc(const round_state_s* state)
+{
+    return frame_crc8((const uint8_t*)state + sizeof(state->crc), sizeof(*state) - sizeof(state->crc));
+}
+
+bool state_is_valid(const round_state_s* state)
+{
+    return state->magic == STATE_MAGIC && state->crc == state_crc(state);
+}
+
+bool state_read(const round_state_s* state, uint16_t* round, uint8_t* ch_enable)
+{
+    if (state_is_valid(state) == false) {
+        return false;
+    }
+
+    *round = state->round;
+    *ch_enable = state->ch_enable;
+
+    return true;
+}
+
+bool state_write(round_state_s* state, uint16_t round, uint8_t ch_enable)
+{
+    bool cold = state_is_valid(state) == false;
+
+    state->round = round;
+    state->ch_enable = ch_enable;
+    state->magic = STATE_MAGIC;
+    state->crc = state_crc(state);
+
+    return cold || round % STATE_CHECKPOINT_ROUNDS == 0;
+}
+
+uint64_t state_energy(const round_state_s* state)
+{
+    return state_is_valid(state) ? state->energy_uas : 0;
+}
+
+bool state_set_energy(round_state_s* state, uint64_t energy_uas)
+{
+    if (state_is_valid(state) == false) {
+        return false;
+    }
+
+    state->energy_uas = energy_uas;
+    state->crc = state_crc(state);
+
+    return true;
+}
+
+void state_clock(const round_state_s* state, sync_s* clock)
+{
+    if (state_is_valid(state) == true) {
+        *clock = state->clock;
+    }
+    else {
+        memset(clock, 0, sizeof(*clock));
+    }
+}
+
+bool state_set_clock(round_state_s* state, const sync_s* clock)
+{
+    if (state_is_valid(state) == false) {
+        return false;
+    }
+
+    state->clock = *clock;
+    state->crc = state_crc(state);
+
+    return true;
+}
+
+uint32_t state_rng(const round_state_s* state)
+{
+    return state_is_valid(state) ? state->rng : 0;
+}
+
+bool state_set_rng(round_state_s* state, uint32_t rng)
+{
+    if (state_is_valid(state) == false) {
+        return false;
+    }
+
+    state->rng = rng;
+    state->crc = state_crc(state);
+
+    return true;
+}
+
+uint8_t state_seq(const round_state_s* state)
+{
+    return state_is_valid(state) ? state->seq : 0;
+}
+
+bool state_set_seq(round_state_s* state, uint8_t seq)
+{
+    if (state_is_valid(state) == false) {
+        return false;
+    }
+
+    state->seq = seq;
+    state->crc = state_crc(state);
+
+    return true;
+}
@@ -0,0 +1,81 @@
+/** @file sync.cpp
+ *  @brief
+ *
+ *  This file contains sync reply of cluster head, and skew
+ *  estimate which corrects sleep of node.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <string.h>
+#include "sync.h"
+#include "frame.h"
+
+size_t sync_encode(uint8_t* buf, const uint8_t* mac, uint32_t elapsed_us)
+{
+    buf[0] = SYNC_MARKER;
+    memcpy(buf + 1, mac, FRAME_MAC_SIZE);
+    buf[7] = elapsed_us;
+    buf[8] = elapsed_us >> 8;
+    buf[9] = elapsed_us >> 16;
+    buf[10] = elapsed_us >> 24;
+    buf[11] = frame_crc8(buf, SYNC_SIZE - 1);
+
+    return SYNC_SIZE;
+}
+
+bool sync_is_valid(const uint8_t* buf, size_t len)
+{
+    return len == SYNC_SIZE && buf[0] == SYNC_MARKER && frame_crc8(buf, SYNC_SIZE - 1) == buf[SYNC_SIZE - 1];
+}
+
+const uint8_t* sync_mac(const uint8_t* buf)
+{
+    return buf + 1;
+}
+
+uint32_t sync_elapsed(const uint8_t* buf)
+{
+    return (uint32_t)buf[7] | (uint32_t)buf[8] << 8 | (uint32_t)buf[9] << 16 | (uint32_t)buf[10] << 24;
+}
+
+void sync_update(sync_s* sync, int32_t offset_us)
+{
+    int64_t skew = sync->skew_ppb;
+
+    // offset left after previous correction is what RTC rate added since.
+    if (sync->synced != 0 && sync->unsynced_us > 0 &&
+        offset_us <= SYNC_RATE_WINDOW_US && offset_us >= -SYNC_RATE_WINDOW_US) {
+        int64_t measured = skew - (int64_t)offset_us * 1000000000 / sync->unsynced_us;
+
+        skew += (measured - skew) >> SYNC_GAIN_SHIFT;
+    }
+    skew -= skew >> SYNC_LEAK_SHIFT;
+
+    if (skew > SYNC_MAX_SKEW_PPB) {
+        skew = SYNC_MAX_SKEW_PPB;
+    }
+    if (skew < -SYNC_MAX_SKEW_PPB) {
+        skew = -SYNC_MAX_SKEW_PPB;
+    }
+
+    sync->skew_ppb = skew;
+    sync->offset_us = offset_us;
+    sync->unsynced_us = 0;
+    sync->synced = 1;
+}
+
+uint64_t sync_sleep(sync_s* sync, uint64_t sleep_us)
+{
+    int64_t wanted = (int64_t)sleep_us + sync->offset_us;
+
+    if (wanted < SYNC_MIN_SLEEP_US) {
+        wanted = SYNC_MIN_SLEEP_US;
+    }
+
+    sync->offset_us = 0;
+    sync->unsynced_us = sync->unsynced_us + wanted > UINT32_MAX ? UINT32_MAX : sync->unsynced_us + wanted;
+
+    return wanted - wanted * sync->skew_ppb / 1000000000;
+}
@@ -0,0 +1,49 @@
+/** @file tdma.cpp
+ *  @brief
+ *
+ *  This file contains slot schedule of station
+ *  transmissions within cluster.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "tdma.h"
+
+/** Round time in ms when last slot ends.*/
+#define TDMA_END_MS             ((uint32_t)TDMA_START_MS + (uint32_t)TDMA_SLOTS * TDMA_SLOT_MS)
+
+uint8_t tdma_slot(const uint8_t* mac, uint8_t round)
+{
+    return (channel_hash(mac, round) >> 16) % TDMA_SLOTS;
+}
+
+bool tdma_retry_slot(const uint8_t* mac, uint8_t round, uint8_t* slot)
+{
+    uint8_t later = TDMA_SLOTS - 1 - *slot;
+
+    if (later == 0) {
+        return false;
+    }
+
+    // low bits of hash, stations which shared slot mostly pick different ones.
+    *slot += 1 + (channel_hash(mac, round) & 0xFFFF) % later;
+
+    return true;
+}
+
+uint32_t tdma_wait_ms(uint8_t slot, uint32_t elapsed_ms, uint32_t lead_ms)
+{
+    uint32_t start = TDMA_START_MS + (uint32_t)slot * TDMA_SLOT_MS;
+
+    start = start > lead_ms ? start - lead_ms : 0;
+
+    return start > elapsed_ms ? start - elapsed_ms : 0;
+}
+
+uint32_t tdma_window_ms(uint32_t elapsed_ms, uint32_t tail_ms)
+{
+    uint32_t end = TDMA_END_MS + tail_ms;
+
+    return end > elapsed_ms ? end - elapsed_ms : 0;
+}
@@ -0,0 +1,83 @@
+/** @file trace.cpp
+ *  @brief
+ *
+ *  This file contains ring buffer of phase marks and
+ *  writer of trace line.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+static const char* const Phase_names[TRACE_PHASES] = {
+    "boot", "state", "sample", "decision", "scan",
+    "connect", "send", "ap_start", "receive", "uplink",
+    "sleep"
+};
+
+void trace_clear(trace_s* trace)
+{
+    trace->head = 0;
+    trace->count = 0;
+}
+
+void trace_mark(trace_s* trace, uint8_t phase, uint32_t cycles)
+{
+    trace->marks[trace->head].cycles = cycles;
+    trace->marks[trace->head].phase = phase;
+    trace->head = (trace->head + 1) % TRACE_CAPACITY;
+
+    if (trace->count < TRACE_CAPACITY) {
+        trace->count++;
+    }
+}
+
+const char* trace_phase_name(uint8_t phase)
+{
+    return phase < TRACE_PHASES ? Phase_names[phase] : "unknown";
+}
+
+uint8_t trace_phase_by_name(const char* name, size_t len)
+{
+    for (uint8_t i = 0; i < TRACE_PHASES; i++) {
+        if (strlen(Phase_names[i]) == len && strncmp(Phase_names[i], name, len) == 0) {
+            return i;
+        }
+    }
+
+    return TRACE_PHASES;
+}
+
+size_t trace_format(char* buf, const trace_s* trace, const uint8_t* mac, uint16_t round,
+                    bool cluster_head, uint32_t cycles_per_us)
+{
+    uint8_t first = (trace->head + TRACE_CAPACITY - trace->count) % TRACE_CAPACITY;
+    // when oldest marks were overwritten, first kept mark has no start.
+    uint32_t previous = 0;
+    bool start_known = trace->count < TRACE_CAPACITY;
+    size_t len;
+
+    len = snprintf(buf, TRACE_LINE_SIZE, "%s %02X%02X%02X%02X%02X%02X %u %c", TRACE_PREFIX,
+                   mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], round, cluster_head ? 'C' : 'S');
+
+    for (uint8_t i = 0; i < trace->count; i++) {
+        const trace_mark_s* mark = &trace->marks[(first + i) % TRACE_CAPACITY];
+
+        if (i > 0 || start_known) {
+            int n = snprintf(buf + len, TRACE_LINE_SIZE - len, " %s=%u", trace_phase_name(mark->phase),
+                             (mark->cycles - previous) / cycles_per_us);
+
+            if (n < 0 || len + n >= TRACE_LINE_SIZE) {
+                buf[len] = '\0';
+                break;
+            }
+            len += n;
+        }
+        previous = mark->cycles;
+    }
+
+    return len;
+}
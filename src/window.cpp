@@ -0,0 +1,73 @@
+/** @file window.cpp
+ *  @brief
+ *
+ *  This file contains histogram of observed times and
+ *  timeout calculated from its percentile.
+ *
+ *  @author Pavle Lakic
+ *  @bug No known bugs
+ */
+
+#include "window.h"
+
+void window_add(window_s* window, uint32_t ms, uint32_t max_ms)
+{
+    uint32_t bucket = (uint64_t)ms * WINDOW_BUCKETS / max_ms;
+
+    if (bucket >= WINDOW_BUCKETS) {
+        bucket = WINDOW_BUCKETS - 1;
+    }
+
+    // older rounds count half, room is made for new observation.
+    if (window_count(window) + 1 > WINDOW_HISTORY) {
+        for (uint8_t i = 0; i < WINDOW_BUCKETS; i++) {
+            window->counts[i] /= 2;
+        }
+    }
+
+    window->counts[bucket]++;
+}
+
+uint32_t window_count(const window_s* window)
+{
+    uint32_t count = 0;
+
+    for (uint8_t i = 0; i < WINDOW_BUCKETS; i++) {
+        count += window->counts[i];
+    }
+
+    return count;
+}
+
+uint32_t window_timeout(const window_s* window, uint32_t min_ms, uint32_t max_ms, uint32_t margin_ms)
+{
+    uint32_t count = window_count(window);
+    uint32_t needed;
+    uint32_t seen = 0;
+    uint32_t timeout = max_ms;
+
+    if (count == 0) {
+        return max_ms;
+    }
+
+    // nearest rank, at least one observation.
+    needed = (count * WINDOW_PERCENTILE + 99) / 100;
+
+    for (uint8_t i = 0; i < WINDOW_BUCKETS; i++) {
+        seen += window->counts[i];
+
+        if (seen >= needed) {
+            timeout = (uint64_t)(i + 1) * max_ms / WINDOW_BUCKETS + margin_ms;
+            break;
+        }
+    }
+
+    if (timeout < min_ms) {
+        timeout = min_ms;
+    }
+    if (timeout > max_ms) {
+        timeout = max_ms;
+    }
+
+    return timeout;
+}